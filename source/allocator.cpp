@@ -0,0 +1,73 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+allocator.cpp replaces the global new and delete operators with ones that allocate through mallocate and mfree.
+It is only linked into the ga program, not the library, so programs embedding the library keep their own allocator and std::bad_alloc.
+*/
+
+#include "memory.hpp"
+
+/* new overloads the usual new with mallocate instead of malloc
+	parameters:
+		size: the number of bytes to allocate [ this parameter is not inputted directly due to the syntax of new; new int(x) translates conceptually to new(sizeof(int)) ]
+	returns: a pointer to the block of memory allocated
+	notes:
+		This function forces all memory allocation through mallocate, which allows custom error reporting and memory tracking.
+	todo:
+*/
+void* operator new (size_t size) {
+	return mallocate(size);
+}
+
+/* new[] overloads the usual new[] with mallocate instead of malloc
+	parameters:
+		size: the number of bytes to allocate [ this parameter is not inputted directly due to the syntax of new[]; new int[x] translates conceptually to new(sizeof(int) * x) ]
+	returns: a pointer to the block of memory allocated
+	notes:
+		This function forces all memory allocation through mallocate, which allows custom error reporting and memory tracking.
+	todo:
+*/
+void* operator new[] (size_t size) {
+	return mallocate(size);
+}
+
+/* delete overloads the usual delete with mfree instead of free
+	parameters:
+		mem: a pointer to the block of memory to free
+	returns: nothing
+	notes:
+		This function forces all memory deallocation through mfree, which allows custom error reporting and memory tracking.
+	todo:
+*/
+void operator delete (void* mem) {
+	mfree(mem);
+}
+
+/* delete[] overloads the usual delete[] with mfree instead of free
+	parameters:
+		mem: a pointer to the block of memory to free
+	returns: nothing
+	notes:
+		This function forces all memory deallocation through mfree, which allows custom error reporting and memory tracking.
+	todo:
+*/
+void operator delete[] (void* mem) {
+	mfree(mem);
+}
+
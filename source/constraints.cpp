@@ -0,0 +1,259 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+constraints.cpp contains functions that read the linear constraints in the ranges file and check and repair parameter sets against them.
+Sets are checked before they are simulated, so a set known to be invalid never costs a simulation.
+*/
+
+#include <algorithm> // Needed for min, max
+#include <cctype> // Needed for isalpha, isalnum, isdigit, isspace
+#include <cmath> // Needed for ceil, floor
+#include <cstdlib> // Needed for strtod, atoi
+
+#include "constraints.hpp" // Function declarations
+
+#include "macros.hpp"
+
+using namespace std;
+
+extern terminal* term; // Declared in init.cpp
+
+/* failed_constraint prints why the given constraint could not be read and exits
+	parameters:
+		text: the constraint as written in the ranges file
+		reason: what is wrong with it
+	returns: nothing
+	notes:
+	todo:
+*/
+static void failed_constraint (const char* text, const char* reason) {
+	cout << term->red << "Couldn't read the constraint '" << text << "' in the ranges file: " << reason << term->reset << endl;
+	exit(EXIT_INPUT_ERROR);
+}
+
+/* find_parameter finds the parameter the given name refers to
+	parameters:
+		ip: the program's input parameters
+		names: the name of each parameter in the ranges file
+		name: the start of the name
+		length: the length of the name
+	returns: the index of the parameter, or -1 if there is none with the name
+	notes:
+		A parameter is named by its name in the ranges file with spaces written as underscores (e.g. gradient_start), or by $ followed by its index (e.g. $0).
+	todo:
+*/
+static int find_parameter (input_params& ip, char** names, const char* name, int length) {
+	if (name[0] == '$') {
+		int index = atoi(name + 1);
+		return length > 1 && index < ip.num_dims ? index : -1;
+	}
+	for (int i = 0; i < ip.num_dims; i++) {
+		if (names[i] == NULL || (int)strlen(names[i]) != length) {
+			continue;
+		}
+		int j = 0;
+		while (j < length && (names[i][j] == name[j] || (names[i][j] == ' ' && name[j] == '_'))) {
+			j++;
+		}
+		if (j == length) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* parse_side adds one side of a constraint, a sum of parameters times coefficients and constants, to the given coefficients and constant
+	parameters:
+		ip: the program's input parameters
+		names: the name of each parameter in the ranges file
+		text: the whole constraint, for error messages
+		pos: a pointer to the position to parse from, advanced past the side
+		sign: 1 to add the side, -1 to subtract it
+		coefficients: the coefficient of each parameter to add to
+		constant: a pointer to the constant to add to
+	returns: nothing
+	notes:
+		Terms look like 2*p4, 2 p4, -p4, p4, or 3, and are joined by + or -.
+	todo:
+*/
+static void parse_side (input_params& ip, char** names, const char* text, const char** pos, double sign, double* coefficients, double* constant) {
+	const char* p = *pos;
+	bool first = true;
+	while (true) {
+		while (isspace(*p)) {p++;}
+		double term_sign = sign;
+		if (*p == '+' || *p == '-') {
+			term_sign = *p == '-' ? -sign : sign;
+			p++;
+			while (isspace(*p)) {p++;}
+		} else if (!first) {
+			break;
+		}
+		
+		// Read the coefficient, if any, and the parameter, if any
+		double coefficient = 1;
+		bool has_number = false;
+		if (isdigit(*p) || *p == '.') {
+			char* end;
+			coefficient = strtod(p, &end);
+			p = end;
+			has_number = true;
+			while (isspace(*p)) {p++;}
+			if (*p == '*') {
+				p++;
+				while (isspace(*p)) {p++;}
+			}
+		}
+		const char* name = p;
+		if (*p == '$') {
+			p++;
+			while (isdigit(*p)) {p++;}
+		} else if (isalpha(*p) || *p == '_') {
+			while (isalnum(*p) || *p == '_') {p++;}
+		}
+		if (p == name) {
+			if (!has_number) {
+				failed_constraint(text, "expected a number or a parameter name");
+			}
+			*constant += term_sign * coefficient;
+		} else {
+			int index = find_parameter(ip, names, name, p - name);
+			if (index == -1) {
+				failed_constraint(text, "it names an unknown parameter (write spaces in names as underscores or use $ and the index, e.g. $0)");
+			}
+			coefficients[index] += term_sign * coefficient;
+		}
+		first = false;
+	}
+	*pos = p;
+}
+
+/* add_constraint reads a linear constraint and adds it to the list of constraints
+	parameters:
+		ip: the program's input parameters, with the ranges already read
+		text: the constraint, e.g. 'gradient_end - gradient_start >= 2'
+		names: the name of each parameter in the ranges file
+	returns: nothing
+	notes:
+		Both sides may be sums of parameters times coefficients and constants. The comparison may be <=, >=, <, or >.
+	todo:
+*/
+void add_constraint (input_params& ip, const char* text, char** names) {
+	linear_constraint* lc = new linear_constraint(text, ip.num_dims);
+	double constant = 0;
+	const char* p = text;
+	parse_side(ip, names, text, &p, 1, lc->coefficients, &constant);
+	
+	// Read the comparison and move everything to the left side, so the constraint is that the sum is at most 0
+	double sign;
+	if (p[0] == '<' || p[0] == '>') {
+		sign = p[0] == '<' ? 1 : -1;
+		lc->strict = p[1] != '=';
+		p += lc->strict ? 1 : 2;
+	} else {
+		failed_constraint(text, "expected <=, >=, <, or > between the sides");
+	}
+	parse_side(ip, names, text, &p, -1, lc->coefficients, &constant);
+	while (isspace(*p)) {p++;}
+	if (*p != '\0') {
+		failed_constraint(text, "unexpected text after the right side");
+	}
+	for (int i = 0; i < ip.num_dims; i++) {
+		lc->coefficients[i] *= sign;
+	}
+	lc->bound = -sign * constant;
+	
+	lc->next = ip.constraints;
+	ip.constraints = lc;
+}
+
+/* excess returns how far the given set is from satisfying the given constraint
+	parameters:
+		ip: the program's input parameters
+		lc: the constraint
+		set: the parameter set
+	returns: how much the weighted sum exceeds the bound, which is positive if the constraint is broken
+	notes:
+		A strict constraint is broken by a sum equal to its bound, so its excess is nudged above 0 then.
+	todo:
+*/
+static double excess (input_params& ip, linear_constraint* lc, const int set[]) {
+	double sum = 0;
+	for (int i = 0; i < ip.num_dims; i++) {
+		sum += lc->coefficients[i] * set[i];
+	}
+	double over = sum - lc->bound;
+	return lc->strict && over >= 0 ? over + 1e-6 : over;
+}
+
+/* satisfies_constraints checks whether the given set satisfies every constraint
+	parameters:
+		ip: the program's input parameters
+		set: the parameter set
+	returns: true if the set satisfies every constraint, false otherwise
+	notes:
+	todo:
+*/
+bool satisfies_constraints (input_params& ip, const int set[]) {
+	for (linear_constraint* lc = ip.constraints; lc != NULL; lc = lc->next) {
+		if (excess(ip, lc, set) > 1e-9) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* repair_set moves the given set the shortest distance onto each constraint it breaks, keeping it within the ranges
+	parameters:
+		ip: the program's input parameters
+		set: the parameter set to repair
+	returns: true if the repaired set satisfies every constraint, false if it could not be repaired
+	notes:
+		Each broken constraint is fixed in turn by projecting the set onto its boundary, rounding every changed parameter toward satisfying it. Fixing one constraint can break another, so this is repeated up to CONSTRAINT_REPAIR_ROUNDS times.
+	todo:
+*/
+bool repair_set (input_params& ip, int set[]) {
+	for (int round = 0; round < CONSTRAINT_REPAIR_ROUNDS; round++) {
+		bool repaired = true;
+		for (linear_constraint* lc = ip.constraints; lc != NULL; lc = lc->next) {
+			double over = excess(ip, lc, set);
+			if (over <= 1e-9) {
+				continue;
+			}
+			repaired = false;
+			double norm = 0;
+			for (int i = 0; i < ip.num_dims; i++) {
+				norm += lc->coefficients[i] * lc->coefficients[i];
+			}
+			for (int i = 0; i < ip.num_dims; i++) {
+				double c = lc->coefficients[i];
+				if (c != 0) {
+					double moved = set[i] - c * over / norm;
+					int value = c > 0 ? (int)floor(moved) : (int)ceil(moved);
+					set[i] = max(ip.ranges[i].first, min(ip.ranges[i].second, value));
+				}
+			}
+		}
+		if (repaired) {
+			return true;
+		}
+	}
+	return satisfies_constraints(ip, set);
+}
+
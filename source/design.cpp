@@ -0,0 +1,178 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+design.cpp contains functions that place parameter sets in the unit hypercube according to space-filling designs.
+Callers scale the returned coordinates into the parameter ranges themselves.
+*/
+
+#include "design.hpp" // Function declarations
+
+#include "random.hpp"
+
+using namespace std;
+
+// The initial direction numbers of the first dimensions after the first, taken from Joe and Kuo's table (the first dimension needs none)
+static const int sobol_initial_degree = 7;
+static const unsigned int sobol_initial[][sobol_initial_degree] = {
+	{1}, {1, 3}, {1, 3, 1}, {1, 1, 1}, {1, 1, 3, 3}, {1, 3, 5, 13}, {1, 1, 5, 5, 17}, {1, 1, 5, 5, 5}, {1, 1, 7, 11, 19}, {1, 1, 5, 1, 1},
+	{1, 1, 1, 3, 11}, {1, 3, 5, 5, 31}, {1, 3, 3, 9, 7, 49}, {1, 1, 1, 15, 21, 21}, {1, 3, 1, 13, 27, 49}, {1, 1, 1, 15, 7, 5}, {1, 3, 1, 15, 13, 25}, {1, 1, 5, 5, 19, 61},
+	{1, 3, 7, 11, 23, 15, 103}, {1, 3, 7, 13, 13, 15, 69}
+};
+static const int sobol_initial_count = sizeof(sobol_initial) / sizeof(sobol_initial[0]);
+
+/* primitive_polynomial checks whether the given polynomial over GF(2) is primitive
+	parameters:
+		poly: the polynomial's coefficients as bits, with bit i holding the coefficient of x^i
+		degree: the degree of the polynomial
+	returns: true if the polynomial is primitive, false otherwise
+	notes:
+		A polynomial of degree s is primitive if and only if the smallest power of x congruent to 1 modulo it is x^(2^s - 1). This brute-force check is only meant for the small degrees Sobol sequences need.
+	todo:
+*/
+static bool primitive_polynomial (unsigned int poly, int degree) {
+	if ((poly & 1) == 0) {
+		return false;
+	}
+	unsigned int period = (1u << degree) - 1;
+	unsigned int power = 1;
+	for (unsigned int k = 1; k <= period; k++) {
+		power <<= 1;
+		if (power & (1u << degree)) {
+			power ^= poly;
+		}
+		if (power == 1) {
+			return k == period;
+		}
+	}
+	return false;
+}
+
+/* init_sobol computes the direction numbers and random shifts of the given Sobol sequence
+	parameters:
+		seq: the sequence to initialize, with its number of dimensions already set
+		rng: the random number generator to draw the shifts from
+	returns: nothing
+	notes:
+		Primitive polynomials are enumerated in increasing degree and then increasing value, which is the order Joe and Kuo's table uses. Dimensions beyond the table get pseudorandom odd initial direction numbers, which still give a valid (if less optimized) Sobol sequence.
+		The random shifts are drawn from rng, so the sequence depends on the seed.
+	todo:
+*/
+void init_sobol (sobol_sequence& seq, rng_state& rng) {
+	// The first dimension is the van der Corput sequence
+	for (int i = 0; i < SOBOL_BITS; i++) {
+		seq.directions[i] = 1u << (SOBOL_BITS - 1 - i);
+	}
+	
+	int degree = 1;
+	unsigned int poly = 1u << degree;
+	unsigned int filler = 1;
+	for (int d = 1; d < seq.num_dims; d++) {
+		// Find the next primitive polynomial
+		do {
+			poly++;
+			if (poly >= (2u << degree)) {
+				degree++;
+				poly = 1u << degree;
+			}
+		} while (!primitive_polynomial(poly, degree));
+		
+		// Choose the initial direction numbers, which must be odd and less than 2^(i + 1)
+		unsigned int m[SOBOL_BITS];
+		for (int i = 0; i < degree; i++) {
+			if (d - 1 < sobol_initial_count && degree <= sobol_initial_degree) {
+				m[i] = sobol_initial[d - 1][i];
+			} else {
+				filler = filler * 1103515245u + 12345u;
+				m[i] = ((filler >> 8) % (1u << i)) * 2 + 1;
+			}
+		}
+		
+		// Derive the remaining direction numbers from the polynomial's recurrence
+		for (int i = degree; i < SOBOL_BITS; i++) {
+			m[i] = m[i - degree] ^ (m[i - degree] << degree);
+			for (int k = 1; k < degree; k++) {
+				if (poly & (1u << (degree - k))) {
+					m[i] ^= m[i - k] << k;
+				}
+			}
+		}
+		for (int i = 0; i < SOBOL_BITS; i++) {
+			seq.directions[d * SOBOL_BITS + i] = m[i] << (SOBOL_BITS - 1 - i);
+		}
+	}
+	
+	for (int d = 0; d < seq.num_dims; d++) {
+		seq.shifts[d] = (unsigned int)rng_next(rng);
+	}
+}
+
+/* sobol_point computes the point with the given index in the given Sobol sequence
+	parameters:
+		seq: the initialized sequence
+		index: the index of the point
+		point: an array to store the point's coordinates in, each in [0, 1)
+	returns: nothing
+	notes:
+		Points are computed directly from their index's Gray code, so they can be generated in any order.
+	todo:
+*/
+void sobol_point (sobol_sequence& seq, unsigned int index, double point[]) {
+	unsigned int gray = index ^ (index >> 1);
+	for (int d = 0; d < seq.num_dims; d++) {
+		unsigned int x = seq.shifts[d];
+		unsigned int* v = seq.directions + d * SOBOL_BITS;
+		for (int i = 0; i < SOBOL_BITS && (gray >> i) != 0; i++) {
+			if (gray & (1u << i)) {
+				x ^= v[i];
+			}
+		}
+		point[d] = x / 4294967296.0;
+	}
+}
+
+/* latin_hypercube fills the given array with a Latin hypercube design
+	parameters:
+		num_dims: the number of dimensions of each point
+		count: the number of points to place
+		points: an array of count * num_dims coordinates to fill, one point after another
+		rng: the random number generator to place and shuffle the points with
+	returns: nothing
+	notes:
+		Each dimension is cut into count equal strata and every stratum holds exactly one point, at a random position within it.
+	todo:
+*/
+void latin_hypercube (int num_dims, int count, double* points, rng_state& rng) {
+	int* strata = new int[count];
+	for (int d = 0; d < num_dims; d++) {
+		for (int i = 0; i < count; i++) {
+			strata[i] = i;
+		}
+		for (int i = count - 1; i > 0; i--) {
+			int j = rng_int(rng, i + 1);
+			int temp = strata[i];
+			strata[i] = strata[j];
+			strata[j] = temp;
+		}
+		for (int i = 0; i < count; i++) {
+			points[i * num_dims + d] = (strata[i] + rng_uniform(rng)) / count;
+		}
+	}
+	delete[] strata;
+}
+
@@ -0,0 +1,33 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+design.hpp contains function declarations for design.cpp.
+*/
+
+#ifndef DESIGN_HPP
+#define DESIGN_HPP
+
+#include "structs.hpp"
+
+void init_sobol(sobol_sequence&, rng_state&);
+void sobol_point(sobol_sequence&, unsigned int, double[]);
+void latin_hypercube(int, int, double*, rng_state&);
+
+#endif
+
@@ -0,0 +1,455 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+engines.cpp contains the optimizers that can drive a run: the genetic algorithm, CMA-ES, and differential evolution.
+Each engine asks for a batch of members to score and is told their scores, while the run scores every batch the same way, so the engines share the parallel simulations, score database, constraints, and budgets.
+Every engine starts from the same scored initial population, placed with --init and seeded with --seed-population.
+*/
+
+#include <algorithm> // Needed for sort
+#include <cmath> // Needed for exp, fabs, log, sqrt
+
+#include "engines.hpp" // Function declarations
+
+#include "init.hpp"
+#include "macros.hpp"
+#include "random.hpp"
+#include "trace.hpp"
+
+using namespace std;
+
+void cmaes_eigen(cmaes_state&);
+genotype* cmaes_ask(input_params&, ga_run&, int&);
+void cmaes_start(input_params&, ga_run&);
+void cmaes_tell(input_params&, ga_run&, genotype*, int);
+genotype* de_ask(input_params&, ga_run&, int&);
+void de_start(input_params&, ga_run&);
+void de_tell(input_params&, ga_run&, genotype*, int);
+genotype* ga_ask(input_params&, ga_run&, int&);
+void ga_start(input_params&, ga_run&);
+void ga_tell(input_params&, ga_run&, genotype*, int);
+void keep_best(input_params&, genotype*);
+
+/* choose_engine returns the engine with the given index
+	parameters:
+		engine: the index of the engine (ENGINE_GA, ENGINE_CMAES, or ENGINE_DE)
+	returns: the engine
+	notes:
+	todo:
+*/
+ga_engine choose_engine (int engine) {
+	ga_engine e;
+	if (engine == ENGINE_CMAES) {
+		e.name = "CMA-ES";
+		e.start = cmaes_start;
+		e.ask = cmaes_ask;
+		e.tell = cmaes_tell;
+	} else if (engine == ENGINE_DE) {
+		e.name = "differential evolution";
+		e.start = de_start;
+		e.ask = de_ask;
+		e.tell = de_tell;
+	} else {
+		e.name = "genetic algorithm";
+		e.start = ga_start;
+		e.ask = ga_ask;
+		e.tell = ga_tell;
+	}
+	return e;
+}
+
+/* keep_best stores the population's best member after the last if it beats the best member found so far
+	parameters:
+		ip: the program's input parameters
+		population: the population, with the best member stored after the last
+	returns: nothing
+	notes:
+		Unlike the genetic algorithm's elitist operator, this never copies the best member back into the population, which would disturb the other engines' search.
+	todo:
+*/
+void keep_best (input_params& ip, genotype* population) {
+	int best_mem = 0;
+	for (int i = 1; i < ip.population; i++) {
+		if (population[i].fitness > population[best_mem].fitness) {
+			best_mem = i;
+		}
+	}
+	if (population[best_mem].fitness > population[ip.population].fitness) {
+		population[ip.population] = population[best_mem];
+	}
+}
+
+/* ga_start starts the genetic algorithm, which needs nothing beyond the scored initial population
+	parameters:
+		ip: the program's input parameters
+		run: the run to start the engine for
+	returns: nothing
+	notes:
+	todo:
+*/
+void ga_start (input_params& ip, ga_run& run) {
+}
+
+/* ga_ask breeds the next generation with the genetic algorithm's selection, crossover, and mutation
+	parameters:
+		ip: the program's input parameters
+		run: the run
+		count: set to the number of members to score
+	returns: the members to score, i.e. the whole population
+	notes:
+	todo:
+*/
+genotype* ga_ask (input_params& ip, ga_run& run, int& count) {
+	double start = wall_time();
+	run.ops.selector(ip, run.rs, run.population, run.newpopulation);
+	trace_phase(ip, "selector", start);
+	start = wall_time();
+	run.ops.crossover(ip, run.rs, run.population);
+	trace_phase(ip, "crossover", start);
+	start = wall_time();
+	run.ops.mutate(ip, run.rs, run.population);
+	trace_phase(ip, "mutate", start);
+	count = ip.population;
+	return run.population;
+}
+
+/* ga_tell keeps the best member found so far in the scored generation with the elitist operator
+	parameters:
+		ip: the program's input parameters
+		run: the run
+		batch: the scored members, i.e. the whole population
+		count: the number of scored members
+	returns: nothing
+	notes:
+	todo:
+*/
+void ga_tell (input_params& ip, ga_run& run, genotype* batch, int count) {
+	double start = wall_time();
+	run.ops.elitist(ip, run.population);
+	trace_phase(ip, "elitist", start);
+}
+
+/* de_start starts differential evolution, whose population is the scored initial population
+	parameters:
+		ip: the program's input parameters
+		run: the run to start the engine for
+	returns: nothing
+	notes:
+	todo:
+*/
+void de_start (input_params& ip, ga_run& run) {
+}
+
+/* de_ask builds a trial member for every member of the population with DE/rand/1/bin
+	parameters:
+		ip: the program's input parameters
+		run: the run
+		count: set to the number of members to score
+	returns: the trial members, stored in the run's second population
+	notes:
+		Each trial member takes each parameter with probability --de-crossover, and at least one, from a mutant built by adding --de-weight times the difference between two random members to a third. A mutant parameter past its range is put halfway between the range's bound and the target member's parameter, so trials near a bound are not all piled onto it.
+	todo:
+*/
+genotype* de_ask (input_params& ip, ga_run& run, int& count) {
+	rng_state& rng = run.rs.rng;
+	genotype* population = run.population;
+	genotype* trials = run.newpopulation;
+	for (int i = 0; i < ip.population; i++) {
+		int r1, r2, r3;
+		do {
+			r1 = rng_int(rng, ip.population);
+		} while (r1 == i);
+		do {
+			r2 = rng_int(rng, ip.population);
+		} while (r2 == i || r2 == r1);
+		do {
+			r3 = rng_int(rng, ip.population);
+		} while (r3 == i || r3 == r1 || r3 == r2);
+		genotype& target = population[i];
+		genotype& trial = trials[i];
+		trial = target;
+		int forced = rng_int(rng, ip.num_dims);
+		for (int j = 0; j < ip.num_dims; j++) {
+			if (j != forced && rng_uniform(rng) >= ip.de_crossover) {
+				continue;
+			}
+			double v = population[r1].gene[j] + ip.de_weight * (population[r2].gene[j] - population[r3].gene[j]);
+			if (v < target.lower[j]) {
+				v = (target.lower[j] + target.gene[j]) / 2;
+			} else if (v > target.upper[j]) {
+				v = (target.upper[j] + target.gene[j]) / 2;
+			}
+			trial.gene[j] = v;
+		}
+	}
+	count = ip.population;
+	return trials;
+}
+
+/* de_tell replaces every member of the population whose trial member scored at least as well
+	parameters:
+		ip: the program's input parameters
+		run: the run
+		batch: the scored trial members
+		count: the number of scored trial members
+	returns: nothing
+	notes:
+		Ties go to the trial member so the population can drift across the flat stretches sparse scores leave.
+	todo:
+*/
+void de_tell (input_params& ip, ga_run& run, genotype* batch, int count) {
+	for (int i = 0; i < count; i++) {
+		if (batch[i].fitness >= run.population[i].fitness) {
+			run.population[i] = batch[i];
+		}
+	}
+	keep_best(ip, run.population);
+}
+
+/* cmaes_start sets up CMA-ES's search distribution around the best member of the scored initial population
+	parameters:
+		ip: the program's input parameters
+		run: the run to start the engine for
+	returns: nothing
+	notes:
+		The learning rates are the defaults from Hansen's "The CMA Evolution Strategy: A Tutorial", with -p sets sampled per generation and the best half of them weighted into the mean.
+	todo:
+*/
+void cmaes_start (input_params& ip, ga_run& run) {
+	run.cmaes = new cmaes_state(ip.num_dims, ip.population);
+	cmaes_state& cs = *run.cmaes;
+	double n = ip.num_dims;
+	double sum = 0;
+	for (int i = 0; i < cs.mu; i++) {
+		cs.weights[i] = log(cs.mu + 0.5) - log(i + 1.0);
+		sum += cs.weights[i];
+	}
+	double sum_squares = 0;
+	for (int i = 0; i < cs.mu; i++) {
+		cs.weights[i] /= sum;
+		sum_squares += SQUARE(cs.weights[i]);
+	}
+	cs.mueff = 1 / sum_squares;
+	cs.cc = (4 + cs.mueff / n) / (n + 4 + 2 * cs.mueff / n);
+	cs.cs = (cs.mueff + 2) / (n + cs.mueff + 5);
+	cs.c1 = 2 / (SQUARE(n + 1.3) + cs.mueff);
+	cs.cmu = min(1 - cs.c1, 2 * (cs.mueff - 2 + 1 / cs.mueff) / (SQUARE(n + 2) + cs.mueff));
+	cs.damps = 1 + 2 * max(0.0, sqrt((cs.mueff - 1) / (n + 1)) - 1) + cs.cs;
+	cs.chi_n = sqrt(n) * (1 - 1 / (4 * n) + 1 / (21 * SQUARE(n)));
+	cs.sigma = ip.cmaes_sigma;
+	
+	genotype& best = run.population[ip.population];
+	for (int i = 0; i < ip.num_dims; i++) {
+		double width = ip.ranges[i].second - ip.ranges[i].first;
+		cs.mean[i] = width > 0 ? (best.gene[i] - ip.ranges[i].first) / width : 0;
+		cs.pc[i] = 0;
+		cs.ps[i] = 0;
+		cs.D[i] = 1;
+		for (int j = 0; j < ip.num_dims; j++) {
+			cs.C[i * ip.num_dims + j] = i == j ? 1 : 0;
+			cs.B[i * ip.num_dims + j] = i == j ? 1 : 0;
+		}
+	}
+}
+
+/* cmaes_ask samples the next generation from CMA-ES's search distribution
+	parameters:
+		ip: the program's input parameters
+		run: the run
+		count: set to the number of members to score
+	returns: the sampled members, stored over the population
+	notes:
+		Samples past a range are moved onto its bound, and cmaes_tell learns from the moved samples.
+	todo:
+*/
+genotype* cmaes_ask (input_params& ip, ga_run& run, int& count) {
+	cmaes_state& cs = *run.cmaes;
+	const int n = ip.num_dims;
+	double* z = new double[n];
+	for (int k = 0; k < cs.lambda; k++) {
+		genotype& member = run.population[k];
+		for (int j = 0; j < n; j++) {
+			z[j] = cs.D[j] * rng_normal(run.rs.rng);
+		}
+		for (int i = 0; i < n; i++) {
+			double y = 0;
+			for (int j = 0; j < n; j++) {
+				y += cs.B[i * n + j] * z[j];
+			}
+			double x = min(1.0, max(0.0, cs.mean[i] + cs.sigma * y));
+			member.gene[i] = member.lower[i] + x * (member.upper[i] - member.lower[i]);
+		}
+	}
+	delete[] z;
+	count = cs.lambda;
+	return run.population;
+}
+
+/* cmaes_tell moves CMA-ES's search distribution toward the best samples of the scored generation
+	parameters:
+		ip: the program's input parameters
+		run: the run
+		batch: the scored samples
+		count: the number of scored samples
+	returns: nothing
+	notes:
+		The samples are read back from their genes, since scoring may have moved them to fix a broken constraint.
+	todo:
+*/
+void cmaes_tell (input_params& ip, ga_run& run, genotype* batch, int count) {
+	cmaes_state& cs = *run.cmaes;
+	const int n = ip.num_dims;
+	
+	// Rank the samples by score, best first, and convert the best mu to steps from the old mean
+	pair<double, int>* ranked = new pair<double, int>[count];
+	for (int k = 0; k < count; k++) {
+		ranked[k].first = -batch[k].fitness;
+		ranked[k].second = k;
+	}
+	sort(ranked, ranked + count);
+	double* steps = new double[cs.mu * n];
+	for (int k = 0; k < cs.mu; k++) {
+		genotype& member = batch[ranked[k].second];
+		for (int i = 0; i < n; i++) {
+			double width = member.upper[i] - member.lower[i];
+			double x = width > 0 ? (member.gene[i] - member.lower[i]) / width : cs.mean[i];
+			steps[k * n + i] = (x - cs.mean[i]) / cs.sigma;
+		}
+	}
+	delete[] ranked;
+	
+	// Move the mean and update the evolution paths
+	double* yw = new double[n];
+	for (int i = 0; i < n; i++) {
+		yw[i] = 0;
+		for (int k = 0; k < cs.mu; k++) {
+			yw[i] += cs.weights[k] * steps[k * n + i];
+		}
+		cs.mean[i] += cs.sigma * yw[i];
+	}
+	double* t = new double[n];
+	for (int j = 0; j < n; j++) { // t = D^-1 B^T yw, so B t is C^-1/2 yw
+		t[j] = 0;
+		for (int i = 0; i < n; i++) {
+			t[j] += cs.B[i * n + j] * yw[i];
+		}
+		t[j] /= cs.D[j];
+	}
+	double ps_norm = 0;
+	for (int i = 0; i < n; i++) {
+		double whitened = 0;
+		for (int j = 0; j < n; j++) {
+			whitened += cs.B[i * n + j] * t[j];
+		}
+		cs.ps[i] = (1 - cs.cs) * cs.ps[i] + sqrt(cs.cs * (2 - cs.cs) * cs.mueff) * whitened;
+		ps_norm += SQUARE(cs.ps[i]);
+	}
+	ps_norm = sqrt(ps_norm);
+	bool hsig = ps_norm / sqrt(1 - pow(1 - cs.cs, 2.0 * (run.generation + 1))) / cs.chi_n < 1.4 + 2.0 / (n + 1);
+	for (int i = 0; i < n; i++) {
+		cs.pc[i] = (1 - cs.cc) * cs.pc[i] + (hsig ? sqrt(cs.cc * (2 - cs.cc) * cs.mueff) * yw[i] : 0);
+	}
+	
+	// Adapt the covariance matrix with the rank-one and rank-mu updates, then the step size
+	double keep = 1 - cs.c1 - cs.cmu + (hsig ? 0 : cs.c1 * cs.cc * (2 - cs.cc));
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j <= i; j++) {
+			double rank_mu = 0;
+			for (int k = 0; k < cs.mu; k++) {
+				rank_mu += cs.weights[k] * steps[k * n + i] * steps[k * n + j];
+			}
+			double c = keep * cs.C[i * n + j] + cs.c1 * cs.pc[i] * cs.pc[j] + cs.cmu * rank_mu;
+			cs.C[i * n + j] = c;
+			cs.C[j * n + i] = c;
+		}
+	}
+	cs.sigma *= exp((cs.cs / cs.damps) * (ps_norm / cs.chi_n - 1));
+	cs.sigma = min(cs.sigma, 1.0); // Every range is 1 wide here, so larger steps would only pile samples onto the bounds
+	if (run.generation - cs.eigen_generation >= cs.lambda / (cs.c1 + cs.cmu) / n / 10) {
+		cmaes_eigen(cs);
+		cs.eigen_generation = run.generation;
+	}
+	delete[] steps;
+	delete[] yw;
+	delete[] t;
+	keep_best(ip, batch);
+}
+
+/* cmaes_eigen decomposes CMA-ES's covariance matrix into the eigenvectors and scales samples are drawn with
+	parameters:
+		cs: the CMA-ES state, whose B and D are updated from C
+	returns: nothing
+	notes:
+		This uses cyclic Jacobi rotations, which are simple and accurate for the few dozen parameters a model has. Eigenvalues are kept above a tiny floor so rounding cannot make a scale imaginary or zero.
+	todo:
+*/
+void cmaes_eigen (cmaes_state& cs) {
+	const int n = cs.num_dims;
+	double* a = new double[n * n];
+	for (int i = 0; i < n * n; i++) {
+		a[i] = cs.C[i];
+		cs.B[i] = i / n == i % n ? 1 : 0;
+	}
+	for (int sweep = 0; sweep < 50; sweep++) {
+		double off = 0;
+		for (int p = 0; p < n; p++) {
+			for (int q = p + 1; q < n; q++) {
+				off += SQUARE(a[p * n + q]);
+			}
+		}
+		if (off < 1e-30) {
+			break;
+		}
+		for (int p = 0; p < n; p++) {
+			for (int q = p + 1; q < n; q++) {
+				double apq = a[p * n + q];
+				if (fabs(apq) < 1e-300) {
+					continue;
+				}
+				double theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+				double tangent = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(SQUARE(theta) + 1));
+				double c = 1 / sqrt(SQUARE(tangent) + 1);
+				double s = tangent * c;
+				for (int k = 0; k < n; k++) {
+					double akp = a[k * n + p];
+					double akq = a[k * n + q];
+					a[k * n + p] = c * akp - s * akq;
+					a[k * n + q] = s * akp + c * akq;
+				}
+				for (int k = 0; k < n; k++) {
+					double apk = a[p * n + k];
+					double aqk = a[q * n + k];
+					a[p * n + k] = c * apk - s * aqk;
+					a[q * n + k] = s * apk + c * aqk;
+				}
+				for (int k = 0; k < n; k++) {
+					double bkp = cs.B[k * n + p];
+					double bkq = cs.B[k * n + q];
+					cs.B[k * n + p] = c * bkp - s * bkq;
+					cs.B[k * n + q] = s * bkp + c * bkq;
+				}
+			}
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		cs.D[i] = sqrt(max(a[i * n + i], 1e-20));
+	}
+	delete[] a;
+}
+
@@ -17,44 +17,336 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 /*
-ga.cpp contains function to interact with the genetic algorithm library.
+ga.cpp contains functions to start, advance, and run the genetic algorithm built from the operators in galib.cpp.
 Avoid placing I/O functions here and add them to io.cpp instead.
 */
 
+#include <new> // Needed for placement new
+
 #include "ga.hpp" // Function declarations
 
-#include "galib.cpp"
+#include "engines.hpp"
+#include "galib.hpp"
+#include "init.hpp"
 #include "io.hpp"
+#include "macros.hpp"
+#include "memory.hpp"
+#include "metrics.hpp"
+#include "packed.hpp"
+#include "random.hpp"
+#include "surrogate.hpp"
+#include "tasks.hpp"
+#include "trace.hpp"
 
 extern terminal* term; // Declared in init.cpp
 
-void run_ga (input_params& ip) {
+const char* budget_reason(input_params&, run_state&);
+const char* stop_reason(input_params&, run_state&, ga_operators&, genotype*, int);
+void map_packed_arena(input_params&, ga_run&);
+void map_population_arena(input_params&, ga_run&, int);
+genotype* carve_genotypes(char*&, int);
+
+/* budget_reason checks whether the run's time or evaluation budget has run out
+	parameters:
+		ip: the program's input parameters
+		rs: the state of the run
+	returns: a message describing which budget ran out, or NULL if neither has
+	notes:
+		simulate_batch enforces the budgets within a generation, so a run that runs out stops with some members unscored instead of overrunning its allocation by a generation.
+	todo:
+*/
+const char* budget_reason (input_params& ip, run_state& rs) {
+	if (ip.eval_budget > 0 && rs.evaluations >= ip.eval_budget) {
+		return "the evaluation budget was exhausted";
+	}
+	if (ip.time_budget > 0 && wall_time() - rs.start_time >= ip.time_budget) {
+		return "the time budget was exhausted";
+	}
+	return NULL;
+}
+
+/* stop_reason checks the user's stopping rules after a generation has been evaluated
+	parameters:
+		ip: the program's input parameters
+		rs: the state of the run
+		ops: the genetic algorithm operators specialized for the run's dimensions
+		population: the population, with the best member stored after the last one
+		generation: the generation that just finished
+	returns: a message describing why the run should stop, or NULL if it should continue
+	notes:
+		The best score's improvement is tracked here, so this must be called exactly once per generation.
+	todo:
+*/
+const char* stop_reason (input_params& ip, run_state& rs, ga_operators& ops, genotype* population, int generation) {
+	if (population[ip.population].fitness > rs.best_score) {
+		rs.best_score = population[ip.population].fitness;
+		rs.last_improvement = generation;
+	}
+	if (ip.target_score >= 0 && rs.best_score >= ip.target_score) {
+		return "the target score was reached";
+	}
+	if (ip.stall_generations > 0 && generation - rs.last_improvement >= ip.stall_generations) {
+		return "the best score stopped improving";
+	}
+	if (ip.min_diversity > 0 && ops.diversity(ip, population) < ip.min_diversity) {
+		return "the population's diversity fell below the minimum";
+	}
+	return budget_reason(ip, rs);
+}
+
+/* map_population_arena maps one arena for all of a run's members and carves the populations out of it
+	parameters:
+		ip: the program's input parameters
+		run: the run to map the arena for
+		num_candidates: the number of initial candidates to make room for, or 0 if the initial population is not oversampled
+	returns: nothing
+	notes:
+		Every member's variables start on a cache line and the member headers are packed together ahead of them, so populations of millions of members take one mapping rather than three allocations each, and the memory used is known as soon as the run starts.
+	todo:
+*/
+void map_population_arena (input_params& ip, ga_run& run, int num_candidates) {
+	int stride = (ip.num_dims * sizeof(double) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE / sizeof(double); // Each member's gene, upper, and lower arrays take this many doubles
+	size_t num_members = 2 * (size_t)(ip.population + 1) + num_candidates;
+	size_t headers_size = (num_members * sizeof(genotype) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+	size_t size = headers_size + num_members * 3 * stride * sizeof(double);
+	bool huge;
+	run.arena = map_arena(size, &run.arena_size, &huge);
+	term->verbose() << term->blue << "Mapped " << term->reset << run.arena_size / SQUARE(1024.0) << " MB for the population arena" << (huge ? " in huge pages" : "") << endl;
+	
+	char* headers = (char*)run.arena;
+	char* storage = headers + headers_size;
+	run.population = carve_genotypes(headers, ip.population + 1);
+	run.newpopulation = carve_genotypes(headers, ip.population + 1);
+	run.candidates = num_candidates > 0 ? carve_genotypes(headers, num_candidates) : NULL;
+	for (size_t i = 0; i < num_members; i++) {
+		((genotype*)run.arena)[i].attach((double*)storage + i * 3 * stride, stride, ip.num_dims);
+	}
+}
+
+/* map_packed_arena maps one arena for a run kept in the quantized encoding and carves the population and its packed genes out of it
+	parameters:
+		ip: the program's input parameters
+		run: the run to map the arena for
+	returns: nothing
+	notes:
+		Only the best member after the last keeps its variables as doubles. The other members' headers hold just their fitness, while their genes live in the packed codes, so the arena takes a fraction of the memory map_population_arena maps.
+	todo:
+*/
+void map_packed_arena (input_params& ip, ga_run& run) {
+	run.packed = create_packed(ip, ip.population + 1);
+	size_t num_members = (size_t)ip.population + 1;
+	size_t headers_size = (num_members * sizeof(genotype) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+	size_t codes_size = (packed_size(run.packed) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+	size_t size = headers_size + 3 * ip.num_dims * sizeof(double) + 2 * codes_size;
+	bool huge;
+	run.arena = map_arena(size, &run.arena_size, &huge);
+	term->verbose() << term->blue << "Mapped " << term->reset << run.arena_size / SQUARE(1024.0) << " MB for the population arena" << (huge ? " in huge pages" : "") << " with " << run.packed->bits << "-bit genes" << endl;
+	
+	char* headers = (char*)run.arena;
+	char* storage = headers + headers_size;
+	run.population = carve_genotypes(headers, ip.population + 1);
+	run.newpopulation = NULL;
+	run.candidates = NULL;
+	run.population[ip.population].attach((double*)storage, ip.num_dims, ip.num_dims);
+	storage += 3 * ip.num_dims * sizeof(double);
+	run.packed->codes = storage;
+	run.packed->spare = storage + codes_size;
+	ip.packed = run.packed;
+}
+
+/* carve_genotypes constructs the given number of members at the given position in an arena
+	parameters:
+		next: the position to construct the members at, which is advanced past them
+		count: the number of members
+	returns: the first member constructed
+	notes:
+		The members' variables are attached by map_population_arena once every member has been constructed.
+	todo:
+*/
+genotype* carve_genotypes (char*& next, int count) {
+	genotype* members = (genotype*)next;
+	for (int i = 0; i < count; i++) {
+		new (members + i) genotype();
+	}
+	next += count * sizeof(genotype);
+	return members;
+}
+
+/* start_run creates the initial population of a run and evaluates it
+	parameters:
+		ip: the program's input parameters
+		run: the run to start
+	returns: nothing
+	notes:
+		Nothing is printed here, so the library can start runs silently; run_ga prints the progress.
+	todo:
+*/
+void start_run (input_params& ip, ga_run& run) {
+	run_state& rs = run.rs;
+	rs.start_time = wall_time();
+	ip.budget_deadline = ip.time_budget > 0 ? rs.start_time + ip.time_budget : 0;
+	ip.usage = resource_usage();
+	rng_seed(rs.rng, ip.seed, 0);
+	run.ops = ip.encoding == ENCODING_QUANTIZED ? packed_operators() : choose_operators(ip.num_dims);
+	run.engine = choose_engine(ip.engine);
+	if (ip.engine != ENGINE_GA) {
+		term->verbose() << term->blue << "Using " << term->reset << "the " << run.engine.name << " engine" << endl;
+	}
+	ga_operators& ops = run.ops;
+	if (ops.dims > 0) {
+		term->verbose() << term->blue << "Using " << term->reset << "operators specialized for " << ops.dims << " dimensions" << endl;
+	}
+	init_tasks(ip);
+	if (ip.tasks != NULL) {
+		term->verbose() << term->blue << "Running " << term->reset << "the operators on " << ip.tasks->num_started + 1 << " threads" << endl;
+	}
+	init_surrogate(ip, rs);
+	int num_candidates = ip.init_oversample > 1 ? ip.population * ip.init_oversample : 0;
+	if (ip.encoding == ENCODING_QUANTIZED) {
+		map_packed_arena(ip, run);
+	} else {
+		map_population_arena(ip, run, num_candidates);
+	}
+	genotype* population = run.population;
+	if (ip.encoding == ENCODING_QUANTIZED) {
+		initialize_packed(ip, rs, population);
+		double start = wall_time();
+		ops.evaluate(ip, rs, population, ip.population);
+		trace_phase(ip, "evaluate", start);
+	} else if (num_candidates > 0) { // Simulate extra candidates and keep only the best
+		genotype* candidates = run.candidates;
+		initialize(ip, rs, candidates, num_candidates);
+		if (ip.seed_population_file != NULL) {
+			seed_population(ip, rs, candidates, num_candidates);
+		}
+		double start = wall_time();
+		ops.evaluate(ip, rs, candidates, num_candidates);
+		trace_phase(ip, "evaluate", start);
+		ops.select_best(ip, candidates, num_candidates, population);
+	} else {
+		initialize(ip, rs, population, ip.population);
+		if (ip.seed_population_file != NULL) {
+			seed_population(ip, rs, population, ip.population);
+		}
+		double start = wall_time();
+		ops.evaluate(ip, rs, population, ip.population);
+		trace_phase(ip, "evaluate", start);
+	}
+	ops.keep_the_best(ip, population);
+	run.engine.start(ip, run);
+	rs.best_score = population[ip.population].fitness;
+	run.generation = 0;
+	run.stop_reason = budget_reason(ip, rs);
+	publish_metrics(ip, rs, 0, run.arena_size);
+}
+
+/* step_run runs one generation of a started run
+	parameters:
+		ip: the program's input parameters
+		run: the run to advance
+	returns: true if the run should continue, false if it has run every generation or a stopping rule was met
+	notes:
+		The run's engine proposes the generation's members and is told their scores, which the evaluate operator computes whatever the engine. The reason a stopping rule was met is stored in the run. Nothing is printed here.
+	todo:
+*/
+bool step_run (input_params& ip, ga_run& run) {
+	if (run.stop_reason != NULL || run.generation >= ip.generations) {
+		return false;
+	}
+	run_state& rs = run.rs;
+	ga_operators& ops = run.ops;
+	genotype* population = run.population;
+	ip.usage = resource_usage();
+	int count;
+	genotype* batch = run.engine.ask(ip, run, count);
+	double start = wall_time();
+	ops.evaluate(ip, rs, batch, count);
+	trace_phase(ip, "evaluate", start);
+	run.engine.tell(ip, run, batch, count);
+	if (ip.local_search != LOCAL_NONE) {
+		start = wall_time();
+		ops.refine(ip, rs, population);
+		trace_phase(ip, "refine", start);
+	}
+	run.stop_reason = stop_reason(ip, rs, ops, population, run.generation);
+	run.generation++;
+	publish_metrics(ip, rs, run.generation, run.arena_size);
+	return run.stop_reason == NULL && run.generation < ip.generations;
+}
+
+/* run_ga runs the genetic algorithm until it has run the given number of generations or a stopping rule is met, printing its progress
+	parameters:
+		ip: the program's input parameters
+		summary: the run summary to fill in
+	returns: nothing
+	notes:
+	todo:
+*/
+void run_ga (input_params& ip, run_summary& summary) {
 	cout << term->blue << "Running initialization simulations " << term->reset << ". . . ";
 	cout.flush();
 	term->verbose() << endl;
-	genotype population[ip.population + 1];
-	genotype newpopulation[ip.population + 1];
-	for (int i = 0; i < ip.population + 1; i++) {
-		population[i].initialize(ip.num_dims);
-		newpopulation[i].initialize(ip.num_dims);
-	}
-	initialize(ip, population);
-	evaluate(ip, population);
-	keep_the_best(ip, population);
+	ga_run run;
+	start_run(ip, run);
+	summary.usage.add(ip.usage);
+	genotype* population = run.population;
 	cout << term->blue << "Done";
 	term->verbose() << " with initialization simulations";
 	cout << term->reset << endl;
-	for (int generation = 0; generation < ip.generations; generation++) {
-		cout << term->blue << "Running generation " << term->reset << generation << " . . . ";
+	if (run.stop_reason != NULL) {
+		cout << term->blue << "Stopping early " << term->reset << "after the initial population because " << run.stop_reason << endl;
+	}
+	bool running = ip.generations > 0 && run.stop_reason == NULL;
+	while (running) {
+		cout << term->blue << "Running generation " << term->reset << run.generation << " . . . ";
 		cout.flush();
 		term->verbose() << endl;
-		selector(ip, population, newpopulation);
-		crossover(ip, population);
-		mutate(ip, population);
-		evaluate(ip, population);
-		elitist(ip, population);
-		report(generation, ip, population);
+		running = step_run(ip, run);
+		summary.usage.add(ip.usage);
+		double start = wall_time();
+		report(run.generation - 1, ip, run.rs, population);
+		trace_phase(ip, "report", start);
+		if (run.stop_reason != NULL) {
+			cout << term->blue << "Stopping early " << term->reset << "after generation " << run.generation - 1 << " because " << run.stop_reason << endl;
+		}
+	}
+	if (ip.print_good_sets) {
+		ip.good_sets_stream.flush();
 	}
-	cout << term->blue << "Best score: " << term->reset << population[ip.population].fitness << endl;
+	
+	// Report the best set and the run's statistics, and write the checkpoint, whether the run finished or a budget ran out
+	genotype& best = population[ip.population];
+	int* sets = new int[(ip.population + 1) * ip.num_dims];
+	for (int i = 0; i <= ip.population; i++) {
+		genotype& member = i == 0 ? best : population[i - 1];
+		if (ip.packed != NULL) {
+			decode_member(ip, i == 0 ? ip.population : i - 1, sets + i * ip.num_dims);
+			continue;
+		}
+		for (int j = 0; j < ip.num_dims; j++) {
+			sets[i * ip.num_dims + j] = member.gene[j];
+		}
+	}
+	cout << term->blue << "Best score: " << term->reset << best.fitness << endl;
+	cout << term->blue << "Best set: " << term->reset << sets[0];
+	for (int j = 1; j < ip.num_dims; j++) {
+		cout << "," << sets[j];
+	}
+	cout << endl;
+	summary.best_score = best.fitness;
+	summary.generations = run.generation;
+	summary.evaluations = run.rs.evaluations;
+	summary.seconds = wall_time() - run.rs.start_time;
+	summary.stop_reason = run.stop_reason;
+	summary.failures = ip.failures;
+	cout << term->blue << "Ran " << term->reset << summary.generations << " generations and " << summary.evaluations << " simulations in " << summary.seconds << " seconds" << endl;
+	if (run.rs.unscored > 0) {
+		cout << term->yellow << "Left " << term->reset << run.rs.unscored << " sets unscored when the budget ran out" << endl;
+	}
+	print_failures(ip);
+	if (ip.checkpoint_file != NULL) {
+		write_checkpoint(ip, sets, ip.population + 1, best.fitness);
+	}
+	delete[] sets;
+	ip.packed = NULL; // The run owns its packed genes, which go with it
 }
-
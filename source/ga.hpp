@@ -23,9 +23,12 @@ ga.hpp contains function declarations for ga.cpp.
 #ifndef GA_HPP
 #define GA_HPP
 
+#include "galib.hpp"
 #include "structs.hpp"
 
-void run_ga(input_params&);
+void start_run(input_params&, ga_run&);
+bool step_run(input_params&, ga_run&);
+void run_ga(input_params&, run_summary&);
 
 #endif
 
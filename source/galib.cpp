@@ -20,99 +20,428 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 galib.cpp contains the genetic algorithm library taken from http://people.sc.fsu.edu/~jburkardt/cpp_src/simple_ga/simple_ga.html and modified as needed.
 */
 
+#include <algorithm> // Needed for sort
 #include <cmath> // Needed for sqrt
 
+#include "galib.hpp" // Function declarations
+
+#include "constraints.hpp"
+#include "design.hpp"
+#include "hash.hpp"
 #include "io.hpp"
+#include "kernels.hpp"
+#include "libga.hpp"
+#include "macros.hpp"
+#include "random.hpp"
+#include "surrogate.hpp"
+#include "tasks.hpp"
+#include "workers.hpp"
 
 using namespace std;
 
 extern terminal* term; // Declared in init.cpp
 
+template <int DIMS> void copy_back_chunk(void*, int);
+template <int DIMS> void copy_genotype(genotype&, const genotype&, int);
+template <int DIMS> void crossover(input_params&, run_state&, genotype*);
+template <int DIMS> void crossover_chunk(void*, int);
+template <int DIMS> void deviation_chunk(void*, int);
+template <int DIMS> double chunked_diversity(input_params&, genotype*);
+template <int DIMS> double diversity(input_params&, genotype*);
+template <int DIMS> void elitist(input_params&, genotype*);
+template <int DIMS> void evaluate(input_params&, run_state&, genotype*, int);
+template <int DIMS> void keep_the_best(input_params&, genotype*);
+template <int DIMS> void mean_chunk(void*, int);
+template <int DIMS> void mutate(input_params&, run_state&, genotype*);
+template <int DIMS> void mutate_chunk(void*, int);
+template <int DIMS> void refine(input_params&, run_state&, genotype*);
+template <int DIMS> void select_best(input_params&, genotype*, int, genotype*);
+template <int DIMS> void select_chunk(void*, int);
+template <int DIMS> void selector(input_params&, run_state&, genotype*, genotype*);
+template <int DIMS> ga_operators specialize();
+template <int DIMS> void Xover(int, int, input_params&, rng_state&, genotype*);
+static void chunk_members(input_params&, int, int&, int&);
+static int count_chunks(input_params&);
+static void cumulative_chunk(void*, int);
+static void extremes_chunk(void*, int);
+static void fitness_chunk(void*, int);
+static double fitness_sums(input_params&, genotype*, double*);
+static int score_sets(input_params&, run_state&, int*, int, double*, bool*);
+static void enforce_constraints(input_params&, run_state&, int*, int, bool*, bool*);
+
 //
-//  Each GENOTYPE is a member of the population, with
-//  gene: a string of variables,
-//  fitness: the fitness
-//  upper: the variable upper bounds,
-//  lower: the variable lower bounds,
-//  rfitness: the relative fitness,
-//  cfitness: the cumulative fitness.
-//
-struct genotype {
-	double* gene;
-	double fitness;
-	double* upper;
-	double* lower;
-	double rfitness;
-	double cfitness;
-	int num_dims;
-	
-	genotype () {
-		this->gene = NULL;
-		this->fitness = 0;
-		this->upper = NULL;
-		this->lower = NULL;
-		this->rfitness = 0;
-		this->cfitness = 0;
-	}
-	
-	void initialize (int num_dims) {
-		this->gene = new double[num_dims];
-		this->upper = new double[num_dims];
-		this->lower = new double[num_dims];
-		memset(this->gene, 0, sizeof(double) * num_dims);
-		memset(this->upper, 0, sizeof(double) * num_dims);
-		memset(this->lower, 0, sizeof(double) * num_dims);
-		this->num_dims = num_dims;
-	}
-	
-	~genotype () {
-		delete[] this->gene;
-		delete[] this->upper;
-		delete[] this->lower;
-	}
-	
-	genotype& operator= (const genotype& g) {
-		this->fitness = g.fitness;
-		this->rfitness = g.rfitness;
-		this->cfitness = g.cfitness;
-		for (int i = 0; i < this->num_dims; i++) {
-			this->gene[i] = g.gene[i];
-			this->upper[i] = g.upper[i];
-			this->lower[i] = g.lower[i];
-		}
-		return *this;
-	}
-};
-
-void crossover(input_params&, genotype*);
-void elitist(input_params&, genotype*);
-void evaluate(input_params&, genotype*);
-void initialize(input_params&, genotype*);
-void keep_the_best(input_params&, genotype*);
-void mutate(input_params&, genotype*);
-void r8_swap(double*, double*);
-double randval(double, double);
-void report(int);
-void selector(input_params&, genotype*, genotype*);
-void Xover(int, int, input_params&, genotype*);
-
-void crossover (input_params& ip, genotype* population) {
+//  DIMS_OF returns the number of variables for the DIMS specialization.
+//
+template <int DIMS>
+inline int dims_of ( input_params& ip )
+{
+  return 0 < DIMS ? DIMS : ip.num_dims;
+}
+
+ga_operators choose_operators ( int num_dims )
+{
+  switch ( num_dims )
+  {
+    case 3:
+      return specialize<3> ( );
+    case 45:
+      return specialize<45> ( );
+    default:
+      return specialize<0> ( );
+  }
+}
+
+template <int DIMS>
+ga_operators specialize ( )
+{
+  ga_operators ops;
+
+  ops.dims = DIMS;
+  ops.crossover = crossover<DIMS>;
+  ops.diversity = diversity<DIMS>;
+  ops.elitist = elitist<DIMS>;
+  ops.evaluate = evaluate<DIMS>;
+  ops.keep_the_best = keep_the_best<DIMS>;
+  ops.mutate = mutate<DIMS>;
+  ops.refine = refine<DIMS>;
+  ops.select_best = select_best<DIMS>;
+  ops.selector = selector<DIMS>;
+
+  return ops;
+}
+
+//
+//  COPY_GENOTYPE copies one member over another.
+//
+template <int DIMS>
+void copy_genotype ( genotype& to, const genotype& from, int num_dims )
+{
+  int i;
+
+  to.fitness = from.fitness;
+  to.rfitness = from.rfitness;
+  to.cfitness = from.cfitness;
+  for ( i = 0; i < ( 0 < DIMS ? DIMS : num_dims ); i++ )
+  {
+    to.gene[i] = from.gene[i];
+    to.upper[i] = from.upper[i];
+    to.lower[i] = from.lower[i];
+  }
+}
+
+//
+//  COUNT_CHUNKS returns the number of chunks a pass over the population is
+//  split into when the operators run on several threads, and
+//  CHUNK_MEMBERS the first member of a chunk and one past its last.
+//
+static int count_chunks ( input_params& ip )
+{
+  return ( ip.population + GA_CHUNK_MEMBERS - 1 ) / GA_CHUNK_MEMBERS;
+}
+
+static void chunk_members ( input_params& ip, int chunk, int& first, int& last )
+{
+  first = chunk * GA_CHUNK_MEMBERS;
+  last = min ( first + GA_CHUNK_MEMBERS, ip.population );
+}
+
+//
+//  COPY_BACK_CHUNK copies a chunk of the selector's survivors back into
+//  the population.
+//
+template <int DIMS>
+void copy_back_chunk ( void* arg, int chunk )
+{
+  member_pass* pass = ( member_pass* ) arg;
+  int first;
+  int i;
+  int last;
+
+  chunk_members ( *pass->ip, chunk, first, last );
+  for ( i = first; i < last; i++ )
+  {
+    copy_genotype<DIMS> ( pass->population[i], pass->newpopulation[i], pass->ip->num_dims );
+  }
+}
+
+//
+//  CROSSOVER_CHUNK crosses over the members of a chunk chosen for
+//  crossover, pairing them within the chunk, with the chunk's own
+//  random number stream.
+//
+template <int DIMS>
+void crossover_chunk ( void* arg, int chunk )
+{
+  member_pass* pass = ( member_pass* ) arg;
+  input_params& ip = *pass->ip;
+  int first;
+  int last;
+  int mem;
+  int one;
+  int chosen = 0;
+  double x[GA_CHUNK_MEMBERS];
+  rng_state rng;
+
+  rng_seed ( rng, pass->seed, chunk + 1 );
+  chunk_members ( ip, chunk, first, last );
+  rng_fill ( rng, x, last - first );
+  one = first;
+  for ( mem = first; mem < last; mem++ )
+  {
+    if ( x[mem - first] < ip.prob_crossover )
+    {
+      chosen++;
+      if ( chosen % 2 == 0 )
+      {
+        Xover<DIMS> ( one, mem, ip, rng, pass->population );
+      }
+      else
+      {
+        one = mem;
+      }
+    }
+  }
+}
+
+//
+//  CUMULATIVE_CHUNK computes the relative and cumulative fitness of a
+//  chunk, starting from the cumulative fitness of the chunks before it.
+//
+static void cumulative_chunk ( void* arg, int chunk )
+{
+  member_pass* pass = ( member_pass* ) arg;
+  genotype* population = pass->population;
+  int first;
+  int i;
+  int last;
+  double cumulative = pass->offsets[chunk];
+
+  chunk_members ( *pass->ip, chunk, first, last );
+  for ( i = first; i < last; i++ )
+  {
+    population[i].rfitness = population[i].fitness / pass->total;
+    cumulative = cumulative + population[i].rfitness;
+    population[i].cfitness = cumulative;
+  }
+}
+
+//
+//  DEVIATION_CHUNK sums the squared deviations of a chunk's variables from
+//  their means, stored in the pass's offsets.
+//
+template <int DIMS>
+void deviation_chunk ( void* arg, int chunk )
+{
+  member_pass* pass = ( member_pass* ) arg;
+  input_params& ip = *pass->ip;
+  int first;
+  int i;
+  int j;
+  int last;
+  const int num_dims = dims_of<DIMS> ( ip );
+
+  chunk_members ( ip, chunk, first, last );
+  for ( j = 0; j < num_dims; j++ )
+  {
+    pass->squares[chunk * num_dims + j] = 0.0;
+    for ( i = first; i < last; i++ )
+    {
+      pass->squares[chunk * num_dims + j] = pass->squares[chunk * num_dims + j] + SQUARE ( pass->population[i].gene[j] - pass->offsets[j] );
+    }
+  }
+}
+
+//
+//  EXTREMES_CHUNK finds a chunk's best and worst members, taking the last
+//  of any ties like ELITIST does.
+//
+static void extremes_chunk ( void* arg, int chunk )
+{
+  member_pass* pass = ( member_pass* ) arg;
+  genotype* population = pass->population;
+  int best;
+  int first;
+  int i;
+  int last;
+  int worst;
+
+  chunk_members ( *pass->ip, chunk, first, last );
+  best = first;
+  worst = first;
+  for ( i = first; i < last; i++ )
+  {
+    if ( population[best].fitness <= population[i].fitness )
+    {
+      best = i;
+    }
+    if ( population[i].fitness <= population[worst].fitness )
+    {
+      worst = i;
+    }
+  }
+  pass->best[chunk] = best;
+  pass->worst[chunk] = worst;
+}
+
+//
+//  FITNESS_CHUNK sums a chunk's fitness and squared fitness.
+//
+static void fitness_chunk ( void* arg, int chunk )
+{
+  member_pass* pass = ( member_pass* ) arg;
+  genotype* population = pass->population;
+  int first;
+  int i;
+  int last;
+  double sum = 0.0;
+  double sum_square = 0.0;
+
+  chunk_members ( *pass->ip, chunk, first, last );
+  for ( i = first; i < last; i++ )
+  {
+    sum = sum + population[i].fitness;
+    sum_square = sum_square + population[i].fitness * population[i].fitness;
+  }
+  pass->sums[chunk] = sum;
+  pass->squares[chunk] = sum_square;
+}
+
+//
+//  FITNESS_SUMS returns the population's total fitness and stores its total
+//  squared fitness, summing the chunks on the operators' threads.
+//
+static double fitness_sums ( input_params& ip, genotype* population, double* sum_square )
+{
+  int c;
+  int chunks = count_chunks ( ip );
+  double sum = 0.0;
+  member_pass pass ( ip, population, chunks );
+
+  run_tasks ( ip.tasks, chunks, fitness_chunk, &pass );
+  *sum_square = 0.0;
+  for ( c = 0; c < chunks; c++ )
+  {
+    sum = sum + pass.sums[c];
+    *sum_square = *sum_square + pass.squares[c];
+  }
+  return sum;
+}
+
+//
+//  MEAN_CHUNK sums each of a chunk's variables.
+//
+template <int DIMS>
+void mean_chunk ( void* arg, int chunk )
+{
+  member_pass* pass = ( member_pass* ) arg;
+  input_params& ip = *pass->ip;
+  int first;
+  int i;
+  int j;
+  int last;
+  const int num_dims = dims_of<DIMS> ( ip );
+
+  chunk_members ( ip, chunk, first, last );
+  for ( j = 0; j < num_dims; j++ )
+  {
+    pass->sums[chunk * num_dims + j] = 0.0;
+    for ( i = first; i < last; i++ )
+    {
+      pass->sums[chunk * num_dims + j] = pass->sums[chunk * num_dims + j] + pass->population[i].gene[j];
+    }
+  }
+}
+
+//
+//  MUTATE_CHUNK mutates a chunk's members with the chunk's own random
+//  number stream.
+//
+template <int DIMS>
+void mutate_chunk ( void* arg, int chunk )
+{
+  member_pass* pass = ( member_pass* ) arg;
+  input_params& ip = *pass->ip;
+  genotype* population = pass->population;
+  int first;
+  int i;
+  int j;
+  int last;
+  const int num_dims = dims_of<DIMS> ( ip );
+  double draws[num_dims];
+  double candidates[num_dims];
+  rng_state rng;
+
+  rng_seed ( rng, pass->seed, chunk + 1 );
+  chunk_members ( ip, chunk, first, last );
+  for ( i = first; i < last; i++ )
+  {
+    rng_fill ( rng, draws, num_dims );
+    rng_fill ( rng, candidates, num_dims );
+    for ( j = 0; j < num_dims; j++ )
+    {
+      candidates[j] = population[i].lower[j] + candidates[j] * ( population[i].upper[j] - population[i].lower[j] );
+    }
+    mutate_row ( population[i].gene, draws, candidates, ip.prob_mutation, num_dims );
+  }
+}
+
+//
+//  SELECT_CHUNK draws a chunk's survivors with the chunk's own random
+//  number stream.
+//
+template <int DIMS>
+void select_chunk ( void* arg, int chunk )
+{
+  member_pass* pass = ( member_pass* ) arg;
+  input_params& ip = *pass->ip;
+  int first;
+  int i;
+  int last;
+  int survivor;
+  rng_state rng;
+
+  rng_seed ( rng, pass->seed, chunk + 1 );
+  chunk_members ( ip, chunk, first, last );
+  for ( i = first; i < last; i++ )
+  {
+    survivor = find_survivor ( ip, pass->population, rng_int ( rng, 1000 ) / 1000.0 );
+    if ( survivor == -1 )
+    {
+      survivor = i;
+    }
+    copy_genotype<DIMS> ( pass->newpopulation[i], pass->population[survivor], ip.num_dims );
+  }
+}
+
+
+template <int DIMS>
+void crossover (input_params& ip, run_state& rs, genotype* population) {
   int mem;
   int one = 0;
   int first = 0;
-  double x;
+//
+//  On several threads, members are paired within their chunk instead.
+//
+  if ( ip.tasks != NULL )
+  {
+    member_pass pass ( ip, population, 1 );
+    pass.seed = rng_next ( rs.rng );
+    run_tasks ( ip.tasks, count_chunks ( ip ), crossover_chunk<DIMS>, &pass );
+    return;
+  }
+  double* x = new double[ip.population];
+
+  rng_fill ( rs.rng, x, ip.population );
 
   for ( mem = 0; mem < ip.population; ++mem )
   {
-    x = ( rand ( ) % 1000 ) / 1000.0;
-
-    if ( x < ip.prob_crossover )
+    if ( x[mem] < ip.prob_crossover )
     {
       ++first;
 
       if ( first % 2 == 0 )
       {
-        Xover (one, mem, ip, population);
+        Xover<DIMS> (one, mem, ip, rs.rng, population);
       }
       else
       {
@@ -121,19 +450,139 @@ void crossover (input_params& ip, genotype* population) {
 
     }
   }
+  delete[] x;
+}
+
+//
+//  The diversity is the standard deviation of each variable across the
+//  population relative to the width of its range, averaged over every
+//  variable with a nonempty range.  CHUNKED_DIVERSITY computes it on the
+//  operators' threads, summing each chunk's variables in parallel.
+//
+template <int DIMS>
+double chunked_diversity ( input_params& ip, genotype* population )
+{
+  int c;
+  int j;
+  int counted = 0;
+  int chunks = count_chunks ( ip );
+  double var;
+  double width;
+  double total = 0.0;
+  const int num_dims = dims_of<DIMS> ( ip );
+  member_pass pass ( ip, population, chunks * num_dims );
+
+  run_tasks ( ip.tasks, chunks, mean_chunk<DIMS>, &pass );
+  for ( j = 0; j < num_dims; j++ )
+  {
+    pass.offsets[j] = 0.0;
+    for ( c = 0; c < chunks; c++ )
+    {
+      pass.offsets[j] = pass.offsets[j] + pass.sums[c * num_dims + j];
+    }
+    pass.offsets[j] = pass.offsets[j] / ip.population;
+  }
+  run_tasks ( ip.tasks, chunks, deviation_chunk<DIMS>, &pass );
+  for ( j = 0; j < num_dims; j++ )
+  {
+    width = ip.ranges[j].second - ip.ranges[j].first;
+    if ( width <= 0 )
+    {
+      continue;
+    }
+    var = 0.0;
+    for ( c = 0; c < chunks; c++ )
+    {
+      var = var + pass.squares[c * num_dims + j];
+    }
+    total = total + sqrt ( var / ip.population ) / width;
+    counted++;
+  }
+
+  if ( counted == 0 )
+  {
+    return 0.0;
+  }
+  return total / counted;
 }
 
+template <int DIMS>
+double diversity (input_params& ip, genotype* population) {
+  int i;
+  int j;
+  int counted = 0;
+  double mean;
+  double var;
+  double width;
+  double total = 0.0;
+  const int num_dims = dims_of<DIMS> ( ip );
+
+  if ( ip.tasks != NULL )
+  {
+    return chunked_diversity<DIMS> ( ip, population );
+  }
+  for ( j = 0; j < num_dims; j++ )
+  {
+    width = ip.ranges[j].second - ip.ranges[j].first;
+    if ( width <= 0 )
+    {
+      continue;
+    }
+    mean = 0.0;
+    for ( i = 0; i < ip.population; i++ )
+    {
+      mean = mean + population[i].gene[j];
+    }
+    mean = mean / ip.population;
+    var = 0.0;
+    for ( i = 0; i < ip.population; i++ )
+    {
+      var = var + SQUARE ( population[i].gene[j] - mean );
+    }
+    total = total + sqrt ( var / ip.population ) / width;
+    counted++;
+  }
+
+  if ( counted == 0 )
+  {
+    return 0.0;
+  }
+  return total / counted;
+}
+
+template <int DIMS>
 void elitist (input_params& ip, genotype* population) {
   int i;
   double best;
   int best_mem = 0;
   double worst;
   int worst_mem = 0;
+  const int num_dims = dims_of<DIMS> ( ip );
 
   best = population[0].fitness;
   worst = population[0].fitness;
 
-  for ( i = 0; i < ip.population - 1; ++i )
+  if ( ip.tasks != NULL )
+  {
+    int c;
+    int chunks = count_chunks ( ip );
+    member_pass pass ( ip, population, chunks );
+    run_tasks ( ip.tasks, chunks, extremes_chunk, &pass );
+    for ( c = 0; c < chunks; c++ )
+    {
+      if ( best <= population[pass.best[c]].fitness )
+      {
+        best = population[pass.best[c]].fitness;
+        best_mem = pass.best[c];
+      }
+      if ( population[pass.worst[c]].fitness <= worst )
+      {
+        worst = population[pass.worst[c]].fitness;
+        worst_mem = pass.worst[c];
+      }
+    }
+  }
+  for ( i = 0; i < ip.population - 1 && ip.tasks == NULL; ++i )
   {
     if ( population[i].fitness > population[i+1].fitness )
     {
@@ -178,7 +627,7 @@ void elitist (input_params& ip, genotype* population) {
 //
   if ( best >= population[ip.population].fitness )
   {
-    for ( i = 0; i < ip.num_dims; i++ )
+    for ( i = 0; i < num_dims; i++ )
     {
       population[ip.population].gene[i] = population[best_mem].gene[i];
     }
@@ -186,7 +635,7 @@ void elitist (input_params& ip, genotype* population) {
   }
   else
   {
-    for ( i = 0; i < ip.num_dims; i++ )
+    for ( i = 0; i < num_dims; i++ )
     {
       population[worst_mem].gene[i] = population[ip.population].gene[i];
     }
@@ -194,135 +643,890 @@ void elitist (input_params& ip, genotype* population) {
   }
 }
 
-void evaluate (input_params& ip, genotype* population) {
-  int member;
+template <int DIMS>
+void evaluate (input_params& ip, run_state& rs, genotype* population, int count) {
+  const int num_dims = dims_of<DIMS> ( ip );
+  int member;
+  int i;
+  int* x;
+  int* sets = new int[count * num_dims];
+  double* fitness = new double[count];
+  bool* changed = new bool[count];
+
+  for ( member = 0; member < count; member++ )
+  {
+    x = sets + member * num_dims;
+    for ( i = 0; i < num_dims; i++ )
+    {
+      x[i] = population[member].gene[i];
+    } 
+  }
+  score_population ( ip, rs, sets, count, fitness, changed );
+  for ( member = 0; member < count; member++ )
+  {
+    population[member].fitness = fitness[member];
+    if ( changed[member] )
+    {
+      x = sets + member * num_dims;
+      for ( i = 0; i < num_dims; i++ )
+      {
+        population[member].gene[i] = x[i];
+      }
+    }
+  }
+  delete[] sets;
+  delete[] fitness;
+  delete[] changed;
+}
+
+//
+//  SCORE_POPULATION scores a population given as one integer set per
+//  member, whatever encoding the caller keeps its genes in.  Members it
+//  changes, by fixing a broken constraint or redrawing a duplicate, are
+//  flagged in CHANGED so the caller can store their new sets.
+//
+void score_population ( input_params& ip, run_state& rs, int* sets, int count, double* fitness, bool* changed )
+{
+  const int num_dims = ip.num_dims;
+  int member;
+  int i;
+  int u;
+  int num_unique;
+  int* x;
+  int b;
+  int n;
+  double worst;
+  double error;
+  bool ready;
+//
+//  The scratch arrays grow with the population, so they are kept on the
+//  heap rather than the stack.
+//
+  int* representative = new int[count];
+  int* unique = new int[count];
+  int* unique_sets = new int[count * num_dims];
+  int* batch = new int[count];
+  int* batch_sets = new int[count * num_dims];
+  bool* chosen = new bool[count];
+  double* predictions = new double[count];
+  double* scores = new double[count];
+  bool* unscored = new bool[count];
+
+  bool* invalid = new bool[count];
+  for ( member = 0; member < count; member++ )
+  {
+    changed[member] = false;
+  }
+//
+//  Members with identical parameters share one simulation.  Optionally
+//  replace the copies with random immigrants to keep the population diverse.
+//
+  rs.duplicates = find_duplicates ( sets, count, num_dims, representative );
+  rs.immigrants = 0;
+  if ( ip.replace_duplicates && 0 < rs.duplicates )
+  {
+    for ( member = 0; member < count; member++ )
+    {
+      if ( representative[member] != member )
+      {
+        x = sets + member * num_dims;
+        for ( i = 0; i < num_dims; i++ )
+        {
+          x[i] = randval ( rs.rng, ip.ranges[i].first, ip.ranges[i].second );
+        }
+        changed[member] = true;
+        rs.immigrants++;
+      }
+    }
+  }
+//
+//  Fix or penalize the members that break a constraint from the ranges
+//  file, immigrants included, so a set known to be invalid never costs a
+//  simulation.  Fixing sets can make new duplicates, so they are found again.
+//
+  enforce_constraints ( ip, rs, sets, count, invalid, changed );
+  if ( 0 < rs.immigrants || 0 < rs.repaired + rs.constrained )
+  {
+    rs.duplicates = find_duplicates ( sets, count, num_dims, representative );
+  }
+
+//
+//  Reuse known scores, e.g. from a seed population, and gather the
+//  remaining distinct sets.
+//
+  num_unique = 0;
+  rs.reused = 0;
+  for ( member = 0; member < count; member++ )
+  {
+    if ( representative[member] == member )
+    {
+      if ( invalid[member] )
+      {
+        fitness[member] = ip.constraint_penalty;
+        continue;
+      }
+      if ( rs.known_scores != NULL && score_table_find ( rs.known_scores, sets + member * num_dims, &fitness[member] ) )
+      {
+        rs.reused++;
+        continue;
+      }
+      unique[num_unique] = member;
+      memcpy ( unique_sets + num_unique * num_dims, sets + member * num_dims, sizeof ( int ) * num_dims );
+      num_unique++;
+    }
+  }
+//
+//  Ask the surrogate model which members are worth simulating.  While it
+//  warms up its predictions are all zero, so they are not held against it.
+//
+  ready = surrogate_ready ( ip, rs.surrogate );
+  rs.simulated = surrogate_screen ( ip, rs, unique_sets, num_unique, chosen, predictions );
+  rs.skipped = num_unique - rs.simulated;
+
+//
+//  Simulate the chosen sets as one batch so they can run at the same time.
+//
+  n = 0;
+  for ( u = 0; u < num_unique; u++ )
+  {
+    if ( chosen[u] )
+    {
+      batch[n] = u;
+      memcpy ( batch_sets + n * num_dims, unique_sets + u * num_dims, sizeof ( int ) * num_dims );
+      n++;
+    }
+  }
+  rs.recalled = score_sets ( ip, rs, batch_sets, n, scores, unscored );
+
+  worst = 1.0;
+  error = 0.0;
+  rs.predicted = 0;
+  for ( b = 0; b < n; b++ )
+  {
+    u = batch[b];
+    member = unique[u];
+    x = batch_sets + b * num_dims;
+    fitness[member] = scores[b];
+    if ( rs.surrogate != NULL && !unscored[b] )
+    {
+      if ( ready )
+      {
+        error = error + fabs ( fitness[member] - predictions[u] );
+        rs.predicted = rs.predicted + 1;
+      }
+      surrogate_add ( rs.surrogate, x, fitness[member] );
+    }
+    if ( fitness[member] < worst )
+    {
+      worst = fitness[member];
+    }
+  }
+  rs.surrogate_error = 0 < rs.predicted ? error / rs.predicted : 0.0;
+//
+//  Skipped members keep their predictions, but never outrank a simulated member.
+//
+  for ( u = 0; u < num_unique; u++ )
+  {
+    if ( !chosen[u] )
+    {
+      fitness[unique[u]] = min ( predictions[u], worst );
+    }
+  }
+//
+//  Fan each representative's score out to its duplicates.
+//
+  for ( member = 0; member < count; member++ )
+  {
+    fitness[member] = fitness[representative[member]];
+  }
+  delete[] representative;
+  delete[] unique;
+  delete[] unique_sets;
+  delete[] batch;
+  delete[] batch_sets;
+  delete[] chosen;
+  delete[] predictions;
+  delete[] scores;
+  delete[] unscored;
+  delete[] invalid;
+}
+
+//
+//  ENFORCE_CONSTRAINTS repairs or redraws each member whose set breaks a
+//  constraint, as the user chose, and flags the members that still break
+//  one so they get the constraint penalty instead of a simulation.  The
+//  members it changes are flagged in CHANGED, which it does not clear.
+//
+static void enforce_constraints ( input_params& ip, run_state& rs, int* sets, int count, bool* invalid, bool* changed )
+{
   int i;
-  int x[ip.num_dims];
+  int member;
+  int attempt;
+  int* x;
+  bool fixed;
 
-  for ( member = 0; member < ip.population; member++ )
+  rs.repaired = 0;
+  rs.constrained = 0;
+  for ( member = 0; member < count; member++ )
   {
-    for ( i = 0; i < ip.num_dims; i++ )
+    invalid[member] = false;
+    x = sets + member * ip.num_dims;
+    if ( ip.constraints == NULL || satisfies_constraints ( ip, x ) )
     {
-      x[i] = population[member].gene[i];
-    } 
-    population[member].fitness = simulate_set(ip, x);
+      continue;
+    }
+    fixed = false;
+    if ( ip.constraint_action == CONSTRAINT_REPAIR )
+    {
+      fixed = repair_set ( ip, x );
+    }
+    else if ( ip.constraint_action == CONSTRAINT_RESAMPLE )
+    {
+      for ( attempt = 0; attempt < CONSTRAINT_MAX_RESAMPLES && !fixed; attempt++ )
+      {
+        for ( i = 0; i < ip.num_dims; i++ )
+        {
+          x[i] = ( int ) randval ( rs.rng, ip.ranges[i].first, ip.ranges[i].second );
+        }
+        fixed = satisfies_constraints ( ip, x );
+      }
+    }
+    changed[member] = true;
+    if ( fixed )
+    {
+      rs.repaired++;
+    }
+    else
+    {
+      invalid[member] = true;
+      rs.constrained++;
+    }
   }
 }
 
-void initialize (input_params& ip, genotype* population) {
+void initialize (input_params& ip, run_state& rs, genotype* population, int count) {
   int i;
   int j;
   double lbound;
   double ubound;
+  double* points = NULL;
+//
+//  Space-filling designs place every member in the unit hypercube first.
+//
+  if ( ip.init_design == DESIGN_SOBOL )
+  {
+    sobol_sequence seq ( ip.num_dims );
+    init_sobol ( seq, rs.rng );
+    points = new double[count * ip.num_dims];
+    for ( j = 0; j < count; j++ )
+    {
+      sobol_point ( seq, j + 1, points + j * ip.num_dims );
+    }
+  }
+  else if ( ip.init_design == DESIGN_LHS )
+  {
+    points = new double[count * ip.num_dims];
+    latin_hypercube ( ip.num_dims, count, points, rs.rng );
+  }
 
   for ( i = 0; i < ip.num_dims; i++ )
   {
     lbound = ip.ranges[i].first;
     ubound = ip.ranges[i].second;
 
-    for ( j = 0; j < ip.population; j++ )
+    for ( j = 0; j < count; j++ )
     {
       population[j].fitness = 0;
       population[j].rfitness = 0;
       population[j].cfitness = 0;
       population[j].lower[i] = lbound;
       population[j].upper[i]= ubound;
-      population[j].gene[i] = randval ( population[j].lower[i], population[j].upper[i] );
+      if ( points == NULL )
+      {
+        population[j].gene[i] = randval ( rs.rng, population[j].lower[i], population[j].upper[i] );
+      }
+      else
+      {
+        population[j].gene[i] = lbound + points[j * ip.num_dims + i] * ( ubound - lbound );
+      }
     }
   }
+
+  delete[] points;
 }
 
+template <int DIMS>
 void keep_the_best (input_params& ip, genotype* population) {
 	int cur_best = 0;
+	const int num_dims = dims_of<DIMS>(ip);
 	for (int mem = 0; mem < ip.population; mem++) {
 		if (population[mem].fitness > population[ip.population].fitness) {
 			cur_best = mem;
 			population[ip.population].fitness = population[mem].fitness;
 		}
 	}
-	for (int i = 0; i < ip.num_dims; i++) {
+	for (int i = 0; i < num_dims; i++) {
 		population[ip.population].gene[i] = population[cur_best].gene[i];
 	}
 }
 
-void mutate (input_params& ip, genotype* population) {
-  double hbound;
+template <int DIMS>
+void mutate (input_params& ip, run_state& rs, genotype* population) {
   int i;
   int j;
-  double lbound;
-  double x;
+  const int num_dims = dims_of<DIMS> ( ip );
+  double draws[num_dims];
+  double candidates[num_dims];
 
+  if ( ip.tasks != NULL )
+  {
+    member_pass pass ( ip, population, 1 );
+    pass.seed = rng_next ( rs.rng );
+    run_tasks ( ip.tasks, count_chunks ( ip ), mutate_chunk<DIMS>, &pass );
+    return;
+  }
   for ( i = 0; i < ip.population; i++ )
   {
-    for ( j = 0; j < ip.num_dims; j++ )
-    {
-      x = rand ( ) % 1000 / 1000.0;
-// 
-//  Find the bounds on the variable to be mutated 
 //
-      if ( x < ip.prob_mutation )
-      {
-        lbound = population[i].lower[j];
-        hbound = population[i].upper[j];  
-        population[i].gene[j] = randval ( lbound, hbound );
-      }
+//  Draw every variable's mutation chance and replacement value in bulk,
+//  then replace the variables whose chance came up.  The same numbers are
+//  drawn whichever kernel is used, so every kernel gives the same result.
+//
+    rng_fill ( rs.rng, draws, num_dims );
+    rng_fill ( rs.rng, candidates, num_dims );
+    for ( j = 0; j < num_dims; j++ )
+    {
+      candidates[j] = population[i].lower[j] + candidates[j] * ( population[i].upper[j] - population[i].lower[j] );
     }
+    mutate_row ( population[i].gene, draws, candidates, ip.prob_mutation, num_dims );
   }
 }
 
-void r8_swap ( double *x, double *y ) {
-  double temp;
-
-  temp = *x;
-  *x = *y;
-  *y = temp;
-}
-
-double randval ( double low, double high ) {
+double randval ( rng_state& rng, double low, double high ) {
   double val;
 
-  val = ( ( double ) ( rand() % 1000 ) / 1000.0 ) 
+  val = ( ( double ) rng_int ( rng, 1000 ) / 1000.0 ) 
     * ( high - low ) + low;
 
   return ( val );
 }
 
-void report (int generation, input_params& ip, genotype* population) {
-  //double avg;
-  double best_val;
+//
+//  REFINE runs a local search around the best members after ELITIST,
+//  moving each one to the best neighbor found until its step shrinks
+//  below one unit or the generation's local search budget is spent.
+//
+//  Every round polls neighbors of all the members still searching at
+//  once, so the round's simulations run in parallel.  Pattern search
+//  polls a step up and down along every variable each round; coordinate
+//  descent polls one variable at a time.  A member's step is halved once
+//  every variable has been polled without improvement.
+//
+template <int DIMS>
+void refine (input_params& ip, run_state& rs, genotype* population) {
+  int e;
   int i;
-  //double square_sum;
-  //double stddev;
-  double sum;
-  double sum_square;
-
-  sum = 0.0;
-  sum_square = 0.0;
+  int j;
+  int k;
+  int n;
+  int d;
+  int num_elites;
+  int width;
+  int value;
+  int budget;
+  int polled;
+  int best;
+  const int num_dims = dims_of<DIMS> ( ip );
+  const int poll = ip.local_search == LOCAL_PATTERN ? num_dims : 1;
 
+  rs.refined = 0;
+  rs.improved = 0;
+  rs.refine_gain = 0.0;
+//
+//  Choose the best distinct members.
+//
+  pair<double, int>* ranked = new pair<double, int>[ip.population];
   for ( i = 0; i < ip.population; i++ )
   {
-    sum = sum + population[i].fitness;
-    sum_square = sum_square + population[i].fitness * population[i].fitness;
+    ranked[i].first = -population[i].fitness;
+    ranked[i].second = i;
+  }
+  sort ( ranked, ranked + ip.population );
+
+  int* elites = new int[ip.local_elites];
+  int* centers = new int[ip.local_elites * num_dims];
+  double* steps = new double[ip.local_elites];
+  int* cursors = new int[ip.local_elites];
+  int* unimproved = new int[ip.local_elites];
+  double* start_scores = new double[ip.local_elites];
+  num_elites = 0;
+  for ( i = 0; i < ip.population && num_elites < ip.local_elites; i++ )
+  {
+    int* center = centers + num_elites * num_dims;
+    genotype& member = population[ranked[i].second];
+    for ( j = 0; j < num_dims; j++ )
+    {
+      center[j] = ( int ) member.gene[j];
+    }
+    for ( e = 0; e < num_elites; e++ )
+    {
+      if ( memcmp ( centers + e * num_dims, center, sizeof ( int ) * num_dims ) == 0 )
+      {
+        break;
+      }
+    }
+    if ( e == num_elites )
+    {
+      elites[num_elites] = ranked[i].second;
+      steps[num_elites] = LOCAL_INITIAL_STEP;
+      cursors[num_elites] = 0;
+      unimproved[num_elites] = 0;
+      start_scores[num_elites] = member.fitness;
+      num_elites++;
+    }
+  }
+//
+//  Poll the neighbors of every searching member, round after round.
+//
+  int* sets = new int[2 * poll * num_elites * num_dims];
+  int* owners = new int[2 * poll * num_elites];
+  int* dims = new int[num_elites];
+  double* scores = new double[2 * poll * num_elites];
+  bool* unscored = new bool[2 * poll * num_elites];
+  budget = ip.local_budget;
+  while ( 0 < budget )
+  {
+    n = 0;
+    for ( e = 0; e < num_elites; e++ )
+    {
+      dims[e] = 0;
+    }
+    for ( e = 0; e < num_elites && n < budget; e++ )
+    {
+      if ( steps[e] == 0.0 )
+      {
+        continue;
+      }
+      int* center = centers + e * num_dims;
+      for ( polled = 0; polled < poll && n + 2 <= budget; polled++ )
+      {
+        d = ( cursors[e] + polled ) % num_dims;
+        width = ip.ranges[d].second - ip.ranges[d].first;
+        for ( k = -1; k <= 1; k = k + 2 )
+        {
+          value = center[d] + k * max ( 1, ( int ) ( steps[e] * width + 0.5 ) );
+          value = max ( ip.ranges[d].first, min ( ip.ranges[d].second, value ) );
+          if ( value != center[d] )
+          {
+            memcpy ( sets + n * num_dims, center, sizeof ( int ) * num_dims );
+            sets[n * num_dims + d] = value;
+            if ( ip.constraints == NULL || satisfies_constraints ( ip, sets + n * num_dims ) )
+            {
+              owners[n] = e;
+              n++;
+            }
+          }
+        }
+      }
+      dims[e] = polled;
+    }
+    if ( n == 0 )
+    {
+      break;
+    }
+    score_sets ( ip, rs, sets, n, scores, unscored );
+    rs.refined = rs.refined + n;
+    budget = budget - n;
+    if ( rs.surrogate != NULL )
+    {
+      for ( j = 0; j < n; j++ )
+      {
+        if ( !unscored[j] )
+        {
+          surrogate_add ( rs.surrogate, sets + j * num_dims, scores[j] );
+        }
+      }
+    }
+//
+//  Move each member to its best neighbor, or halve its step once every
+//  variable has been polled without improvement.
+//
+    for ( e = 0, j = 0; e < num_elites; e++ )
+    {
+      if ( steps[e] == 0.0 )
+      {
+        continue;
+      }
+      best = -1;
+      for ( ; j < n && owners[j] == e; j++ )
+      {
+        if ( scores[j] > population[elites[e]].fitness && ( best == -1 || scores[j] > scores[best] ) )
+        {
+          best = j;
+        }
+      }
+      cursors[e] = ( cursors[e] + dims[e] ) % num_dims;
+      if ( best != -1 )
+      {
+        memcpy ( centers + e * num_dims, sets + best * num_dims, sizeof ( int ) * num_dims );
+        population[elites[e]].fitness = scores[best];
+        unimproved[e] = 0;
+      }
+      else
+      {
+        unimproved[e] = unimproved[e] + dims[e];
+        if ( num_dims <= unimproved[e] )
+        {
+          steps[e] = steps[e] / 2.0;
+          unimproved[e] = 0;
+          for ( d = 0; d < num_dims; d++ )
+          {
+            if ( 1.0 <= steps[e] * ( ip.ranges[d].second - ip.ranges[d].first ) )
+            {
+              break;
+            }
+          }
+          if ( d == num_dims )
+          {
+            steps[e] = 0.0;
+          }
+        }
+      }
+    }
+  }
+//
+//  Feed the improvements back into the population and the best member.
+//
+  for ( e = 0; e < num_elites; e++ )
+  {
+    genotype& member = population[elites[e]];
+    if ( start_scores[e] < member.fitness )
+    {
+      for ( j = 0; j < num_dims; j++ )
+      {
+        member.gene[j] = centers[e * num_dims + j];
+      }
+      rs.improved++;
+      rs.refine_gain = max ( rs.refine_gain, member.fitness - start_scores[e] );
+      if ( population[ip.population].fitness < member.fitness )
+      {
+        copy_genotype<DIMS> ( population[ip.population], member, ip.num_dims );
+      }
+    }
   }
 
-  //avg = sum / ( double ) ip.population;
-  //square_sum = avg * avg * ip.population;
-  //stddev = sqrt ( ( sum_square - square_sum ) / ( ip.population - 1 ) );
+  delete[] ranked;
+  delete[] elites;
+  delete[] centers;
+  delete[] steps;
+  delete[] cursors;
+  delete[] unimproved;
+  delete[] start_scores;
+  delete[] sets;
+  delete[] owners;
+  delete[] dims;
+  delete[] scores;
+  delete[] unscored;
+}
+
+void report (int generation, input_params& ip, run_state& rs, genotype* population) {
+  double avg;
+  double best_val;
+  double square_sum;
+  double stddev;
+  double sum;
+  double sum_square;
+
+  sum = fitness_sums ( ip, population, &sum_square );
+
+  avg = sum / ( double ) ip.population;
+  square_sum = avg * avg * ip.population;
+  stddev = 1 < ip.population ? sqrt ( max ( sum_square - square_sum, 0.0 ) / ( ip.population - 1 ) ) : 0.0;
   best_val = population[ip.population].fitness;
 
   term->verbose() << "  ";
   cout << term->blue << "Done: " << term->reset << "the best score ";
   term->verbose() << "for generation " << generation << " ";
-  cout << "was " << best_val << endl;
+  cout << "was " << best_val;
+  term->verbose() << " (mean " << avg << ", standard deviation " << stddev << ")";
+  cout << endl;
+  if ( 0 < rs.duplicates || 0 < rs.immigrants )
+  {
+    cout << "  " << term->blue << "Duplicates: " << term->reset << rs.duplicates << " of " << ip.population
+      << " sets shared another set's score";
+    if ( ip.replace_duplicates )
+    {
+      cout << " (" << rs.immigrants << " replaced with random immigrants)";
+    }
+    cout << endl;
+  }
+  if ( 0 < rs.reused )
+  {
+    cout << "  " << term->blue << "Reused: " << term->reset << "the known scores of " << rs.reused << " sets instead of simulating them" << endl;
+  }
+  if ( 0 < rs.recalled )
+  {
+    cout << "  " << term->blue << "Score database: " << term->reset << "recalled the scores of " << rs.recalled << " sets an earlier run simulated" << endl;
+  }
+  if ( rs.surrogate != NULL )
+  {
+    cout << "  " << term->blue << "Surrogate: " << term->reset << "simulated " << rs.simulated << " of " << ip.population
+      << " sets (" << rs.skipped << " skipped)";
+    if ( 0 < rs.predicted )
+    {
+      cout << ", mean absolute error " << rs.surrogate_error;
+    }
+    else
+    {
+      cout << ", still warming up";
+    }
+    cout << endl;
+  }
+//
+//  Report how many members broke a constraint.
+//
+  if ( 0 < rs.repaired || 0 < rs.constrained )
+  {
+    cout << "  " << term->blue << "Constraints: " << term->reset << rs.repaired + rs.constrained << " sets broke a constraint, " << rs.repaired << " were "
+      << ( ip.constraint_action == CONSTRAINT_REPAIR ? "repaired" : "redrawn" ) << " and " << rs.constrained
+      << " were given the constraint penalty without simulating them" << endl;
+  }
+//
+//  Report what the local search found.
+//
+  if ( ip.local_search != LOCAL_NONE )
+  {
+    cout << "  " << term->blue << "Local search: " << term->reset << "improved " << rs.improved << " of " << ip.local_elites
+      << " elites with " << rs.refined << " simulations";
+    if ( 0 < rs.improved )
+    {
+      cout << ", the most by " << rs.refine_gain;
+    }
+    cout << endl;
+  }
+//
+//  Report the resources the generation's simulations used.
+//
+  if ( 0 < ip.usage.simulations )
+  {
+    resource_usage& u = ip.usage;
+    cout << "  " << term->blue << "Resources: " << term->reset << u.user_seconds + u.system_seconds << " CPU seconds ("
+      << u.user_seconds << " user, " << u.system_seconds << " system) over " << u.simulations << " simulations, peak memory "
+      << u.max_rss << " KB, " << u.in_blocks << " blocks read and " << u.out_blocks << " written" << endl;
+  }
+//
+//  Report the concurrency limit and how it changed since the last report.
+//
+  if ( ip.controller != NULL )
+  {
+    concurrency_controller* c = ip.controller;
+    cout << "  " << term->blue << "Concurrency: " << term->reset << "up to " << c->limit << " simulations in flight";
+    if ( 0 < c->raised || 0 < c->lowered )
+    {
+      cout << " (raised " << c->raised << " and lowered " << c->lowered << " times, last because " << c->last_reason << ")";
+    }
+    cout << endl;
+    c->raised = 0;
+    c->lowered = 0;
+  }
+}
+
+//
+//  SELECT_BEST copies the best members of a pool of candidates into the
+//  population, e.g. to keep the best of an oversampled initialization.
+//
+template <int DIMS>
+void select_best (input_params& ip, genotype* candidates, int count, genotype* population) {
+  int i;
+  pair<double, int>* ranked = new pair<double, int>[count];
+
+  for ( i = 0; i < count; i++ )
+  {
+    ranked[i].first = -candidates[i].fitness;
+    ranked[i].second = i;
+  }
+  sort ( ranked, ranked + count );
+
+  for ( i = 0; i < ip.population; i++ )
+  {
+    copy_genotype<DIMS> ( population[i], candidates[ranked[i].second], ip.num_dims );
+  }
+  delete[] ranked;
+}
+
+//
+//  SCORE_SETS scores a batch of sets with the user's evaluator or by
+//  simulating them within the run's budgets, counts the simulations toward
+//  the run's evaluations, and returns the number of scores recalled from
+//  the score database.  Sets a budget left unscored score 0 and are
+//  flagged in UNSCORED, so they are never mistaken for observations.
+//  Every simulation launched counts as an evaluation, retries included.
+//
+static int score_sets ( input_params& ip, run_state& rs, int* sets, int count, double* scores, bool* unscored_sets )
+{
+  int recalled = 0;
+  int unscored = 0;
+
+  if ( ip.evaluator != NULL )
+  {
+    run_evaluator ( ip, sets, count, scores );
+    memset ( unscored_sets, 0, sizeof ( bool ) * count );
+    rs.evaluations = rs.evaluations + count;
+  }
+  else
+  {
+    ip.budget_simulations = 0 < ip.eval_budget ? max ( ip.eval_budget - rs.evaluations, 0 ) : -1;
+    recalled = count - simulate_batch ( ip, sets, count, scores, unscored_sets );
+    unscored = ip.unscored;
+    recalled = recalled - unscored;
+    rs.evaluations = rs.evaluations + ip.launches;
+  }
+  rs.unscored = rs.unscored + unscored;
+
+  return recalled;
 }
 
-void selector (input_params& ip, genotype* population, genotype* newpopulation) {
+//
+//  SEED_POPULATION replaces members with the sets from an earlier run's
+//  good sets file, best scored first, and remembers the scores that can
+//  be reused so those sets are not simulated again.
+//
+void seed_population (input_params& ip, run_state& rs, genotype* population, int count) {
   int i;
   int j;
+  int n;
+  int slot;
+  int* set;
+  score_table* seeds;
+  pair<double, int>* ranked;
+
+  seeds = read_seed_population ( ip );
+  ranked = new pair<double, int>[seeds->size + 1];
+
+  n = 0;
+  for ( slot = 0; slot < seeds->capacity; slot++ )
+  {
+    if ( seeds->used[slot] )
+    {
+      ranked[n].first = -seeds->scores[slot];
+      ranked[n].second = slot;
+      n++;
+    }
+  }
+  sort ( ranked, ranked + n );
+  n = min ( n, count );
+
+  for ( i = 0; i < n; i++ )
+  {
+    slot = ranked[i].second;
+    set = seeds->sets + slot * ip.num_dims;
+    for ( j = 0; j < ip.num_dims; j++ )
+    {
+      population[i].gene[j] = set[j];
+    }
+    if ( 0 <= seeds->scores[slot] )
+    {
+      if ( rs.known_scores == NULL )
+      {
+        rs.known_scores = new score_table ( ip.num_dims );
+      }
+      score_table_insert ( rs.known_scores, set, seeds->scores[slot] );
+      if ( rs.surrogate != NULL )
+      {
+        surrogate_add ( rs.surrogate, set, seeds->scores[slot] );
+      }
+    }
+  }
+
+  cout << term->blue << "Seeded " << term->reset << n << " of " << count << " initial members from " << ip.seed_population_file;
+  if ( rs.known_scores != NULL )
+  {
+    cout << " (" << rs.known_scores->size << " with reusable scores)";
+  }
+  cout << endl;
+
+  delete[] ranked;
+  delete seeds;
+}
+
+//
+//  FIND_SURVIVOR returns the member whose share of the cumulative fitness
+//  P falls in, or -1 if P is past the last member's.
+//
+int find_survivor ( input_params& ip, genotype* population, double p )
+{
+  int hi;
+  int j;
+  int lo;
+
+  if ( p < population[0].cfitness )
+  {
+    return 0;
+  }
+//
+//  The cumulative fitness never decreases, so binary search for the
+//  first member whose cumulative fitness exceeds P rather than scanning
+//  the whole population for every survivor.
+//
+  lo = 1;
+  hi = ip.population;
+  while ( lo < hi )
+  {
+    j = lo + ( hi - lo ) / 2;
+    if ( p < population[j].cfitness )
+    {
+      hi = j;
+    }
+    else
+    {
+      lo = j + 1;
+    }
+  }
+  if ( p < population[lo].cfitness )
+  {
+    return lo;
+  }
+  return -1;
+}
+
+template <int DIMS>
+void selector (input_params& ip, run_state& rs, genotype* population, genotype* newpopulation) {
+  int i;
   int mem;
+  int survivor;
   double p;
   double sum = 0;
 //
+//  On several threads, each step is a pass over chunks of the population,
+//  and each chunk draws its survivors from a random number stream of its own.
+//
+  if ( ip.tasks != NULL )
+  {
+    int c;
+    int chunks = count_chunks ( ip );
+    member_pass pass ( ip, population, chunks );
+    pass.newpopulation = newpopulation;
+    pass.seed = rng_next ( rs.rng );
+    run_tasks ( ip.tasks, chunks, fitness_chunk, &pass );
+    for ( c = 0; c < chunks; c++ )
+    {
+      pass.total = pass.total + pass.sums[c];
+    }
+    if ( ! ( 0.0 < pass.total ) )
+    {
+      return;
+    }
+    for ( c = 0; c < chunks; c++ )
+    {
+      pass.offsets[c] = sum / pass.total;
+      sum = sum + pass.sums[c];
+    }
+    run_tasks ( ip.tasks, chunks, cumulative_chunk, &pass );
+    run_tasks ( ip.tasks, chunks, select_chunk<DIMS>, &pass );
+    run_tasks ( ip.tasks, chunks, copy_back_chunk<DIMS>, &pass );
+    return;
+  }
+//
 //  Find total fitness of the population 
 //
   for ( mem = 0; mem < ip.population; mem++ )
@@ -330,6 +1534,15 @@ void selector (input_params& ip, genotype* population, genotype* newpopulation)
     sum = sum + population[mem].fitness;
   }
 //
+//  If every member scored 0 (e.g. every set was penalized or every
+//  simulation failed), there are no shares to draw from, so the
+//  population survives as it is.
+//
+  if ( ! ( 0.0 < sum ) )
+  {
+    return;
+  }
+//
 //  Calculate the relative fitness.
 //
   for ( mem = 0; mem < ip.population; mem++ )
@@ -350,54 +1563,43 @@ void selector (input_params& ip, genotype* population, genotype* newpopulation)
 //
   for ( i = 0; i < ip.population; i++ )
   { 
-    p = rand() % 1000 / 1000.0;
-    if (p < population[0].cfitness)
-    {
-      newpopulation[i] = population[0];
-    }
-    else
+    p = rng_int ( rs.rng, 1000 ) / 1000.0;
+    survivor = find_survivor ( ip, population, p );
+    if ( survivor == -1 )
     {
-      for ( j = 0; j < ip.population; j++ )
-      { 
-        if ( p >= population[j].cfitness && p < population[j+1].cfitness )
-        {
-          newpopulation[i] = population[j+1];
-        }
-      }
+      survivor = i;
     }
+    copy_genotype<DIMS> ( newpopulation[i], population[survivor], ip.num_dims );
   }
 // 
 //  Once a new population is created, copy it back 
 //
   for ( i = 0; i < ip.population; i++ )
   {
-    population[i] = newpopulation[i];
+    copy_genotype<DIMS> ( population[i], newpopulation[i], ip.num_dims );
   }  
 }
 
-void Xover (int one, int two, input_params& ip, genotype* population) {
-  int i;
+template <int DIMS>
+void Xover (int one, int two, input_params& ip, rng_state& rng, genotype* population) {
   int point;
+  const int num_dims = dims_of<DIMS> ( ip );
 // 
 //  Select the crossover point.
 //
-  if ( 1 < ip.num_dims )
+  if ( 1 < num_dims )
   {
 
-    if ( ip.num_dims == 2 )
+    if ( num_dims == 2 )
     {
       point = 1;
     }
     else
     {
-      point = ( rand ( ) % ( ip.num_dims - 1 ) ) + 1;
+      point = rng_int ( rng, num_dims - 1 ) + 1;
     }
 
-    for ( i = 0; i < point; i++ )
-    {
-      r8_swap ( &population[one].gene[i], &population[two].gene[i] );
-    }
+    swap_rows ( population[one].gene, population[two].gene, point );
 
   }
 }
-
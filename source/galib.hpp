@@ -0,0 +1,292 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+galib.hpp contains the genetic algorithm library's types and function declarations for galib.cpp.
+*/
+
+#ifndef GALIB_HPP
+#define GALIB_HPP
+
+#include "memory.hpp"
+#include "structs.hpp"
+
+//
+//  Each GENOTYPE is a member of the population, with
+//  gene: a string of variables,
+//  fitness: the fitness
+//  upper: the variable upper bounds,
+//  lower: the variable lower bounds,
+//  rfitness: the relative fitness,
+//  cfitness: the cumulative fitness.
+//
+//  The variables are not owned by the member; ATTACH points them into
+//  storage carved out of the run's population arena.
+//
+struct genotype {
+	double* gene;
+	double fitness;
+	double* upper;
+	double* lower;
+	double rfitness;
+	double cfitness;
+	int num_dims;
+	
+	genotype () {
+		this->gene = NULL;
+		this->fitness = 0;
+		this->upper = NULL;
+		this->lower = NULL;
+		this->rfitness = 0;
+		this->cfitness = 0;
+	}
+	
+	void attach (double* storage, int stride, int num_dims) {
+		this->gene = storage;
+		this->upper = storage + stride;
+		this->lower = storage + 2 * stride;
+		this->num_dims = num_dims;
+	}
+	
+	genotype& operator= (const genotype& g) {
+		this->fitness = g.fitness;
+		this->rfitness = g.rfitness;
+		this->cfitness = g.cfitness;
+		for (int i = 0; i < this->num_dims; i++) {
+			this->gene[i] = g.gene[i];
+			this->upper[i] = g.upper[i];
+			this->lower[i] = g.lower[i];
+		}
+		return *this;
+	}
+};
+
+//
+//  The operators that loop over the variables are templated on DIMS, the
+//  number of variables when it is known at compile time, or 0 when it must
+//  be read from the input parameters at run time.  Specializing on the
+//  dimensions that are run most often lets the compiler unroll and
+//  vectorize those loops.  CHOOSE_OPERATORS picks the specialization.
+//
+struct ga_operators {
+  int dims;
+  void (*crossover)(input_params&, run_state&, genotype*);
+  double (*diversity)(input_params&, genotype*);
+  void (*elitist)(input_params&, genotype*);
+  void (*evaluate)(input_params&, run_state&, genotype*, int);
+  void (*keep_the_best)(input_params&, genotype*);
+  void (*mutate)(input_params&, run_state&, genotype*);
+  void (*refine)(input_params&, run_state&, genotype*);
+  void (*select_best)(input_params&, genotype*, int, genotype*);
+  void (*selector)(input_params&, run_state&, genotype*, genotype*);
+};
+
+struct ga_run;
+
+//
+//  Each GA_ENGINE is an optimizer that drives a run by proposing batches
+//  of members and taking them back once they are scored, with
+//  name: the name --engine selects it by,
+//  start: builds the engine's state from the scored initial population,
+//  ask: proposes the next batch to score, returning its members and count,
+//  tell: takes the scored batch back, updating the population and the
+//    best member stored after the last.
+//  The run scores every engine's batches with its evaluate operator, so
+//  every engine shares the parallel simulations, score database, and
+//  budgets.  CHOOSE_ENGINE picks the engine.
+//
+struct ga_engine {
+  const char* name;
+  void (*start)(input_params&, ga_run&);
+  genotype* (*ask)(input_params&, ga_run&, int&);
+  void (*tell)(input_params&, ga_run&, genotype*, int);
+};
+
+//
+//  Each CMAES_STATE is the search distribution of the CMA-ES engine, kept
+//  in coordinates where every range runs from 0 to 1, with
+//  num_dims: the number of variables,
+//  lambda: the number of sets sampled per generation,
+//  mu: the number of best samples the mean moves toward,
+//  weights: the weight of each of those samples, best first,
+//  mueff: the variance effective selection mass of the weights,
+//  cc, cs, c1, cmu, damps: the learning rates and step size damping,
+//  chi_n: the expected length of a standard normal vector,
+//  sigma: the step size,
+//  mean: the mean of the distribution,
+//  pc, ps: the evolution paths of the covariance and the step size,
+//  C: the covariance matrix, row by row,
+//  B, D: C's eigenvectors (as columns) and the square roots of its
+//    eigenvalues, which samples are drawn with,
+//  eigen_generation: the generation B and D were last updated in.
+//
+struct cmaes_state {
+  int num_dims;
+  int lambda;
+  int mu;
+  double* weights;
+  double mueff;
+  double cc;
+  double cs;
+  double c1;
+  double cmu;
+  double damps;
+  double chi_n;
+  double sigma;
+  double* mean;
+  double* pc;
+  double* ps;
+  double* C;
+  double* B;
+  double* D;
+  int eigen_generation;
+
+  cmaes_state ( int num_dims, int lambda ) {
+    this->num_dims = num_dims;
+    this->lambda = lambda;
+    this->mu = lambda / 2;
+    this->weights = new double[this->mu];
+    this->mean = new double[num_dims];
+    this->pc = new double[num_dims];
+    this->ps = new double[num_dims];
+    this->C = new double[num_dims * num_dims];
+    this->B = new double[num_dims * num_dims];
+    this->D = new double[num_dims];
+    this->eigen_generation = 0;
+  }
+
+  ~cmaes_state () {
+    delete[] this->weights;
+    delete[] this->mean;
+    delete[] this->pc;
+    delete[] this->ps;
+    delete[] this->C;
+    delete[] this->B;
+    delete[] this->D;
+  }
+};
+
+//
+//  Each GA_RUN is a run in progress, kept between generations so the
+//  run can be advanced one generation at a time, with
+//  rs: the state of the run,
+//  ops: the operators specialized for the run's dimensions,
+//  engine: the optimizer proposing the sets to score,
+//  cmaes: the CMA-ES engine's state, or NULL,
+//  population: the population, with the best member stored after the last,
+//  newpopulation: the population the selector copies survivors into,
+//  candidates: the oversampled initial candidates, or NULL,
+//  packed: the genes in the quantized encoding, or NULL,
+//  arena: the one block of memory every member and its variables live in,
+//  arena_size: the number of bytes mapped for the arena,
+//  generation: the number of generations run so far,
+//  stop_reason: why the run stopped early, or NULL.
+//
+struct ga_run {
+  run_state rs;
+  ga_operators ops;
+  ga_engine engine;
+  cmaes_state* cmaes;
+  genotype* population;
+  genotype* newpopulation;
+  genotype* candidates;
+  packed_population* packed;
+  void* arena;
+  size_t arena_size;
+  int generation;
+  const char* stop_reason;
+
+  ga_run () {
+    this->cmaes = NULL;
+    this->population = NULL;
+    this->newpopulation = NULL;
+    this->candidates = NULL;
+    this->packed = NULL;
+    this->arena = NULL;
+    this->arena_size = 0;
+    this->generation = 0;
+    this->stop_reason = NULL;
+  }
+
+  ~ga_run () {
+    delete this->cmaes;
+    delete this->packed;
+    unmap_arena(this->arena, this->arena_size);
+  }
+};
+
+//
+//  Each MEMBER_PASS is one pass of an operator over the population, split
+//  into chunks of GA_CHUNK_MEMBERS members that RUN_TASKS can run on
+//  several threads at once, with
+//  ip: the program's input parameters,
+//  population: the population,
+//  newpopulation: the population the selector copies survivors into,
+//  seed: the seed each chunk's random number stream is derived from,
+//  total: the sum the pass divides by, e.g. the population's fitness,
+//  sums, squares: each chunk's parts of a sum and a sum of squares,
+//  offsets: values the pass adds on, e.g. the fitness before each chunk,
+//  best, worst: each chunk's best and worst member.
+//
+//  Chunks never depend on which thread runs them and their parts are
+//  combined in chunk order, so a pass gives the same result on any
+//  number of threads.
+//
+struct member_pass {
+  input_params* ip;
+  genotype* population;
+  genotype* newpopulation;
+  uint64_t seed;
+  double total;
+  double* sums;
+  double* squares;
+  double* offsets;
+  int* best;
+  int* worst;
+
+  member_pass ( input_params& ip, genotype* population, int slots ) {
+    this->ip = &ip;
+    this->population = population;
+    this->newpopulation = NULL;
+    this->seed = 0;
+    this->total = 0;
+    this->sums = new double[slots];
+    this->squares = new double[slots];
+    this->offsets = new double[slots];
+    this->best = new int[slots];
+    this->worst = new int[slots];
+  }
+
+  ~member_pass () {
+    delete[] this->sums;
+    delete[] this->squares;
+    delete[] this->offsets;
+    delete[] this->best;
+    delete[] this->worst;
+  }
+};
+
+ga_operators choose_operators(int);
+int find_survivor(input_params&, genotype*, double);
+void initialize(input_params&, run_state&, genotype*, int);
+double randval(rng_state&, double, double);
+void report(int, input_params&, run_state&, genotype*);
+void score_population(input_params&, run_state&, int*, int, double*, bool*);
+void seed_population(input_params&, run_state&, genotype*, int);
+
+#endif
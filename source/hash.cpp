@@ -0,0 +1,169 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+hash.cpp contains functions for hashing parameter sets and finding identical ones.
+*/
+
+#include <cstring> // Needed for memcmp
+
+#include "hash.hpp" // Function declarations
+
+using namespace std;
+
+/* hash_set computes a 64-bit FNV-1a hash of the given parameter set
+	parameters:
+		set: the parameter set to hash
+		num_dims: the number of parameters in the set
+	returns: the hash
+	notes:
+	todo:
+*/
+uint64_t hash_set (const int set[], int num_dims) {
+	uint64_t hash = 14695981039346656037ULL;
+	const unsigned char* bytes = (const unsigned char*)set;
+	for (size_t i = 0; i < sizeof(int) * num_dims; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/* find_duplicates finds every parameter set identical to an earlier one in the given array
+	parameters:
+		sets: the parameter sets to check, stored consecutively
+		count: the number of sets
+		num_dims: the number of parameters in each set
+		representative: an array to store, for every set, the index of the first set identical to it (its own index if it is the first)
+	returns: the number of sets identical to an earlier set
+	notes:
+		Sets are placed in an open addressing hash table at least twice as large as the number of sets, so this takes linear time on average.
+	todo:
+*/
+int find_duplicates (int* sets, int count, int num_dims, int representative[]) {
+	int capacity = 1;
+	while (capacity < 2 * count) {
+		capacity <<= 1;
+	}
+	int* table = new int[capacity];
+	for (int i = 0; i < capacity; i++) {
+		table[i] = -1;
+	}
+	
+	int duplicates = 0;
+	for (int i = 0; i < count; i++) {
+		const int* set = sets + i * num_dims;
+		int slot = hash_set(set, num_dims) & (capacity - 1);
+		representative[i] = i;
+		while (table[slot] != -1) {
+			if (memcmp(sets + table[slot] * num_dims, set, sizeof(int) * num_dims) == 0) {
+				representative[i] = table[slot];
+				duplicates++;
+				break;
+			}
+			slot = (slot + 1) & (capacity - 1);
+		}
+		if (representative[i] == i) {
+			table[slot] = i;
+		}
+	}
+	
+	delete[] table;
+	return duplicates;
+}
+
+/* score_table_slot finds the slot holding the given set in the given table, or the empty slot it would be inserted into
+	parameters:
+		st: the table to search, with a nonzero capacity
+		set: the parameter set to find
+	returns: the slot's index
+	notes:
+	todo:
+*/
+static int score_table_slot (score_table* st, const int set[]) {
+	int slot = hash_set(set, st->num_dims) & (st->capacity - 1);
+	while (st->used[slot] && memcmp(st->sets + slot * st->num_dims, set, sizeof(int) * st->num_dims) != 0) {
+		slot = (slot + 1) & (st->capacity - 1);
+	}
+	return slot;
+}
+
+/* score_table_find looks up the score of the given set in the given table
+	parameters:
+		st: the table to search
+		set: the parameter set to look up
+		score: a pointer to store the set's score in if it is found
+	returns: true if the set is in the table, false otherwise
+	notes:
+	todo:
+*/
+bool score_table_find (score_table* st, const int set[], double* score) {
+	if (st->size == 0) {
+		return false;
+	}
+	int slot = score_table_slot(st, set);
+	if (st->used[slot]) {
+		*score = st->scores[slot];
+		return true;
+	}
+	return false;
+}
+
+/* score_table_insert stores the given set and score in the given table, replacing the set's previous score if it has one
+	parameters:
+		st: the table to store the set in
+		set: the parameter set
+		score: the set's score
+	returns: nothing
+	notes:
+		The table doubles in capacity once it becomes half full so that probe sequences stay short.
+	todo:
+*/
+void score_table_insert (score_table* st, const int set[], double score) {
+	if (2 * (st->size + 1) > st->capacity) {
+		int old_capacity = st->capacity;
+		int* old_sets = st->sets;
+		double* old_scores = st->scores;
+		bool* old_used = st->used;
+		st->capacity = old_capacity == 0 ? 64 : old_capacity * 2;
+		st->sets = new int[st->capacity * st->num_dims];
+		st->scores = new double[st->capacity];
+		st->used = new bool[st->capacity];
+		memset(st->used, 0, sizeof(bool) * st->capacity);
+		for (int i = 0; i < old_capacity; i++) {
+			if (old_used[i]) {
+				int slot = score_table_slot(st, old_sets + i * st->num_dims);
+				memcpy(st->sets + slot * st->num_dims, old_sets + i * st->num_dims, sizeof(int) * st->num_dims);
+				st->scores[slot] = old_scores[i];
+				st->used[slot] = true;
+			}
+		}
+		delete[] old_sets;
+		delete[] old_scores;
+		delete[] old_used;
+	}
+	
+	int slot = score_table_slot(st, set);
+	if (!st->used[slot]) {
+		memcpy(st->sets + slot * st->num_dims, set, sizeof(int) * st->num_dims);
+		st->used[slot] = true;
+		st->size++;
+	}
+	st->scores[slot] = score;
+}
+
@@ -17,16 +17,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 /*
-init.cpp contains initialization functions used before any simulations start.
+init.cpp contains initialization functions used before any simulations start, including parsing the command-line arguments and printing the usage information.
 */
 
 #include <cmath> // Needed for log10
+#include <ctime> // Needed for clock_gettime
 
 #include "init.hpp" // Function declarations
 
 #include "io.hpp"
 #include "macros.hpp"
-#include "main.hpp"
 
 using namespace std; 
 
@@ -48,6 +48,19 @@ char* copy_str (const char* str) {
 	}
 }
 
+/* wall_time returns the current time of a monotonic clock
+	parameters:
+	returns: the time in seconds
+	notes:
+		Only differences between returned times are meaningful.
+	todo:
+*/
+double wall_time () {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 /* init_terminal creates and initializes a new terminal struct
 	parameters:
 	returns: nothing
@@ -108,6 +121,33 @@ void accept_input_params (int num_args, char** args, input_params& ip) {
 				ensure_nonempty(option, value);
 				store_filename(&(ip.good_sets_file), value);
 				ip.print_good_sets = true;
+			} else if (option_set(option, NULL, "--seed-population")) {
+				ensure_nonempty(option, value);
+				store_filename(&(ip.seed_population_file), value);
+			} else if (option_set(option, NULL, "--score-db")) {
+				ensure_nonempty(option, value);
+				store_filename(&(ip.score_db_file), value);
+			} else if (option_set(option, NULL, "--compact-score-db")) {
+				ip.compact_score_db = true;
+				i--;
+			} else if (option_set(option, NULL, "--sweep")) {
+				ensure_nonempty(option, value);
+				store_filename(&(ip.sweep_file), value);
+			} else if (option_set(option, NULL, "--quarantine")) {
+				ensure_nonempty(option, value);
+				store_filename(&(ip.quarantine_file), value);
+			} else if (option_set(option, NULL, "--usage-file")) {
+				ensure_nonempty(option, value);
+				store_filename(&(ip.usage_file), value);
+			} else if (option_set(option, NULL, "--checkpoint-file")) {
+				ensure_nonempty(option, value);
+				store_filename(&(ip.checkpoint_file), value);
+			} else if (option_set(option, NULL, "--metrics-socket")) {
+				ensure_nonempty(option, value);
+				store_filename(&(ip.metrics_socket), value);
+			} else if (option_set(option, NULL, "--trace")) {
+				ensure_nonempty(option, value);
+				store_filename(&(ip.trace_file), value);
 			} else if (option_set(option, "-G", "--good-set-threshold")) {
 				ensure_nonempty(option, value);
 				ip.good_set_threshold = atof(value);
@@ -163,6 +203,257 @@ void accept_input_params (int num_args, char** args, input_params& ip) {
 					usage("Gradient indices must be valid parameter indices. Set each -i or --gradient-index to between 0 and 44 (inclusive).");
 				}
 				add_gradient_index(&(ip.gradient_indices), index);
+			} else if (option_set(option, NULL, "--init")) {
+				ensure_nonempty(option, value);
+				if (strcmp(value, "random") == 0) {
+					ip.init_design = DESIGN_RANDOM;
+				} else if (strcmp(value, "sobol") == 0) {
+					ip.init_design = DESIGN_SOBOL;
+				} else if (strcmp(value, "lhs") == 0) {
+					ip.init_design = DESIGN_LHS;
+				} else {
+					usage("The initialization design must be a known design. Set --init to random, sobol, or lhs.");
+				}
+			} else if (option_set(option, NULL, "--constraint-action")) {
+				ensure_nonempty(option, value);
+				if (strcmp(value, "repair") == 0) {
+					ip.constraint_action = CONSTRAINT_REPAIR;
+				} else if (strcmp(value, "resample") == 0) {
+					ip.constraint_action = CONSTRAINT_RESAMPLE;
+				} else if (strcmp(value, "penalize") == 0) {
+					ip.constraint_action = CONSTRAINT_PENALIZE;
+				} else {
+					usage("The constraint action must be a known action. Set --constraint-action to repair, resample, or penalize.");
+				}
+			} else if (option_set(option, NULL, "--constraint-penalty")) {
+				ensure_nonempty(option, value);
+				ip.constraint_penalty = atof(value);
+				if (ip.constraint_penalty < 0 || ip.constraint_penalty > 1) {
+					usage("The constraint penalty must be a possible score. Set --constraint-penalty to between 0 and 1.");
+				}
+			} else if (option_set(option, NULL, "--local-search")) {
+				ensure_nonempty(option, value);
+				if (strcmp(value, "none") == 0) {
+					ip.local_search = LOCAL_NONE;
+				} else if (strcmp(value, "pattern") == 0) {
+					ip.local_search = LOCAL_PATTERN;
+				} else if (strcmp(value, "coordinate") == 0) {
+					ip.local_search = LOCAL_COORDINATE;
+				} else {
+					usage("The local search must be a known search. Set --local-search to none, pattern, or coordinate.");
+				}
+			} else if (option_set(option, NULL, "--local-elites")) {
+				ensure_nonempty(option, value);
+				ip.local_elites = atoi(value);
+				if (ip.local_elites < 1) {
+					usage("The local search must refine at least one member. Set --local-elites to at least 1.");
+				}
+			} else if (option_set(option, NULL, "--local-budget")) {
+				ensure_nonempty(option, value);
+				ip.local_budget = atoi(value);
+				if (ip.local_budget < 2) {
+					usage("The local search must be able to score a step in both directions. Set --local-budget to at least 2.");
+				}
+			} else if (option_set(option, NULL, "--mode")) {
+				ensure_nonempty(option, value);
+				if (strcmp(value, "ga") == 0) {
+					ip.mode = MODE_GA;
+				} else if (strcmp(value, "sample") == 0) {
+					ip.mode = MODE_SAMPLE;
+				} else {
+					usage("The mode must be a known mode. Set --mode to ga or sample.");
+				}
+			} else if (option_set(option, NULL, "--samples")) {
+				ensure_nonempty(option, value);
+				ip.samples = atol(value);
+				if (ip.samples < 1) {
+					usage("The sampling mode must simulate at least one point. Set --samples to at least 1.");
+				}
+			} else if (option_set(option, NULL, "--sample-design")) {
+				ensure_nonempty(option, value);
+				if (strcmp(value, "random") == 0) {
+					ip.sample_design = DESIGN_RANDOM;
+				} else if (strcmp(value, "sobol") == 0) {
+					ip.sample_design = DESIGN_SOBOL;
+				} else if (strcmp(value, "grid") == 0) {
+					ip.sample_design = DESIGN_GRID;
+				} else {
+					usage("The sampling design must be a known design. Set --sample-design to random, sobol, or grid.");
+				}
+			} else if (option_set(option, NULL, "--resume")) {
+				ip.resume = true;
+				i--;
+			} else if (option_set(option, NULL, "--init-oversample")) {
+				ensure_nonempty(option, value);
+				ip.init_oversample = atoi(value);
+				if (ip.init_oversample < 1) {
+					usage("The initialization must simulate at least one candidate per population member. Set --init-oversample to at least 1.");
+				}
+			} else if (option_set(option, NULL, "--engine")) {
+				ensure_nonempty(option, value);
+				if (strcmp(value, "ga") == 0) {
+					ip.engine = ENGINE_GA;
+				} else if (strcmp(value, "cmaes") == 0) {
+					ip.engine = ENGINE_CMAES;
+				} else if (strcmp(value, "de") == 0) {
+					ip.engine = ENGINE_DE;
+				} else {
+					usage("The engine must be a known optimizer. Set --engine to ga, cmaes, or de.");
+				}
+			} else if (option_set(option, NULL, "--cmaes-sigma")) {
+				ensure_nonempty(option, value);
+				ip.cmaes_sigma = atof(value);
+				if (ip.cmaes_sigma <= 0) {
+					usage("The CMA-ES step size must be positive. Set --cmaes-sigma to a number greater than 0.");
+				}
+			} else if (option_set(option, NULL, "--de-weight")) {
+				ensure_nonempty(option, value);
+				ip.de_weight = atof(value);
+				if (ip.de_weight <= 0 || ip.de_weight > 2) {
+					usage("The differential weight must be positive and at most 2. Set --de-weight to between 0 (exclusive) and 2.");
+				}
+			} else if (option_set(option, NULL, "--de-crossover")) {
+				ensure_nonempty(option, value);
+				ip.de_crossover = atof(value);
+				if (ip.de_crossover < 0 || ip.de_crossover > 1) {
+					usage("The differential evolution crossover must be a probability. Set --de-crossover to between 0 and 1.");
+				}
+			} else if (option_set(option, NULL, "--encoding")) {
+				ensure_nonempty(option, value);
+				if (strcmp(value, "double") == 0) {
+					ip.encoding = ENCODING_DOUBLE;
+				} else if (strcmp(value, "quantized") == 0) {
+					ip.encoding = ENCODING_QUANTIZED;
+				} else {
+					usage("The encoding must be a known encoding. Set --encoding to double or quantized.");
+				}
+			} else if (option_set(option, NULL, "--simd")) {
+				ensure_nonempty(option, value);
+				if (strcmp(value, "auto") == 0) {
+					ip.simd = SIMD_AUTO;
+				} else if (strcmp(value, "avx512") == 0) {
+					ip.simd = SIMD_AVX512;
+				} else if (strcmp(value, "avx2") == 0) {
+					ip.simd = SIMD_AVX2;
+				} else if (strcmp(value, "scalar") == 0) {
+					ip.simd = SIMD_SCALAR;
+				} else {
+					usage("The instruction set must be a known instruction set. Set --simd to auto, avx512, avx2, or scalar.");
+				}
+			} else if (option_set(option, NULL, "--replace-duplicates")) {
+				ip.replace_duplicates = true;
+				i--;
+			} else if (option_set(option, "-S", "--surrogate-fraction")) {
+				ensure_nonempty(option, value);
+				ip.surrogate_fraction = atof(value);
+				if (ip.surrogate_fraction <= 0 || ip.surrogate_fraction > 1) {
+					usage("The fraction of sets to simulate must be a valid fraction. Set -S or --surrogate-fraction to above 0 and at most 1.");
+				}
+			} else if (option_set(option, NULL, "--surrogate-explore")) {
+				ensure_nonempty(option, value);
+				ip.surrogate_explore = atof(value);
+				if (ip.surrogate_explore < 0 || ip.surrogate_explore > 1) {
+					usage("The fraction of sets to explore must be a valid fraction. Set --surrogate-explore to between 0 and 1, inclusive.");
+				}
+			} else if (option_set(option, NULL, "--surrogate-knn")) {
+				ensure_nonempty(option, value);
+				ip.surrogate_knn = atoi(value);
+				if (ip.surrogate_knn < 1) {
+					usage("The surrogate model must average at least one neighbor. Set --surrogate-knn to at least 1.");
+				}
+			} else if (option_set(option, NULL, "--surrogate-archive")) {
+				ensure_nonempty(option, value);
+				ip.surrogate_archive = atoi(value);
+				if (ip.surrogate_archive < 1) {
+					usage("The surrogate model must remember at least one set. Set --surrogate-archive to at least 1.");
+				}
+			} else if (option_set(option, NULL, "--stall-generations")) {
+				ensure_nonempty(option, value);
+				ip.stall_generations = atoi(value);
+				if (ip.stall_generations < 0) {
+					usage("The number of generations without improvement must be nonnegative. Set --stall-generations to at least 0.");
+				}
+			} else if (option_set(option, NULL, "--min-diversity")) {
+				ensure_nonempty(option, value);
+				ip.min_diversity = atof(value);
+				if (ip.min_diversity < 0 || ip.min_diversity > 1) {
+					usage("The minimum diversity must be a valid diversity. Set --min-diversity to between 0 and 1, inclusive.");
+				}
+			} else if (option_set(option, NULL, "--target-score")) {
+				ensure_nonempty(option, value);
+				ip.target_score = atof(value);
+				if (ip.target_score < 0 || ip.target_score > 1) {
+					usage("The target score must be a possible score. Set --target-score to between 0 and 1, inclusive.");
+				}
+			} else if (option_set(option, NULL, "--time-budget")) {
+				ensure_nonempty(option, value);
+				ip.time_budget = atof(value);
+				if (ip.time_budget < 0) {
+					usage("The time budget must be nonnegative. Set --time-budget to at least 0 seconds.");
+				}
+			} else if (option_set(option, NULL, "--budget-action")) {
+				ensure_nonempty(option, value);
+				if (strcmp(value, "drain") == 0) {
+					ip.budget_action = BUDGET_DRAIN;
+				} else if (strcmp(value, "cancel") == 0) {
+					ip.budget_action = BUDGET_CANCEL;
+				} else {
+					usage("The budget action must be a known action. Set --budget-action to drain or cancel.");
+				}
+			} else if (option_set(option, NULL, "--eval-budget")) {
+				ensure_nonempty(option, value);
+				ip.eval_budget = atoi(value);
+				if (ip.eval_budget < 0) {
+					usage("The evaluation budget must be nonnegative. Set --eval-budget to at least 0 simulations.");
+				}
+			} else if (option_set(option, "-j", "--jobs")) {
+				ensure_nonempty(option, value);
+				ip.jobs = atoi(value);
+				if (ip.jobs < 1) {
+					usage("At least one simulation must be able to run at a time. Set -j or --jobs to at least 1.");
+				}
+			} else if (option_set(option, NULL, "--adaptive-jobs")) {
+				ip.adaptive_jobs = true;
+				i--;
+			} else if (option_set(option, NULL, "--min-jobs")) {
+				ensure_nonempty(option, value);
+				ip.min_jobs = atoi(value);
+				if (ip.min_jobs < 1) {
+					usage("At least one simulation must be able to run at a time. Set --min-jobs to at least 1.");
+				}
+			} else if (option_set(option, NULL, "--threads")) {
+				ensure_nonempty(option, value);
+				ip.threads = atoi(value);
+				if (ip.threads < 1) {
+					usage("The operators must run on at least one thread. Set --threads to at least 1.");
+				}
+			} else if (option_set(option, NULL, "--retries")) {
+				ensure_nonempty(option, value);
+				ip.retries = atoi(value);
+				if (ip.retries < 0) {
+					usage("The number of retries must be nonnegative. Set --retries to at least 0.");
+				}
+			} else if (option_set(option, NULL, "--retry-delay")) {
+				ensure_nonempty(option, value);
+				ip.retry_delay = atof(value);
+				if (ip.retry_delay < 0) {
+					usage("The delay before retrying a simulation must be nonnegative. Set --retry-delay to at least 0 seconds.");
+				}
+			} else if (option_set(option, NULL, "--failure-score")) {
+				ensure_nonempty(option, value);
+				ip.failure_score = atof(value);
+				if (ip.failure_score < 0 || ip.failure_score > 1) {
+					usage("The failure score must be a possible score. Set --failure-score to between 0 and 1.");
+				}
+			} else if (option_set(option, NULL, "--cpus")) {
+				ensure_nonempty(option, value);
+				store_filename(&(ip.cpus), value);
+			} else if (option_set(option, NULL, "--reserve-cpus")) {
+				ensure_nonempty(option, value);
+				ip.reserve_cpus = atoi(value);
+				if (ip.reserve_cpus < 0) {
+					usage("The number of CPUs to reserve must be nonnegative. Set --reserve-cpus to at least 0.");
+				}
 			} else if (option_set(option, "-a", "--arguments")) {
 				ensure_nonempty(option, value);
 				++i;
@@ -213,14 +504,14 @@ void accept_input_params (int num_args, char** args, input_params& ip) {
 /* option_set checks if the given string matches either given version (short or long) of an option
 	parameters:
 		option: the string to check
-		short_name: the short version of the option
+		short_name: the short version of the option, or NULL if the option has only a long version
 		long_name: the long version of the option
 	returns: true if the string matches a version, false otherwise
 	notes:
 	todo:
 */
 inline bool option_set (const char* option, const char* short_name, const char* long_name) {
-	return strcmp(option, short_name) == 0 || strcmp(option, long_name) == 0;
+	return (short_name != NULL && strcmp(option, short_name) == 0) || strcmp(option, long_name) == 0;
 }
 
 /* ensure_nonempty ensures that an option that should have an associated value has one or exits with an error
@@ -239,6 +530,112 @@ void ensure_nonempty (const char* option, const char* arg) {
 	}
 }
 
+/* usage prints the usage information and, optionally, an error message and then exits
+	parameters:
+		message: an error message to print before the usage information (set message to NULL or "\0" to not print any error)
+	returns: nothing
+	notes:
+		This function exits after printing the usage information.
+		Note that accept_input_params in init.cpp handles actual command-line input and that this information should be updated according to that function.
+	todo:
+		TODO somehow free memory even with the abrupt exit
+*/
+void usage (const char* message) {
+	cout << endl;
+	bool error = message != NULL && message[0] != '\0';
+	if (error) {
+		cout << term->red << message << term->reset << endl << endl;
+	}
+	cout << "Usage: [-option [value]]. . . [--option [value]]. . ." << endl;
+	cout << "-r, --ranges-file        [filename]   : the relative filename of the ranges input file, default=none" << endl;
+	cout << "-f, --simulation         [filename]   : the relative filename of the simulation executable, default=simulation" << endl;
+	cout << "-o, --print-good-sets    [filename]   : the relative filename of the good sets output file, default=none" << endl;
+	cout << "    --seed-population    [filename]   : the relative filename of a good sets file from an earlier run to seed the initial population with, default=none" << endl;
+	cout << "    --score-db           [filename]   : the relative filename of a score database shared across runs to look scores up in before simulating and store them in afterward, default=none" << endl;
+	cout << "    --compact-score-db   [N/A]        : compact the score database given with --score-db and exit, default=unused" << endl;
+	cout << "    --sweep              [filename]   : the relative filename of a list of configurations, one line of extra arguments per run, to run at once sharing the --jobs simulation slots, default=none" << endl;
+	cout << "    --quarantine         [filename]   : the relative filename of a file to list the sets whose simulations failed every attempt in, default=none" << endl;
+	cout << "    --usage-file         [filename]   : the relative filename of a file to list every simulated set in with the CPU time, peak memory, and I/O its simulation used, default=none" << endl;
+	cout << "    --checkpoint-file    [filename]   : the relative filename of a file to write the final population to when the run stops, which --seed-population can continue from, default=none" << endl;
+	cout << "    --metrics-socket     [filename]   : the relative filename of a Unix-domain socket to serve live progress on in the Prometheus text format (e.g. curl --unix-socket), default=none" << endl;
+	cout << "    --trace              [filename]   : the relative filename of a Chrome trace-event file (for chrome://tracing or Perfetto) to record every simulation's and generation phase's timeline in, default=none" << endl;
+	cout << "-G, --good-set-threshold [float]      : the worst score a set must receive to be printed to the good sets file, default=0.0" << endl;
+	cout << "-d, --dimensions         [int]        : the number of dimensions (i.e. rate parameters) to explore, min=1, default=45" << endl;
+	cout << "-p, --population         [int]        : the population of simulations to use each generation, min=1, default=200" << endl;
+	cout << "-g, --generations        [int]        : the number of generations to run before returning results, min=1, default=1000" << endl;
+	cout << "-m, --mutation-prob      [float]      : the probability of a mutation occurring for any given population member, min=0, max=1, default=0.001" << endl;
+	cout << "-C, --crossover-prob     [float]      : the probability of a crossover occurring for any given population member, min=0, max=1, default=0.9" << endl;
+	cout << "-s, --seed               [int]        : the seed used in the evolutionary strategy (not simulations), min=1, default=time" << endl;
+	cout << "-e, --printing-precision [int]        : how many digits of precision parameters should be printed with, min=1, default=6" << endl;
+	cout << "-i, --gradient-index     [int]        : the index of a parameter to apply gradients to, can be entered multiple times, min=1, max=# of dimensions, default=none" << endl;
+	cout << "    --constraint-action  [string]     : what to do with a set that breaks a constraint in the ranges file, repair (move it onto the constraint), resample (redraw it), or penalize, default=repair" << endl;
+	cout << "    --constraint-penalty [float]      : the score given without simulating to a set that breaks a constraint and could not be fixed, min=0, max=1, default=0" << endl;
+	cout << "    --local-search       [string]     : the local search run on the best members after every generation, none, pattern (poll every parameter at once), or coordinate (one parameter at a time), default=none" << endl;
+	cout << "    --local-elites       [int]        : the number of best distinct members the local search refines, min=1, default=3" << endl;
+	cout << "    --local-budget       [int]        : the most sets the local search may score each generation, min=2, default=50" << endl;
+	cout << "    --mode               [string]     : what to do with the ranges, ga (run the genetic algorithm) or sample (simulate --samples points placed by --sample-design, streaming them to the good sets file), default=ga" << endl;
+	cout << "    --samples            [int]        : the number of points the sampling mode simulates (the most, for a grid), min=1, default=1000" << endl;
+	cout << "    --sample-design      [string]     : the design the sampling mode places its points with, random, sobol, or grid, default=random" << endl;
+	cout << "    --resume             [N/A]        : continue an interrupted sampling run from the progress file next to its good sets file, default=unused" << endl;
+	cout << "    --init               [string]     : the design used to place the initial population, random, sobol, or lhs (Latin hypercube), default=random" << endl;
+	cout << "    --init-oversample    [int]        : the number of initial candidates to simulate per population member, keeping only the best, min=1, default=1" << endl;
+	cout << "    --engine             [string]     : the optimizer that proposes the sets to simulate, ga (the genetic algorithm), cmaes (CMA-ES, sampling -p sets per generation), or de (differential evolution), default=ga" << endl;
+	cout << "    --cmaes-sigma        [float]      : the CMA-ES engine's initial step size, relative to the width of each range, min=0 (exclusive), default=0.3" << endl;
+	cout << "    --de-weight          [float]      : the differential evolution engine's weight on the difference between two members, min=0 (exclusive), max=2, default=0.5" << endl;
+	cout << "    --de-crossover       [float]      : the differential evolution engine's probability of taking each parameter from the mutant, min=0, max=1, default=0.9" << endl;
+	cout << "    --encoding           [string]     : how to store the population's genes, double or quantized (offsets within each range in 16 or 32 bits, with bit-level crossover and mutation, where -m is each bit's chance), default=double" << endl;
+	cout << "    --simd               [string]     : the instruction set used for mutation and crossover, auto, avx512, avx2, or scalar (all give identical results), default=auto" << endl;
+	cout << "    --replace-duplicates [N/A]        : replace members identical to another member with random immigrants before simulating, default=unused" << endl;
+	cout << "-S, --surrogate-fraction [float]      : the fraction of each generation's sets the surrogate model predicts best to simulate, min=0 (exclusive), max=1 (no surrogate), default=1" << endl;
+	cout << "    --surrogate-explore  [float]      : the fraction of each generation's sets to simulate regardless of their predicted scores, min=0, max=1, default=0.05" << endl;
+	cout << "    --surrogate-knn      [int]        : the number of nearest simulated sets the surrogate model averages, min=1, default=5" << endl;
+	cout << "    --surrogate-archive  [int]        : the maximum number of simulated sets the surrogate model remembers, min=1, default=10000" << endl;
+	cout << "    --stall-generations  [int]        : stop after this many generations without the best score improving, min=0 (never), default=0" << endl;
+	cout << "    --min-diversity      [float]      : stop once the population's diversity falls below this, min=0 (never), max=1, default=0" << endl;
+	cout << "    --target-score       [float]      : stop once the best score reaches this, min=0, max=1, default=none" << endl;
+	cout << "    --time-budget        [float]      : stop after this many wall-clock seconds, min=0 (never), default=0" << endl;
+	cout << "    --eval-budget        [int]        : stop after this many simulations, min=0 (never), default=0" << endl;
+	cout << "    --budget-action      [string]     : what to do with the simulations running when the time budget runs out, drain (let them finish) or cancel (kill them), default=drain" << endl;
+	cout << "-j, --jobs               [int]        : the number of simulations to run at the same time (the most with --adaptive-jobs), min=1, default=1" << endl;
+	cout << "    --retries            [int]        : the number of times to run a set's simulation again after it crashes or exits without a score, min=0, default=2" << endl;
+	cout << "    --retry-delay        [float]      : the seconds to wait before retrying a set, doubled for each further retry, min=0, default=0.1" << endl;
+	cout << "    --failure-score      [float]      : the score given to a set whose simulations failed every attempt, min=0, max=1, default=0" << endl;
+	cout << "    --adaptive-jobs      [N/A]        : adjust how many simulations run at the same time, between --min-jobs and --jobs, to the measured throughput, host load, and free memory, default=unused" << endl;
+	cout << "    --min-jobs           [int]        : the fewest simulations to run at the same time with --adaptive-jobs, min=1, default=1" << endl;
+	cout << "    --threads            [int]        : the number of threads to run the selection, crossover, mutation, and elitism passes over the population on, for huge populations, min=1, default=1" << endl;
+	cout << "    --cpus               [list]       : the CPUs to pin simulations to, e.g. 0-7,16-23 or all, spreading slots across NUMA nodes, default=none (no pinning)" << endl;
+	cout << "    --reserve-cpus       [int]        : the number of CPUs at the start of the CPU list to leave free for the genetic algorithm itself, min=0, default=0" << endl;
+	cout << "-a, --arguments          [N/A]        : every argument following this will be sent to the deterministic simulation" << endl;
+	cout << "-c, --no-color           [N/A]        : disable coloring the terminal output, default=unused" << endl;
+	cout << "-v, --verbose            [N/A]        : print detailed messages about the program state" << endl;
+	cout << "-q, --quiet              [N/A]        : hide the terminal output, default=unused" << endl;
+	cout << "-l, --licensing          [N/A]        : view licensing information (no simulations will be run)" << endl;
+	cout << "-h, --help               [N/A]        : view usage information (i.e. this)" << endl;
+	cout << endl << term->blue << "Example: ./sres-sampler " << term->reset << endl << endl;
+	if (error) {
+		exit(EXIT_INPUT_ERROR);
+	} else {
+		exit(EXIT_SUCCESS);
+	}
+}
+
+/* licensing prints the program's copyright and licensing information and then exits
+	parameters:
+	returns: nothing
+	notes:
+	todo:
+*/
+void licensing () {
+	cout << endl;
+	cout << "Genetic algorithm sampler for zebrafish segmentation" << endl;
+	cout << "Copyright (C) 2013 Ahmet Ay (aay@colgate.edu), Jack Holland (jholland@colgate.edu), Adriana Sperlea (asperlea@colgate.edu), Sebastian Sangervasi (ssangervasi@colgate.edu)" << endl;
+	cout << "This program comes with ABSOLUTELY NO WARRANTY" << endl;
+	cout << "This is free software, and you are welcome to redistribute it under certain conditions;" << endl;
+	cout << "You can use this code and modify it as you wish under the condition that you refer to the article: \"Short-lived Her proteins drive robust synchronized oscillations in the zebrafish segmentation clock\" (Development 2013 140:3244-3253; doi:10.1242/dev.093278)" << endl;
+	cout << endl;
+	exit(EXIT_SUCCESS);
+}
+
 /* check_input_params checks that the given command-line arguments are semantically valid
 	parameters:
 		ip: the program's input parameters
@@ -248,12 +645,42 @@ void ensure_nonempty (const char* option, const char* arg) {
 	todo:
 */
 void check_input_params (input_params& ip) {
+	if (ip.compact_score_db) { // Compacting the score database needs nothing else
+		if (ip.score_db_file == NULL) {
+			usage("A score database must be specified to compact it! Set the score database with --score-db.");
+		}
+		return;
+	}
+	if (ip.sweep_file != NULL) { // Each run's arguments are checked once they are combined with its line of the sweep file
+		return;
+	}
 	if (ip.ranges_file == NULL) {
 		usage("A ranges file must be specified! Set the ranges file with -r or --ranges-file.");
 	}
 	if (ip.gradient_indices == NULL) {
 		usage("At least one parameter index must be altered by gradients! Add at least one instance of -i or --gradient-index to an index to alter.");
 	}
+	if (ip.mode == MODE_SAMPLE && !ip.print_good_sets) {
+		usage("The sampling mode streams its points to the good sets file, so one must be specified! Set the good sets file with -o or --print-good-sets.");
+	}
+	if (ip.resume && ip.mode != MODE_SAMPLE) {
+		usage("Only the sampling mode can be resumed! Set --mode to sample to resume a sampling run.");
+	}
+	if (ip.adaptive_jobs && ip.min_jobs > ip.jobs) {
+		usage("The fewest simulations to run at a time cannot exceed the most. Set --min-jobs to at most -j or --jobs.");
+	}
+	if (ip.engine != ENGINE_GA && ip.encoding == ENCODING_QUANTIZED) {
+		usage("Only the genetic algorithm can use the quantized encoding. Set --encoding to double to use --engine cmaes or de.");
+	}
+	if (ip.engine == ENGINE_CMAES && ip.population < 2) {
+		usage("The CMA-ES engine must sample at least two sets per generation. Set -p or --population to at least 2.");
+	}
+	if (ip.engine == ENGINE_DE && ip.population < 4) {
+		usage("Differential evolution needs at least four members to build a mutant from three others. Set -p or --population to at least 4.");
+	}
+	if (ip.encoding == ENCODING_QUANTIZED && (ip.init_oversample > 1 || ip.seed_population_file != NULL || ip.local_search != LOCAL_NONE || ip.threads > 1)) {
+		usage("The quantized encoding cannot be combined with --init-oversample, --seed-population, --local-search, or --threads yet. Set --encoding to double to use them.");
+	}
 }
 
 /* add_gradient_index adds an index to the given list of gradient indices
@@ -289,7 +716,7 @@ void init_verbosity (input_params& ip) {
 	}
 }
 
-/* create_good_sets_file creates a file to store the sets that received a good score
+/* create_good_sets_file creates a file to store the sets that received a good score and, if the user specified them, the quarantine file for sets whose simulations failed and the usage file for every simulation's resource use
 	parameters:
 		ip: the program's input parameters
 	returns: nothing
@@ -297,8 +724,18 @@ void init_verbosity (input_params& ip) {
 	todo:
 */
 void create_good_sets_file (input_params& ip) {
-	if (ip.print_good_sets) { // Print the good sets only if the user specified it
+	if (ip.print_good_sets && ip.resume) { // A resumed sampling run appends to the file it was interrupted writing
+		open_file(&(ip.good_sets_stream), ip.good_sets_file, true);
+	} else if (ip.print_good_sets) { // Print the good sets only if the user specified it
 		open_file(&(ip.good_sets_stream), ip.good_sets_file, false);
+		write_good_sets_header(ip);
+	}
+	if (ip.quarantine_file != NULL) {
+		open_file(&(ip.quarantine_stream), ip.quarantine_file, false);
+	}
+	if (ip.usage_file != NULL) {
+		open_file(&(ip.usage_stream), ip.usage_file, false);
+		ip.usage_stream << "# " << ip.num_dims << " parameters,score,user_seconds,system_seconds,max_rss_kb,in_blocks,out_blocks" << endl;
 	}
 }
 
@@ -326,6 +763,18 @@ void init_sim_args (input_params& ip) {
 	ip.sim_args[ip.num_sim_args - 1] = NULL;
 }
 
+/* init_simd chooses the instruction set the genetic algorithm's kernels use
+	parameters:
+		ip: the program's input parameters
+	returns: nothing
+	notes:
+	todo:
+*/
+void init_simd (input_params& ip) {
+	int chosen = init_kernels(ip.simd);
+	term->verbose() << term->blue << "Using " << term->reset << kernel_name(chosen) << " kernels for mutation and crossover" << endl;
+}
+
 /* copy_args copies the given array of arguments
 	parameters:
 		args: the array of arguments to copy
@@ -382,6 +831,8 @@ void store_pipe (char** args, int index, int pipe) {
 */
 void delete_files (input_params& ip) {
 	close_if_open(ip.good_sets_stream);
+	close_if_open(ip.quarantine_stream);
+	close_if_open(ip.usage_stream);
 }
 
 /* reset_cout resets the cout buffer to its original stream if quiet mode was on and cout was therefore redirected to /dev/null
@@ -26,9 +26,12 @@ init.hpp contains function declarations for init.cpp.
 #define INIT_HPP
 
 char* copy_str(const char*);
+double wall_time();
 void init_terminal();
 void free_terminal();
 void accept_input_params(int, char**, input_params&);
+void usage(const char*);
+void licensing();
 bool option_set(const char*, const char*, const char*);
 void ensure_nonempty(const char*, const char*);
 void check_input_params(input_params&);
@@ -36,6 +39,7 @@ void add_gradient_index(gradient_index**, int);
 void init_verbosity(input_params&);
 void create_good_sets_file(input_params&);
 void init_sim_args(input_params&);
+void init_simd(input_params&);
 char** copy_args(char**, int);
 void read_ranges(input_params&, input_data&);
 void store_pipe(char**, int, int);
@@ -16,14 +16,28 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm> // Needed for min, max
+#include <cctype> // Needed for isspace
+#include <cerrno> // Needed for errno
 #include <cmath> // Needed for log10
-#include <sys/wait.h> // Needed for waitpid
+#include <csignal> // Needed for signal
+#include <cstdlib> // Needed for strtod
+#include <fcntl.h> // Needed for open
+#include <sstream> // Needed for ostringstream
+#include <sys/mman.h> // Needed for mmap, madvise, munmap
+#include <sys/resource.h> // Needed for rusage
+#include <sys/stat.h> // Needed for stat, fstat
+#include <sys/syscall.h> // Needed for SYS_pidfd_open
+#include <sys/wait.h> // Needed for wait4
 #include <unistd.h> // Needed for pipe, read, write, close, fork, execv
 
 #include "io.hpp" // Function declarations
 
+#include "constraints.hpp"
+#include "hash.hpp"
 #include "init.hpp"
 #include "macros.hpp"
+#include "workers.hpp"
 
 extern terminal* term; // Declared in init.cpp
 
@@ -86,6 +100,17 @@ void read_file (input_data* ifd) {
 	term->done(v);
 }
 
+/* is_constraint checks whether the given line of a ranges file is a constraint
+	parameters:
+		line: the start of the line
+	returns: true if the line starts with the word 'constraint', false otherwise
+	notes:
+	todo:
+*/
+static bool is_constraint (const char* line) {
+	return strncmp(line, "constraint", 10) == 0 && isspace(line[10]);
+}
+
 /* parse_ranges_file reads the given buffer and stores every range found in the given ranges array
 	parameters:
 		buffer: the buffer with the ranges to read
@@ -97,27 +122,41 @@ void read_file (input_data* ifd) {
 		e.g. 'msh1 [30, 65] comment'
 		The name of the parameter is so humans can conveniently read the file and has no semantic value to this parser.
 		Blank lines and lines starting with # will be ignored. Anything after the upper bound is ignored.
+		Lines starting with 'constraint' give linear inequalities every valid parameter set satisfies, naming parameters by their names with spaces written as underscores, e.g. 'constraint gradient_end - gradient_start >= 2'. They may come before or after the ranges.
 	todo:
 */
 void parse_ranges_file (char* buffer, input_params& ip) {
 	int i = 0;
 	int rate = 0;
+	char** names = (char**)mallocate(sizeof(char*) * ip.num_dims);
+	for (int j = 0; j < ip.num_dims; j++) {
+		names[j] = NULL;
+	}
 	for (; buffer[i] != '\0'; i++) {
-		// Ensure that the number of rates in the given ranges file does not exceed the given number of dimensions
-		if (rate >= ip.num_dims) {
-			cout << term->red << "The number of rates in the given ranges file does not match the given number of dimensions! Please check that the rates file matches the number of dimensions (" << ip.num_dims << ")." << term->reset << endl;
-		exit(EXIT_INPUT_ERROR);
-		}
-		
-		// Ignore lines starting with #
-		while (buffer[i] == '#') {
+		// Ignore blank lines, lines starting with #, and constraints, which are read once every parameter's name is known
+		while (isspace(buffer[i]) || buffer[i] == '#' || is_constraint(buffer + i)) {
+			if (isspace(buffer[i])) {
+				i++;
+				continue;
+			}
 			while (buffer[i] != '\n' && buffer[i] != '\0') {i++;}
-			i++;			
 		}
 		
-		// Ignore whitespace before the opening bracket
+		// Read the name up to the opening bracket
+		int name_start = i;
 		while (buffer[i] != '[' && buffer[i] != '\0') {i++;}
 		if (buffer[i] == '\0') {break;}
+		
+		// Ensure that the number of rates in the given ranges file does not exceed the given number of dimensions
+		if (rate >= ip.num_dims) {
+			cout << term->red << "The number of rates in the given ranges file does not match the given number of dimensions! Please check that the rates file matches the number of dimensions (" << ip.num_dims << ")." << term->reset << endl;
+			exit(EXIT_INPUT_ERROR);
+		}
+		int name_end = i;
+		while (name_end > name_start && isspace(buffer[name_end - 1])) {name_end--;}
+		names[rate] = (char*)mallocate(name_end - name_start + 1);
+		memcpy(names[rate], buffer + name_start, name_end - name_start);
+		names[rate][name_end - name_start] = '\0';
 		i++;
 		
 		// Read the bounds
@@ -135,7 +174,26 @@ void parse_ranges_file (char* buffer, input_params& ip) {
 		// Skip any comments until the end of the line
 		while (buffer[i] != '\n' && buffer[i] != '\0') {i++;}
 		rate++;
+		if (buffer[i] == '\0') {break;}
+	}
+	
+	// Read the constraints
+	for (i = 0; buffer[i] != '\0'; i++) {
+		while (buffer[i] == ' ' || buffer[i] == '\t') {i++;}
+		int line_start = i;
+		while (buffer[i] != '\n' && buffer[i] != '\0') {i++;}
+		if (is_constraint(buffer + line_start)) {
+			char end = buffer[i];
+			buffer[i] = '\0';
+			add_constraint(ip, buffer + line_start + strlen("constraint"), names);
+			buffer[i] = end;
+		}
+		if (buffer[i] == '\0') {break;}
 	}
+	for (int j = 0; j < ip.num_dims; j++) {
+		mfree(names[j]);
+	}
+	mfree(names);
 }
 
 /* open_file opens the file with the given name and stores it in the given output file stream
@@ -165,163 +223,428 @@ void open_file (ofstream* file_pointer, const char* file_name, bool append) {
 	term->done(v);
 }
 
-/* simulate_set performs the required piping to setup and run a simulation with the given parameters
+/* simulate_set performs the required piping to setup and run a simulation with the given parameters and waits for its score
 	parameters:
+		ip: the program's input parameters
 		parameters: the parameters to pass as a parameter set to the simulation
-	returns: the score the simulation received
+	returns: the score the simulation received, or the failure score if every attempt failed
 	notes:
+		To run several simulations at once, use simulate_batch instead.
 	todo:
 */
 double simulate_set (input_params& ip, int parameters[]) {
+	double score;
+	simulate_batch(ip, parameters, 1, &score, NULL);
+	return score;
+}
+
+/* gradients_filename stores the name of a new gradients file in the given buffer
+	parameters:
+		buffer: the buffer to store the name in, at least 40 bytes long
+	returns: nothing
+	notes:
+		Each simulation gets its own file, named by the program's process ID and a count of the files named so far, so simulations can run at the same time in the same directory. The name is chosen before the simulation is forked, so the file can be written before then.
+	todo:
+*/
+static void gradients_filename (char* buffer) {
+	static int num_named = 0;
+	sprintf(buffer, "input.gradients.%d.%d", (int)getpid(), __sync_fetch_and_add(&num_named, 1));
+}
+
+/* write_gradients writes the gradients file the simulation for the given parameters reads
+	parameters:
+		ip: the program's input parameters
+		parameters: the parameter set being simulated
+		filename: the name of the file to write
+	returns: nothing
+	notes:
+	todo:
+*/
+static void write_gradients (input_params& ip, int parameters[], const char* filename) {
+	ofstream grad_file;
+	term->verbose() << "  ";
+	open_file(&grad_file, filename, false);
+	grad_file << "2 (11 100) (35 0)\n";
+	int loc_start = parameters[0];
+	int loc_end = parameters[1];
+	int val = parameters[2];
+	gradient_index* gi = ip.gradient_indices;
+	while (gi != NULL) {
+		grad_file << gi->index << " (" << loc_start << " 100) (" << loc_end << " " << val << ")\n";
+		gi = gi->next;
+	}
+	grad_file.close();
+}
+
+/* write_message writes the given message to standard output in the given color without allocating or locking
+	parameters:
+		color: the terminal color to write the message in
+		message: the message
+	returns: nothing
+	notes:
+		This is for forked children, which may only make async-signal-safe calls before they execute the simulation, since another thread may have held the allocator's or cout's lock when the program forked.
+	todo:
+*/
+static void write_message (const char* color, const char* message) {
+	if (write(STDOUT_FILENO, color, strlen(color)) == -1 || write(STDOUT_FILENO, message, strlen(message)) == -1 || write(STDOUT_FILENO, term->reset, strlen(term->reset)) == -1) {
+		return;
+	}
+}
+
+/* launch_simulation forks a simulation for the given parameters and sends it the parameters without waiting for it to finish
+	parameters:
+		ip: the program's input parameters
+		parameters: the parameters to pass as a parameter set to the simulation
+		slot: the worker slot to run the simulation in
+		sim: the simulation struct to store the running simulation's state in
+	returns: true if the simulation was launched, false if a pipe or the process could not be created (e.g. because the system is out of processes or file descriptors for now)
+	notes:
+		The simulation reads its parameters from one pipe and writes its score to another, so the parent never sees its own writes when it watches for the score. The parent closes its copy of the score pipe's writing end, so the pipe reaches end-of-file when the simulation exits.
+		The child is pinned to its slot's CPUs if the user pinned simulations.
+		If the simulation exits before reading its parameters, writing them fails quietly and complete_simulation reports the failure.
+		Every launched simulation must be passed to complete_simulation once it has been reaped and its output read.
+	todo:
+*/
+bool launch_simulation (input_params& ip, int parameters[], int slot, simulation* sim) {
 	ostream& v = term->verbose();
+	*sim = simulation();
+	sim->slot = slot;
+	sim->parameters = parameters;
 	
-	// Create a pipe
-	int pipes[2];
-	v << term->blue << "  Creating a pipe " << term->reset << ". . . ";
-	if (pipe(pipes) == -1) {
-		term->failed_pipe_create();
-		exit(EXIT_PIPE_CREATE_ERROR);
-	}
-	v << term->blue << "Done: " << term->reset << "using file descriptors " << pipes[0] << " and " << pipes[1] << endl;
+	// Create the pipes, closed on exec so other simulations do not inherit them
+	int in_pipes[2];
+	int out_pipes[2];
+	v << term->blue << "  Creating pipes " << term->reset << ". . . ";
+	if (pipe2(in_pipes, O_CLOEXEC) == -1) {
+		v << term->yellow << "Couldn't create a pipe (" << strerror(errno) << ")" << term->reset << endl;
+		return false;
+	}
+	if (pipe2(out_pipes, O_CLOEXEC) == -1) {
+		v << term->yellow << "Couldn't create a pipe (" << strerror(errno) << ")" << term->reset << endl;
+		close(in_pipes[0]);
+		close(in_pipes[1]);
+		return false;
+	}
+	v << term->blue << "Done: " << term->reset << "using file descriptors " << in_pipes[1] << " and " << out_pipes[0] << endl;
+	
+	// Build the simulation's arguments and write its gradients file before forking, since the child may not allocate or write streams
+	gradients_filename(sim->gradients_file);
+	write_gradients(ip, parameters, sim->gradients_file);
+	char** sim_args = copy_args(ip.sim_args, ip.num_sim_args);
+	store_pipe(sim_args, ip.num_sim_args - 6, in_pipes[0]);
+	store_pipe(sim_args, ip.num_sim_args - 4, out_pipes[1]);
+	mfree(sim_args[ip.num_sim_args - 2]);
+	sim_args[ip.num_sim_args - 2] = copy_str(sim->gradients_file);
 	
 	// Fork the process
 	v << term->blue << "  Forking the process " << term->reset << ". . . ";
 	pid_t pid = fork();
-	if (pid == -1) {
-		term->failed_fork();
-		exit(EXIT_FORK_ERROR);
+	if (pid != 0) {
+		for (int i = 0; i < ip.num_sim_args; i++) {
+			mfree(sim_args[i]);
+		}
+		mfree(sim_args);
 	}
-	
-	// Get the child PID
-	int child_pid;
-	if (pid == 0) {
-		child_pid = getpid();
-	} else {
-		child_pid = pid;
-		term->verbose() << term->blue << "Done: " << term->reset << "the child process's PID is " << child_pid << endl;
+	if (pid == -1) {
+		v << term->yellow << "Couldn't fork (" << strerror(errno) << ")" << term->reset << endl;
+		remove(sim->gradients_file);
+		close(in_pipes[0]);
+		close(in_pipes[1]);
+		close(out_pipes[0]);
+		close(out_pipes[1]);
+		return false;
 	}
-	const char* grad_fname = "input.gradients";
+	sim->pid = pid;
 	
-	if (pid == 0) { // Child process
-		char** sim_args = copy_args(ip.sim_args, ip.num_sim_args);
-		store_pipe(sim_args, ip.num_sim_args - 6, pipes[0]);
-		store_pipe(sim_args, ip.num_sim_args - 4, pipes[1]);
-		sim_args[ip.num_sim_args - 2] = copy_str(grad_fname);
-		
-		ofstream grad_file;
-		v << "  ";
-		open_file(&grad_file, grad_fname, false);
-		grad_file << "2 (11 100) (35 0)\n";
-		int loc_start = parameters[0];
-		int loc_end = parameters[1];
-		int val = parameters[2];
-		gradient_index* gi = ip.gradient_indices;
-		while (gi != NULL) {
-			grad_file << gi->index << " (" << loc_start << " 100) (" << loc_end << " " << val << ")\n";
-			gi = gi->next;
+	if (pid == 0) { // Child process, which only makes async-signal-safe calls until it executes the simulation
+		fcntl(in_pipes[0], F_SETFD, 0);
+		fcntl(out_pipes[1], F_SETFD, 0);
+		signal(SIGPIPE, SIG_DFL); // The parent ignores it, which exec would otherwise pass on
+		if (!pin_worker(ip, slot)) {
+			write_message(term->red, "Couldn't pin a simulation to its slot's CPUs!\n");
 		}
-		grad_file.close();
+		execv(ip.sim_file, sim_args);
+		write_message(term->red, "Couldn't execute an external program!\n");
+		_exit(EXIT_EXEC_ERROR);
+	} else { // Parent process
+		close(in_pipes[0]);
+		close(out_pipes[1]);
+		v << term->blue << "Done: " << term->reset << "the child process's PID is " << pid << endl;
+		sim->out_fd = out_pipes[0];
+		#if defined(SYS_pidfd_open)
+			sim->pidfd = syscall(SYS_pidfd_open, pid, 0);
+		#endif
 		
-		v << term->blue << "  Checking that the simulation file exists and can be executed " << term->reset << ". . . ";
-		if (access(ip.sim_file, X_OK) == -1) {
-			term->failed_exec();
-			exit(EXIT_EXEC_ERROR);
+		double par_set[45] = {43.293101,35.644504,59.878872,33.936686,0.223278,0.329523,0.132647,0.444597,29.458387,11.188829,57.157834,31.077192,0.150681,0.337684,0.211113,0.273550,0.023943,0.004624,0.029139,0.014844,0.018960,0.015933,0.022060,0.155977,0.189065,0.086577,0.018705,0.153521,0.325447,0.249461,0.159769,0.260633,0.254341,0.113651,10.412648,8.563572,0.000000,9.775344,1.310268,1.698853,1.786119,10.892998,599.559977,253.564367,241.127021};
+		v << term->blue << "  Writing to the pipe " << term->reset << "(file descriptor " << in_pipes[1] << ") . . . ";
+		bool written = write_pipe(in_pipes[1], par_set);
+		close(in_pipes[1]);
+		if (written) {
+			term->done(v);
+		} else {
+			v << term->yellow << "The simulation stopped reading (" << strerror(errno) << ")" << term->reset << endl;
 		}
-		term->done(v);
-		if (execv(ip.sim_file, sim_args) == -1) {
-			term->failed_exec();
-			exit(EXIT_EXEC_ERROR);
+	}
+	return true;
+}
+
+/* read_simulation_output reads whatever the given simulation has written to its output pipe without blocking
+	parameters:
+		sim: the simulation to read from, whose output pipe is readable
+	returns: true if the pipe has reached end-of-file, false otherwise
+	notes:
+		Only the first two integers (the maximum score and the score) are kept; anything else is read and discarded so a verbose simulation cannot fill the pipe and block.
+		The pipe is left open for the caller to close once it has reached end-of-file.
+	todo:
+*/
+bool read_simulation_output (simulation* sim) {
+	char buffer[4096];
+	ssize_t bytes = read(sim->out_fd, buffer, sizeof(buffer));
+	if (bytes == -1) {
+		if (errno == EINTR || errno == EAGAIN) {
+			return false;
 		}
-	} else { // Parent process
-		double par_set[45] = {43.293101,35.644504,59.878872,33.936686,0.223278,0.329523,0.132647,0.444597,29.458387,11.188829,57.157834,31.077192,0.150681,0.337684,0.211113,0.273550,0.023943,0.004624,0.029139,0.014844,0.018960,0.015933,0.022060,0.155977,0.189065,0.086577,0.018705,0.153521,0.325447,0.249461,0.159769,0.260633,0.254341,0.113651,10.412648,8.563572,0.000000,9.775344,1.310268,1.698853,1.786119,10.892998,599.559977,253.564367,241.127021};
-		v << term->blue << "  Writing to the pipe " << term->reset << "(file descriptor " << pipes[1] << ") . . . ";
-		write_pipe(pipes[1], par_set);
-		term->done(v);
+		term->failed_pipe_read();
+		exit(EXIT_PIPE_READ_ERROR);
 	}
-	
-	// Wait for the child to finish simulating
-	int status = 0;
-	waitpid(pid, &status, WUNTRACED);
-	if (WIFEXITED(status) == 0) {
-		term->failed_child();
-		exit(EXIT_CHILD_ERROR);
+	if (bytes == 0) {
+		return true;
 	}
-	
-	// Close the writing end of the pipe
-	if (close(pipes[1]) == -1) {
-		term->failed_pipe_write();
-		exit(EXIT_PIPE_WRITE_ERROR);
+	int wanted = sizeof(sim->output) - sim->bytes_read;
+	if (wanted > 0) {
+		memcpy((char*)sim->output + sim->bytes_read, buffer, min((int)bytes, wanted));
+	}
+	sim->bytes_read += bytes;
+	return false;
+}
+
+/* reap_simulation reaps the given simulation's process if it has exited, without blocking, and stores the resources it used
+	parameters:
+		sim: the simulation to reap
+	returns: true if the process has been reaped, false if it is still running
+	notes:
+		wait4 reports the resources the process and any children it waited for used, so a simulation that runs helper processes is charged for them too.
+	todo:
+*/
+bool reap_simulation (simulation* sim) {
+	rusage usage;
+	if (!sim->reaped && wait4(sim->pid, &(sim->status), WNOHANG, &usage) == sim->pid) {
+		sim->reaped = true;
+		sim->usage.simulations = 1;
+		sim->usage.user_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+		sim->usage.system_seconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+		sim->usage.max_rss = usage.ru_maxrss;
+		sim->usage.in_blocks = usage.ru_inblock;
+		sim->usage.out_blocks = usage.ru_oublock;
+	}
+	return sim->reaped;
+}
+
+/* complete_simulation checks the result of the given finished simulation, cleans up after it, and returns its score
+	parameters:
+		ip: the program's input parameters
+		sim: the simulation, which must be reaped and have read its output to end-of-file
+		score: a pointer to store the score the simulation received in
+	returns: true if the simulation sent a score, false if it crashed or exited without one, in which case sim->failure says which
+	notes:
+		Any of the simulation's file descriptors still open are closed here.
+		Good sets are printed to the good sets file here (see print_good_set).
+		A gradient file that cannot be removed after its simulation was scored is left behind with a warning and counted in ip.failures; the score is kept.
+	todo:
+*/
+bool complete_simulation (input_params& ip, simulation* sim, double* score) {
+	ostream& v = term->verbose();
+	int* parameters = sim->parameters;
+	const char* grad_fname = sim->gradients_file;
+	if (sim->out_fd != -1) {
+		close(sim->out_fd);
+		sim->out_fd = -1;
+	}
+	if (sim->pidfd != -1) {
+		close(sim->pidfd);
+		sim->pidfd = -1;
 	}
 	
-	// Pipe in the simulation's score
-	int max_score;
-	int score;
-	v << term->blue << "  Reading the pipe " << term->reset << "(file descriptor " << pipes[0] << ") . . . ";
-	read_pipe(pipes[0], &max_score, &score);
-	v << term->blue << "Done: " << term->reset << "(raw score " << score << " / " << max_score << ")" << endl;
-	
-	// Close the reading end of the pipe
-	v << term->blue << "  Closing the reading end of the pipe " << term->reset << "(file descriptor " << pipes[0] << ") . . . ";
-	if (close(pipes[0]) == -1) {
-		term->failed_pipe_read();
-		exit(EXIT_PIPE_WRITE_ERROR);
+	// Check that the child exited properly and sent a score, removing whatever gradient file a failed child left behind
+	if (WIFEXITED(sim->status) == 0 || sim->bytes_read < (int)sizeof(sim->output)) {
+		if (sim->cancelled) {
+			sim->failure = "cancelled";
+		} else if (WIFSIGNALED(sim->status)) {
+			sim->failure = "crashed";
+			cout << term->yellow << "The simulation with PID " << sim->pid << " crashed with signal " << WTERMSIG(sim->status) << "!" << term->reset << endl;
+		} else {
+			sim->failure = "exited without a score";
+			cout << term->yellow << "The simulation with PID " << sim->pid << " exited with status " << WEXITSTATUS(sim->status) << " without sending a score!" << term->reset << endl;
+		}
+		remove(grad_fname);
+		return false;
 	}
-	term->done(v);
+	int max_score = sim->output[0];
+	int raw_score = sim->output[1];
+	v << term->blue << "  Read the score " << term->reset << "of PID " << sim->pid << " (raw score " << raw_score << " / " << max_score << ")" << endl;
 	
-	// Remove the gradient file
+	// Remove the gradient file, leaving it behind rather than throwing away the score if it cannot be
 	v << term->blue << "  Removing " << term->reset << grad_fname << " . . . ";
 	if (remove(grad_fname) != 0) {
-		term->failed_file_remove(grad_fname);
-		exit(EXIT_FILE_REMOVE_ERROR);
+		cout << term->yellow << "Couldn't remove '" << grad_fname << "' (" << strerror(errno) << "), but kept its simulation's score" << term->reset << endl;
+		ip.failures.leftovers++;
+	} else {
+		term->done(v);
 	}
-	term->done(v);
 	
 	// libSRES requires scores from 0 to 1 with 0 being a perfect score so convert the simulation's score format into libSRES's
-	double score_final = 1 - ((double)score / max_score);
+	*score = 1 - ((double)raw_score / max_score);
 	
-	// Print the score if the user specified printing good sets and this set is good enough
-	if (ip.print_good_sets && score_final <= ip.good_set_threshold) {
-		cout << term->blue << "  Found a good set " << term->reset << "(score " << score_final << ")" << endl;
+	print_good_set(ip, parameters, *score);
+	return true;
+}
+
+/* account_simulation adds the resources the given completed simulation used to the current evaluation's usage and lists them in the usage file if the user specified one
+	parameters:
+		ip: the program's input parameters
+		sim: the simulation, which must be reaped
+		score: the score the simulation received, ignored if it failed
+	returns: nothing
+	notes:
+		Failed attempts are listed with why they failed instead of a score, since the sets that make the simulation blow up are often the ones worth finding.
+	todo:
+*/
+void account_simulation (input_params& ip, simulation* sim, double score) {
+	ip.usage.add(sim->usage);
+	if (ip.usage_file != NULL) {
+		ip.usage_stream << sim->parameters[0];
+		for (int i = 1; i < ip.num_dims; i++) {
+			ip.usage_stream << "," << sim->parameters[i];
+		}
+		if (sim->failure != NULL) {
+			ip.usage_stream << "," << sim->failure;
+		} else {
+			ip.usage_stream << "," << score;
+		}
+		resource_usage& u = sim->usage;
+		ip.usage_stream << "," << u.user_seconds << "," << u.system_seconds << "," << u.max_rss << "," << u.in_blocks << "," << u.out_blocks << "\n";
+	}
+}
+
+/* quarantine_set lists the given parameter set in the quarantine file if the user specified one
+	parameters:
+		ip: the program's input parameters
+		parameters: the parameter set whose simulations failed every attempt
+		reason: why the last attempt failed
+		attempts: the number of attempts
+	returns: nothing
+	notes:
+	todo:
+*/
+void quarantine_set (input_params& ip, const int parameters[], const char* reason, int attempts) {
+	cout << term->yellow << "Giving up on a set " << term->reset << "after " << attempts << " failed attempts and scoring it " << ip.failure_score << endl;
+	if (ip.quarantine_file != NULL) {
+		ip.quarantine_stream << parameters[0];
+		for (int i = 1; i < ip.num_dims; i++) {
+			ip.quarantine_stream << "," << parameters[i];
+		}
+		ip.quarantine_stream << "," << reason << "," << attempts << endl;
+	}
+}
+
+/* write_checkpoint writes a run's final population to the checkpoint file, replacing it atomically
+	parameters:
+		ip: the program's input parameters
+		sets: the best set followed by the population's sets, stored consecutively
+		count: the number of sets
+		best_score: the best set's score
+	returns: nothing
+	notes:
+		The file has the good sets file's format, so --seed-population can continue the run from it. Only the best set's score is written, since the other members' scores may be predictions or may have been left unscored when a budget ran out; with a score database, their simulations are recalled rather than run again.
+	todo:
+*/
+void write_checkpoint (input_params& ip, const int* sets, int count, double best_score) {
+	char* temporary = (char*)mallocate(strlen(ip.checkpoint_file) + 5);
+	sprintf(temporary, "%s.tmp", ip.checkpoint_file);
+	char* sig = config_signature(ip);
+	ofstream checkpoint;
+	open_file(&checkpoint, temporary, false);
+	checkpoint << "# config " << sig << endl;
+	for (int i = 0; i < count; i++) {
+		const int* set = sets + i * ip.num_dims;
+		checkpoint << set[0];
+		for (int j = 1; j < ip.num_dims; j++) {
+			checkpoint << "," << set[j];
+		}
+		if (i == 0) {
+			checkpoint << "," << best_score;
+		}
+		checkpoint << endl;
+	}
+	checkpoint.close();
+	if (checkpoint.fail() || rename(temporary, ip.checkpoint_file) != 0) {
+		cout << term->red << "Couldn't write to " << ip.checkpoint_file << "!" << term->reset << endl;
+		exit(EXIT_FILE_WRITE_ERROR);
+	}
+	cout << term->blue << "Wrote the checkpoint " << term->reset << ip.checkpoint_file << endl;
+	mfree(sig);
+	mfree(temporary);
+}
+
+/* print_failures prints how many of the run's simulations failed and what was done about them, if any did
+	parameters:
+		ip: the program's input parameters
+	returns: nothing
+	notes:
+	todo:
+*/
+void print_failures (input_params& ip) {
+	failure_counts& f = ip.failures;
+	if (f.failed > 0 || f.backoffs > 0) {
+		cout << term->yellow << "Failures: " << term->reset << f.failed << " failed simulations, " << f.retried << " retried, " << f.penalized << " sets given the failure score, " << f.backoffs << " launches backed off" << endl;
+	}
+	if (f.leftovers > 0) {
+		cout << term->yellow << "Leftovers: " << term->reset << f.leftovers << " gradient files couldn't be removed after their simulations were scored" << endl;
+	}
+}
+
+/* print_good_set prints the given parameter set and its score to the good sets file if the user specified printing good sets and the set is good enough
+	parameters:
+		ip: the program's input parameters
+		parameters: the parameter set
+		score: the set's score
+	returns: nothing
+	notes:
+	todo:
+*/
+void print_good_set (input_params& ip, const int parameters[], double score) {
+	if (ip.print_good_sets && score <= ip.good_set_threshold) {
+		cout << term->blue << "  Found a good set " << term->reset << "(score " << score << ")" << endl;
 		ip.good_sets_stream << parameters[0];
 		for (int i = 1; i < ip.num_dims; i++) {
 			ip.good_sets_stream << "," << parameters[i];
 		}
-		ip.good_sets_stream << endl;
+		ip.good_sets_stream << "," << score << endl;
 	}
-	
-	return score_final;
 }
 
 /* write_pipe writes the given parameter set to the given pipe
 	parameters:
 		fd: the file descriptor of the pipe to write to
 		parameters: the parameter set to pipe
-	returns: nothing
+	returns: true if the parameter set was written, false otherwise
 	notes:
 	todo:
 */
-void write_pipe (int fd, double parameters[]) {
-	write_pipe_int(fd, 45);
-	write_pipe_int(fd, 1);
-	if (write(fd, parameters, sizeof(double) * 45) == -1) {
-		term->failed_pipe_write();
-		exit(EXIT_PIPE_WRITE_ERROR);
-	}
+bool write_pipe (int fd, double parameters[]) {
+	return write_pipe_int(fd, 45) && write_pipe_int(fd, 1) && write(fd, parameters, sizeof(double) * 45) != -1;
 }
 
 /* write_pipe_int writes the given integer to the given pipe
 	parameters:
 		fd: the file descriptor of the pipe to write to
 		value: the integer to pipe
-	returns: nothing
+	returns: true if the integer was written, false otherwise
 	notes:
 	todo:
 */
-void write_pipe_int (int fd, int value) {
-	if (write(fd, &value, sizeof(int)) == -1) {
-		term->failed_pipe_write();
-		exit(EXIT_PIPE_WRITE_ERROR);
-	}
+bool write_pipe_int (int fd, int value) {
+	return write(fd, &value, sizeof(int)) != -1;
 }
 
 /* read_pipe reads the maximum score and the received score from the given pipe
@@ -366,4 +689,175 @@ void close_if_open (ofstream& file) {
 	}
 }
 
+/* config_signature describes the simulation configuration that scores depend on
+	parameters:
+		ip: the program's input parameters
+	returns: a newly allocated string with the simulation's path, size, and modification time, the arguments passed to it, and the gradient indices
+	notes:
+		Scores recorded under one signature are only valid for runs with the same signature. The simulation's size and modification time are included so rebuilding the simulation invalidates old scores.
+	todo:
+*/
+char* config_signature (input_params& ip) {
+	ostringstream sig;
+	sig << "simulation=" << ip.sim_file;
+	struct stat sim_stat;
+	if (stat(ip.sim_file, &sim_stat) == 0) {
+		sig << " size=" << sim_stat.st_size << " modified=" << sim_stat.st_mtime;
+	}
+	sig << " arguments=";
+	for (int i = 1; i < ip.num_sim_args - (NUM_IMPLICIT_SIM_ARGS - 1); i++) {
+		sig << (i > 1 ? " " : "") << ip.sim_args[i];
+	}
+	sig << " gradient-indices=";
+	for (gradient_index* gi = ip.gradient_indices; gi != NULL; gi = gi->next) {
+		sig << gi->index << (gi->next != NULL ? "," : "");
+	}
+	return copy_str(sig.str().c_str());
+}
+
+/* write_good_sets_header writes the comment line identifying the simulation configuration to the top of the good sets file
+	parameters:
+		ip: the program's input parameters
+	returns: nothing
+	notes:
+		read_seed_population compares this line to the current configuration before reusing the file's scores.
+	todo:
+*/
+void write_good_sets_header (input_params& ip) {
+	char* sig = config_signature(ip);
+	ip.good_sets_stream << "# config " << sig << endl;
+	mfree(sig);
+}
+
+/* parse_int parses a nonnegative or negative decimal integer from the given bounded text
+	parameters:
+		pos: a pointer to the position to parse from, advanced past the integer
+		end: the end of the text
+		value: a pointer to store the integer in
+	returns: true if an integer was found, false otherwise
+	notes:
+		Unlike atoi, this never reads past end, which mapped files require since they are not null-terminated.
+	todo:
+*/
+static bool parse_int (const char** pos, const char* end, int* value) {
+	const char* p = *pos;
+	bool negative = p < end && *p == '-';
+	if (negative) {
+		p++;
+	}
+	if (p == end || *p < '0' || *p > '9') {
+		return false;
+	}
+	int result = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++) {
+		result = result * 10 + (*p - '0');
+	}
+	*value = negative ? -result : result;
+	*pos = p;
+	return true;
+}
+
+/* read_seed_population reads the parameter sets (and their scores, when valid) from a good sets file written by an earlier run
+	parameters:
+		ip: the program's input parameters
+	returns: a new table of the file's distinct sets, clipped to the current ranges, with a score of -1 for sets whose scores cannot be reused
+	notes:
+		The file is memory-mapped and parsed in place rather than read into a buffer, so large files are streamed through the page cache.
+		Each line holds one set's comma-separated parameters, optionally followed by its score. Scores are only kept if the file's config comment matches the current configuration (see config_signature). Lines with the wrong number of fields are skipped.
+		A clipped set is not the set its score was measured for, so its score is never reused. Clipping can make different sets identical; the first valid score is kept.
+	todo:
+*/
+score_table* read_seed_population (input_params& ip) {
+	ostream& v = term->verbose();
+	v << term->blue << "Reading seed population " << term->reset << ip.seed_population_file << " . . . ";
+	
+	int fd = open(ip.seed_population_file, O_RDONLY);
+	struct stat file_stat;
+	if (fd == -1 || fstat(fd, &file_stat) == -1) {
+		cout << term->red << "Couldn't open " << ip.seed_population_file << "!" << term->reset << endl;
+		exit(EXIT_FILE_READ_ERROR);
+	}
+	score_table* seeds = new score_table(ip.num_dims);
+	if (file_stat.st_size == 0) {
+		close(fd);
+		term->done(v);
+		return seeds;
+	}
+	char* data = (char*)mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		cout << term->red << "Couldn't read from " << ip.seed_population_file << term->reset << endl;
+		exit(EXIT_FILE_READ_ERROR);
+	}
+	madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+	
+	char* sig = config_signature(ip);
+	int sig_length = strlen(sig);
+	bool scores_valid = false;
+	int set[ip.num_dims];
+	const char* end = data + file_stat.st_size;
+	const char* line = data;
+	while (line < end) {
+		const char* line_end = (const char*)memchr(line, '\n', end - line);
+		if (line_end == NULL) {
+			line_end = end;
+		}
+		
+		if (*line == '#') { // Comments are ignored except for the config line
+			const char* header = "# config ";
+			int header_length = strlen(header);
+			if (line_end - line >= header_length && strncmp(line, header, header_length) == 0) {
+				const char* file_sig = line + header_length;
+				scores_valid = line_end - file_sig == sig_length && strncmp(file_sig, sig, sig_length) == 0;
+			}
+		} else {
+			// Read the parameters, clipping each to its range
+			const char* pos = line;
+			bool valid = true;
+			bool clipped = false;
+			for (int i = 0; i < ip.num_dims && valid; i++) {
+				if (i > 0) {
+					valid = pos < line_end && *pos++ == ',';
+				}
+				if (valid && parse_int(&pos, line_end, set + i)) {
+					int value = min(max(set[i], ip.ranges[i].first), ip.ranges[i].second);
+					clipped = clipped || value != set[i];
+					set[i] = value;
+				} else {
+					valid = false;
+				}
+			}
+			
+			// Read the score, if there is one, which must be the last field
+			double score = -1;
+			if (valid && pos < line_end && *pos != '\r') {
+				char score_text[64];
+				int length = min((int)(line_end - pos - 1), (int)sizeof(score_text) - 1);
+				memcpy(score_text, pos + 1, length);
+				score_text[length] = '\0';
+				char* score_end;
+				score = strtod(score_text, &score_end);
+				valid = *pos == ',' && score_end != score_text && (*score_end == '\0' || *score_end == '\r');
+				if (!scores_valid || clipped) {
+					score = -1;
+				}
+			}
+			
+			double existing;
+			if (valid && (!score_table_find(seeds, set, &existing) || (existing < 0 && score >= 0))) {
+				score_table_insert(seeds, set, score);
+			}
+		}
+		line = line_end + 1;
+	}
+	
+	mfree(sig);
+	munmap(data, file_stat.st_size);
+	close(fd);
+	v << term->blue << "Done: " << term->reset << "found " << seeds->size << " distinct sets";
+	if (!scores_valid) {
+		v << " (their scores are from a different configuration and will not be reused)";
+	}
+	v << endl;
+	return seeds;
+}
 
@@ -30,11 +30,23 @@ void read_file(input_data*);
 void parse_ranges_file(char*, input_params&);
 void open_file(ofstream*, const char*, bool);
 double simulate_set(input_params&, int[]);
-void write_pipe(int, double[]);
-void write_pipe_int(int, int);
+bool launch_simulation(input_params&, int[], int, simulation*);
+bool read_simulation_output(simulation*);
+bool reap_simulation(simulation*);
+bool complete_simulation(input_params&, simulation*, double*);
+void print_good_set(input_params&, const int[], double);
+void account_simulation(input_params&, simulation*, double);
+void quarantine_set(input_params&, const int[], const char*, int);
+void write_checkpoint(input_params&, const int*, int, double);
+void print_failures(input_params&);
+bool write_pipe(int, double[]);
+bool write_pipe_int(int, int);
 void read_pipe(int, int*, int*);
 void read_pipe_int(int, int*);
 void close_if_open(ofstream&);
+char* config_signature(input_params&);
+void write_good_sets_header(input_params&);
+score_table* read_seed_population(input_params&);
 
 #endif
 
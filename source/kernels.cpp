@@ -0,0 +1,208 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+kernels.cpp contains the vectorized inner loops of the genetic algorithm's mutation and crossover operators.
+Every kernel has a scalar version and, on x86, AVX2 and AVX-512 versions compiled with target attributes so the program still runs on CPUs without them. The version is chosen once at startup.
+The kernels only compare, select, and move values, never doing arithmetic, so every version produces bit-identical results.
+*/
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h> // Needed for AVX2 and AVX-512 intrinsics
+	#define KERNELS_X86
+#endif
+
+#include "kernels.hpp" // Function declarations
+
+// The chosen kernels
+static void (*mutate_row_kernel)(double*, const double*, const double*, double, int);
+static void (*swap_rows_kernel)(double*, double*, int);
+
+/* mutate_row_scalar replaces each gene whose draw is below the given probability with its candidate value
+	parameters:
+		gene: the genes to mutate
+		draws: one random number in [0, 1) per gene
+		candidates: one replacement value (within the gene's bounds) per gene
+		prob: the probability of mutating each gene
+		num_dims: the number of genes
+	returns: nothing
+	notes:
+	todo:
+*/
+static void mutate_row_scalar (double* gene, const double* draws, const double* candidates, double prob, int num_dims) {
+	for (int i = 0; i < num_dims; i++) {
+		gene[i] = draws[i] < prob ? candidates[i] : gene[i];
+	}
+}
+
+/* swap_rows_scalar swaps the given rows of genes
+	parameters:
+		a: the first row
+		b: the second row
+		count: the number of genes to swap
+	returns: nothing
+	notes:
+	todo:
+*/
+static void swap_rows_scalar (double* a, double* b, int count) {
+	for (int i = 0; i < count; i++) {
+		double temp = a[i];
+		a[i] = b[i];
+		b[i] = temp;
+	}
+}
+
+#if defined(KERNELS_X86)
+
+/* mutate_row_avx2 is the AVX2 version of mutate_row_scalar (tails are handled by the scalar version) */
+__attribute__((target("avx2")))
+static void mutate_row_avx2 (double* gene, const double* draws, const double* candidates, double prob, int num_dims) {
+	__m256d p = _mm256_set1_pd(prob);
+	int i = 0;
+	for (; i + 4 <= num_dims; i += 4) {
+		__m256d mask = _mm256_cmp_pd(_mm256_loadu_pd(draws + i), p, _CMP_LT_OQ);
+		__m256d mutated = _mm256_blendv_pd(_mm256_loadu_pd(gene + i), _mm256_loadu_pd(candidates + i), mask);
+		_mm256_storeu_pd(gene + i, mutated);
+	}
+	mutate_row_scalar(gene + i, draws + i, candidates + i, prob, num_dims - i);
+}
+
+/* swap_rows_avx2 is the AVX2 version of swap_rows_scalar (tails are handled by the scalar version) */
+__attribute__((target("avx2")))
+static void swap_rows_avx2 (double* a, double* b, int count) {
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d va = _mm256_loadu_pd(a + i);
+		__m256d vb = _mm256_loadu_pd(b + i);
+		_mm256_storeu_pd(a + i, vb);
+		_mm256_storeu_pd(b + i, va);
+	}
+	swap_rows_scalar(a + i, b + i, count - i);
+}
+
+/* mutate_row_avx512 is the AVX-512 version of mutate_row_scalar (tails are handled with masked loads and stores) */
+__attribute__((target("avx512f")))
+static void mutate_row_avx512 (double* gene, const double* draws, const double* candidates, double prob, int num_dims) {
+	__m512d p = _mm512_set1_pd(prob);
+	for (int i = 0; i < num_dims; i += 8) {
+		__mmask8 tail = num_dims - i >= 8 ? 0xFF : (__mmask8)((1u << (num_dims - i)) - 1);
+		__mmask8 mask = _mm512_mask_cmp_pd_mask(tail, _mm512_maskz_loadu_pd(tail, draws + i), p, _CMP_LT_OQ);
+		__m512d mutated = _mm512_mask_blend_pd(mask, _mm512_maskz_loadu_pd(tail, gene + i), _mm512_maskz_loadu_pd(tail, candidates + i));
+		_mm512_mask_storeu_pd(gene + i, tail, mutated);
+	}
+}
+
+/* swap_rows_avx512 is the AVX-512 version of swap_rows_scalar (tails are handled with masked loads and stores) */
+__attribute__((target("avx512f")))
+static void swap_rows_avx512 (double* a, double* b, int count) {
+	for (int i = 0; i < count; i += 8) {
+		__mmask8 tail = count - i >= 8 ? 0xFF : (__mmask8)((1u << (count - i)) - 1);
+		__m512d va = _mm512_maskz_loadu_pd(tail, a + i);
+		__m512d vb = _mm512_maskz_loadu_pd(tail, b + i);
+		_mm512_mask_storeu_pd(a + i, tail, vb);
+		_mm512_mask_storeu_pd(b + i, tail, va);
+	}
+}
+
+#endif
+
+/* init_kernels chooses which version of the kernels to use
+	parameters:
+		requested: the instruction set the user requested (SIMD_AUTO to pick the best the CPU supports)
+	returns: the instruction set chosen
+	notes:
+		If the requested instruction set is unsupported, the best supported one below it is chosen instead.
+	todo:
+*/
+int init_kernels (int requested) {
+	int chosen = SIMD_SCALAR;
+	#if defined(KERNELS_X86)
+		__builtin_cpu_init();
+		bool avx512 = __builtin_cpu_supports("avx512f");
+		bool avx2 = __builtin_cpu_supports("avx2");
+		if ((requested == SIMD_AUTO || requested == SIMD_AVX512) && avx512) {
+			chosen = SIMD_AVX512;
+		} else if (requested != SIMD_SCALAR && avx2) {
+			chosen = SIMD_AVX2;
+		}
+	#endif
+	
+	mutate_row_kernel = mutate_row_scalar;
+	swap_rows_kernel = swap_rows_scalar;
+	#if defined(KERNELS_X86)
+		if (chosen == SIMD_AVX512) {
+			mutate_row_kernel = mutate_row_avx512;
+			swap_rows_kernel = swap_rows_avx512;
+		} else if (chosen == SIMD_AVX2) {
+			mutate_row_kernel = mutate_row_avx2;
+			swap_rows_kernel = swap_rows_avx2;
+		}
+	#endif
+	return chosen;
+}
+
+/* kernel_name returns the name of the given instruction set
+	parameters:
+		simd: the instruction set
+	returns: the name
+	notes:
+	todo:
+*/
+const char* kernel_name (int simd) {
+	switch (simd) {
+	case SIMD_AVX512:
+		return "AVX-512";
+	case SIMD_AVX2:
+		return "AVX2";
+	case SIMD_SCALAR:
+		return "scalar";
+	default:
+		return "auto";
+	}
+}
+
+/* mutate_row mutates a member's genes with the chosen kernel (see mutate_row_scalar)
+	parameters:
+		gene: the genes to mutate
+		draws: one random number in [0, 1) per gene
+		candidates: one replacement value (within the gene's bounds) per gene
+		prob: the probability of mutating each gene
+		num_dims: the number of genes
+	returns: nothing
+	notes:
+		init_kernels must be called before this function.
+	todo:
+*/
+void mutate_row (double* gene, const double* draws, const double* candidates, double prob, int num_dims) {
+	mutate_row_kernel(gene, draws, candidates, prob, num_dims);
+}
+
+/* swap_rows swaps the given rows of genes with the chosen kernel
+	parameters:
+		a: the first row
+		b: the second row
+		count: the number of genes to swap
+	returns: nothing
+	notes:
+		init_kernels must be called before this function.
+	todo:
+*/
+void swap_rows (double* a, double* b, int count) {
+	swap_rows_kernel(a, b, count);
+}
+
@@ -0,0 +1,38 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+kernels.hpp contains function declarations for kernels.cpp.
+*/
+
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+// The instruction sets the kernels can use
+#define SIMD_AUTO	0
+#define SIMD_SCALAR	1
+#define SIMD_AVX2	2
+#define SIMD_AVX512	3
+
+int init_kernels(int);
+const char* kernel_name(int);
+void mutate_row(double*, const double*, const double*, double, int);
+void swap_rows(double*, double*, int);
+
+#endif
+
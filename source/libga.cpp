@@ -0,0 +1,225 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+libga.cpp contains the sampler's embeddable interface, which lets other programs run the genetic algorithm with their own scoring instead of simulations.
+*/
+
+#include <algorithm> // Needed for max
+
+#include "libga.hpp" // Function declarations
+
+#include "ga.hpp"
+#include "init.hpp"
+#include "io.hpp"
+#include "kernels.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+extern terminal* term; // Declared in init.cpp
+
+/* ga_sampler creates a sampler for parameter sets with the given number of parameters
+	parameters:
+		num_dims: the number of parameters in each set
+	returns: nothing
+	notes:
+		If the program has not created a terminal, one is created with its verbose stream discarded, so the sampler prints nothing.
+	todo:
+*/
+ga_sampler::ga_sampler (int num_dims) {
+	if (term == NULL) {
+		init_terminal();
+		term->set_verbose_streambuf(NULL);
+	}
+	this->ip.num_dims = num_dims;
+	this->ip.ranges = new pair<int, int>[num_dims];
+	this->current = NULL;
+	this->owns_evaluator = false;
+	init_kernels(this->ip.simd);
+}
+
+/* ~ga_sampler frees the sampler's run and, if it created it, its evaluator
+	parameters:
+	returns: nothing
+	notes:
+	todo:
+*/
+ga_sampler::~ga_sampler () {
+	delete this->current;
+	this->release_evaluator();
+}
+
+/* set_range sets the range of values the given parameter may take
+	parameters:
+		dim: the index of the parameter
+		lower: the lowest value
+		upper: the highest value
+	returns: true if the range was set, false if the parameter does not exist, the range is empty, or the run has already started
+	notes:
+	todo:
+*/
+bool ga_sampler::set_range (int dim, int lower, int upper) {
+	if (this->current != NULL || dim < 0 || dim >= this->ip.num_dims || lower > upper) {
+		return false;
+	}
+	this->ip.ranges[dim] = make_pair(lower, upper);
+	return true;
+}
+
+/* set_fitness scores parameter sets with the given callback
+	parameters:
+		fitness: the callback
+		data: the data to pass to every call of the callback
+	returns: nothing
+	notes:
+		The callback is called from the thread that steps the sampler, one set at a time.
+	todo:
+*/
+void ga_sampler::set_fitness (ga_fitness fitness, void* data) {
+	this->release_evaluator();
+	this->ip.evaluator = new callback_evaluator(fitness, data);
+	this->owns_evaluator = true;
+}
+
+/* set_evaluator scores parameter sets with the given evaluator
+	parameters:
+		evaluator: the evaluator, which the caller keeps ownership of
+	returns: nothing
+	notes:
+	todo:
+*/
+void ga_sampler::set_evaluator (ga_evaluator* evaluator) {
+	this->release_evaluator();
+	this->ip.evaluator = evaluator;
+}
+
+/* step creates and scores the initial population if the run has not started and runs one generation otherwise
+	parameters:
+	returns: true if the run can continue, false if it has run every generation, met a stopping rule, or has no way to score sets
+	notes:
+	todo:
+*/
+bool ga_sampler::step () {
+	if (this->ip.evaluator == NULL) {
+		return false;
+	}
+	if (this->current == NULL) {
+		this->current = new ga_run();
+		start_run(this->ip, *(this->current));
+		return this->ip.generations > 0;
+	}
+	return step_run(this->ip, *(this->current));
+}
+
+/* run steps the sampler until the run is finished
+	parameters:
+	returns: nothing
+	notes:
+	todo:
+*/
+void ga_sampler::run () {
+	while (this->step());
+}
+
+/* generation returns the number of generations run so far
+	parameters:
+	returns: the number of generations
+	notes:
+	todo:
+*/
+int ga_sampler::generation () {
+	return this->current != NULL ? this->current->generation : 0;
+}
+
+/* best copies the best parameter set found so far
+	parameters:
+		set: an array of ip.num_dims parameters to copy the set into
+	returns: the set's score, or 0 if the run has not started
+	notes:
+	todo:
+*/
+double ga_sampler::best (int set[]) {
+	if (this->current == NULL) {
+		return 0;
+	}
+	genotype& best = this->current->population[this->ip.population];
+	for (int i = 0; i < this->ip.num_dims; i++) {
+		set[i] = best.gene[i];
+	}
+	return best.fitness;
+}
+
+/* stop_reason returns why the run stopped before its last generation
+	parameters:
+	returns: a message describing the stopping rule that was met, or NULL if none was
+	notes:
+	todo:
+*/
+const char* ga_sampler::stop_reason () {
+	return this->current != NULL ? this->current->stop_reason : NULL;
+}
+
+/* release_evaluator deletes the sampler's evaluator if the sampler created it
+	parameters:
+	returns: nothing
+	notes:
+	todo:
+*/
+void ga_sampler::release_evaluator () {
+	if (this->owns_evaluator) {
+		delete this->ip.evaluator;
+		this->owns_evaluator = false;
+	}
+	this->ip.evaluator = NULL;
+}
+
+/* run_evaluator scores the given parameter sets with the user's evaluator instead of simulating them
+	parameters:
+		ip: the program's input parameters
+		sets: the parameter sets to score, stored consecutively
+		count: the number of sets
+		scores: an array to store each set's score in
+	returns: nothing
+	notes:
+		Up to ip.jobs sets are submitted before waiting for one, and another is submitted as soon as one is scored, like simulate_batch keeps its worker slots busy.
+		Good sets are printed to the good sets file if the user specified one.
+	todo:
+*/
+void run_evaluator (input_params& ip, int* sets, int count, double scores[]) {
+	ga_evaluator* evaluator = ip.evaluator;
+	int limit = max(ip.jobs, 1);
+	int submitted = 0;
+	int finished = 0;
+	while (finished < count) {
+		while (submitted < count && submitted - finished < limit) {
+			evaluator->submit(submitted, sets + submitted * ip.num_dims, ip.num_dims);
+			submitted++;
+		}
+		int ticket;
+		double score;
+		evaluator->wait(&ticket, &score);
+		if (ticket < 0 || ticket >= submitted) {
+			cout << term->red << "An evaluator returned a ticket that was never submitted!" << term->reset << endl;
+			exit(EXIT_CHILD_ERROR);
+		}
+		scores[ticket] = score;
+		print_good_set(ip, sets + ticket * ip.num_dims, score);
+		finished++;
+	}
+}
@@ -0,0 +1,104 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+libga.hpp contains the sampler's embeddable interface, implemented in libga.cpp.
+Programs link against libga.a or libga.so, create a ga_sampler, give it the parameter ranges and a way to score parameter sets, and then step or run it without starting any processes or printing anything.
+*/
+
+#ifndef LIBGA_HPP
+#define LIBGA_HPP
+
+#include <vector> // Needed for vector
+
+#include "galib.hpp"
+#include "structs.hpp"
+
+// A fitness callback scores one parameter set, given its parameters, its number of parameters, and the data passed to set_fitness; the genetic algorithm maximizes scores, which should be between 0 and 1
+typedef double (*ga_fitness)(const int[], int, void*);
+
+/* ga_evaluator is the interface for scoring parameter sets asynchronously
+	notes:
+		The sampler submits up to ip.jobs sets before it waits for one, so an evaluator can score them at the same time, e.g. on a thread pool or a remote service. Each submitted set is identified by a ticket, and wait returns the tickets of scored sets in whatever order they finish.
+		Scores should be between 0 and 1, and higher scores are better.
+	todo:
+*/
+struct ga_evaluator {
+	virtual ~ga_evaluator () {}
+	
+	// submit starts scoring the given set (which is only valid during the call)
+	virtual void submit (int ticket, const int set[], int num_dims) = 0;
+	
+	// wait blocks until a submitted set has been scored and stores its ticket and score
+	virtual void wait (int* ticket, double* score) = 0;
+};
+
+/* callback_evaluator is an evaluator that scores each set with a fitness callback as soon as it is submitted
+	notes:
+	todo:
+*/
+struct callback_evaluator : public ga_evaluator {
+	ga_fitness fitness; // The callback
+	void* data; // The data passed to the callback
+	vector<pair<int, double> > scored; // The tickets and scores of the sets scored but not yet waited for
+	
+	callback_evaluator (ga_fitness fitness, void* data) {
+		this->fitness = fitness;
+		this->data = data;
+	}
+	
+	void submit (int ticket, const int set[], int num_dims) {
+		this->scored.push_back(make_pair(ticket, this->fitness(set, num_dims, this->data)));
+	}
+	
+	void wait (int* ticket, double* score) {
+		*ticket = this->scored.back().first;
+		*score = this->scored.back().second;
+		this->scored.pop_back();
+	}
+};
+
+/* ga_sampler is a genetic algorithm sampler embedded in another program
+	notes:
+		Set the ranges with set_range and any other parameters (e.g. population, generations, prob_mutation, prob_crossover, seed, jobs, and the stopping rules) directly in ip before the first step; their meanings and defaults match the command-line options.
+		The first step creates and scores the initial population, and every later step runs one generation.
+	todo:
+*/
+struct ga_sampler {
+	input_params ip; // The sampler's parameters
+	ga_run* current; // The run in progress, NULL before the first step
+	bool owns_evaluator; // Whether or not ip.evaluator was created by set_fitness and must be deleted by the sampler
+	
+	explicit ga_sampler(int);
+	~ga_sampler();
+	bool set_range(int, int, int);
+	void set_fitness(ga_fitness, void*);
+	void set_evaluator(ga_evaluator*);
+	bool step();
+	void run();
+	int generation();
+	double best(int[]);
+	const char* stop_reason();
+	
+private:
+	void release_evaluator();
+};
+
+void run_evaluator(input_params&, int*, int, double[]);
+
+#endif
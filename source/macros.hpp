@@ -26,6 +26,89 @@ macros.hpp contains every constant and macro function used in the program.
 // The number of implicit arguments sent to the simulation
 #define NUM_IMPLICIT_SIM_ARGS 8
 
+// Designs for placing initial parameter sets in the ranges
+#define DESIGN_RANDOM	0
+#define DESIGN_SOBOL	1
+#define DESIGN_LHS		2
+#define DESIGN_GRID		3
+
+// What the program does with the ranges
+#define MODE_GA		0
+#define MODE_SAMPLE	1
+
+// The fewest points the sampling mode simulates at a time, and the fewest per simulation allowed in flight
+#define SAMPLE_CHUNK_SIZE 1024
+#define SAMPLE_CHUNK_PER_JOB 16
+
+// Local searches run on the best members after every generation
+#define LOCAL_NONE			0
+#define LOCAL_PATTERN		1
+#define LOCAL_COORDINATE	2
+
+// The local search's first step, as a fraction of each range's width
+#define LOCAL_INITIAL_STEP 0.1
+
+// The number of members each chunk of an operator's pass covers when the operators run on several threads, fixed so results do not depend on the number of threads
+#define GA_CHUNK_MEMBERS 1024
+
+// The optimizers that can propose the sets to simulate
+#define ENGINE_GA		0
+#define ENGINE_CMAES	1
+#define ENGINE_DE		2
+
+// How the population's genes are stored
+#define ENCODING_DOUBLE		0
+#define ENCODING_QUANTIZED	1
+
+// What to do with a set that breaks a constraint from the ranges file
+#define CONSTRAINT_REPAIR	0
+#define CONSTRAINT_RESAMPLE	1
+#define CONSTRAINT_PENALIZE	2
+
+// What to do with the simulations running when the time budget runs out
+#define BUDGET_DRAIN	0
+#define BUDGET_CANCEL	1
+
+// How many times to move a set toward the constraints it breaks, or to redraw it, before giving it the constraint penalty
+#define CONSTRAINT_REPAIR_ROUNDS 20
+#define CONSTRAINT_MAX_RESAMPLES 100
+
+// The number of bits of precision in each coordinate of a Sobol point
+#define SOBOL_BITS 32
+
+// The number of record slots a new score database starts with (a power of 2)
+#define SCORE_DB_MIN_CAPACITY 1024
+
+// How often to check for exited simulations, in milliseconds, when the kernel does not support pidfds
+#define SIMULATION_POLL_MS 5
+
+// The seconds to wait after the first time a pipe or process cannot be created, doubled for each consecutive failure up to the maximum, and how many consecutive failures to allow before giving up
+#define LAUNCH_BACKOFF_SECONDS 0.05
+#define LAUNCH_BACKOFF_MAX_SECONDS 5.0
+#define LAUNCH_MAX_FAILURES 20
+
+// How long, in seconds, and for how many completions per simulation allowed in flight, throughput is measured before the concurrency limit is adjusted
+#define CONCURRENCY_WINDOW_SECONDS 1.0
+#define CONCURRENCY_WINDOW_COMPLETIONS 2
+
+// The relative change in throughput the concurrency controller treats as real rather than noise
+#define CONCURRENCY_TOLERANCE 0.05
+
+// The host load at which the concurrency controller stops raising or starts lowering the limit
+#define CONCURRENCY_MAX_LOAD_PER_CPU 1.5
+#define CONCURRENCY_MAX_MEMORY_PRESSURE 10.0
+#define CONCURRENCY_MIN_MEMORY_AVAILABLE 0.1
+
+// How long the metrics endpoint waits for a client to send a request before answering anyway, in milliseconds
+#define METRICS_REQUEST_WAIT_MS 100
+
+// The size of each of the trace's two event buffers, in bytes
+#define TRACE_BUFFER_SIZE (1024 * 1024)
+
+// The sizes population arenas are aligned to, in bytes
+#define CACHE_LINE_SIZE 64
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
 // Exit statuses
 #define EXIT_SUCCESS			0
 #define EXIT_MEMORY_ERROR		1
@@ -20,8 +20,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MAIN_HPP
 
 int main(int, char**);
-void usage(const char*);
-void licensing();
 
 #endif
 
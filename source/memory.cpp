@@ -17,10 +17,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 /*
-memory.cpp contains functions related to memory management. All memory related functions should be placed in this file.
+memory.cpp contains functions related to memory management. All memory related functions should be placed in this file, except the global new and delete replacements in allocator.cpp, which only the ga program links.
 Many features and functions are enabled only when scons-compiling with 'memtrack=1', which defines the MEMTRACK macro used for memory tracking.
 */
 
+#include <sys/mman.h> // Needed for mmap, madvise, munmap
+#include <unistd.h> // Needed for sysconf
+
 #include "memory.hpp" // Function declarations
 
 #include "macros.hpp"
@@ -57,8 +60,8 @@ void* mallocate (size_t size) {
 			exit(EXIT_MEMORY_ERROR);
 		}
 		#if defined(MEMTRACK)
-			heap_current += size;
-			heap_total += size;
+			__sync_fetch_and_add(&heap_current, size); // Atomic since sweep runs allocate from several threads
+			__sync_fetch_and_add(&heap_total, size);
 			size_t* sizeblock = (size_t*)block;
 			*sizeblock = size;
 			return (void*)(sizeblock + 1);
@@ -84,7 +87,7 @@ void mfree (void* mem) {
 	#if defined(MEMTRACK)
 		if (mem != NULL) {
 			size_t* memblock = (size_t*)mem - 1;
-			heap_current -= *memblock;
+			__sync_fetch_and_sub(&heap_current, *memblock);
 			free(memblock);
 		}
 	#else
@@ -92,52 +95,63 @@ void mfree (void* mem) {
 	#endif
 }
 
-/* new overloads the usual new with mallocate instead of malloc
-	parameters:
-		size: the number of bytes to allocate [ this parameter is not inputted directly due to the syntax of new; new int(x) translates conceptually to new(sizeof(int)) ]
-	returns: a pointer to the block of memory allocated
-	notes:
-		This function forces all memory allocation through mallocate, which allows custom error reporting and memory tracking.
-	todo:
-*/
-void* operator new (size_t size) {
-	return mallocate(size);
-}
-
-/* new[] overloads the usual new[] with mallocate instead of malloc
-	parameters:
-		size: the number of bytes to allocate [ this parameter is not inputted directly due to the syntax of new[]; new int[x] translates conceptually to new(sizeof(int) * x) ]
-	returns: a pointer to the block of memory allocated
-	notes:
-		This function forces all memory allocation through mallocate, which allows custom error reporting and memory tracking.
-	todo:
-*/
-void* operator new[] (size_t size) {
-	return mallocate(size);
-}
-
-/* delete overloads the usual delete with mfree instead of free
+/* map_arena maps a block of memory for an arena, backed by huge pages when possible
 	parameters:
-		mem: a pointer to the block of memory to free
-	returns: nothing
+		size: the number of bytes needed
+		mapped: a pointer to store the number of bytes mapped in, which must be passed to unmap_arena
+		huge: a pointer to store whether or not the block is backed by reserved huge pages
+	returns: a pointer to the block of memory mapped, which is page aligned and filled with zeros
 	notes:
-		This function forces all memory deallocation through mfree, which allows custom error reporting and memory tracking.
+		Reserved huge pages (MAP_HUGETLB) are tried first. If none are available, ordinary pages are mapped and, for blocks of at least one huge page, the kernel is asked to back them with transparent huge pages instead, which cuts TLB misses when large populations are scanned.
+		Memory mapped with map_arena should be freed with unmap_arena, not mfree.
 	todo:
 */
-void operator delete (void* mem) {
-	mfree(mem);
+void* map_arena (size_t size, size_t* mapped, bool* huge) {
+	*huge = false;
+	void* block = MAP_FAILED;
+	#if defined(MAP_HUGETLB)
+		if (size >= HUGE_PAGE_SIZE) {
+			*mapped = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+			block = mmap(NULL, *mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			*huge = block != MAP_FAILED;
+		}
+	#endif
+	if (block == MAP_FAILED) {
+		size_t page_size = sysconf(_SC_PAGESIZE);
+		*mapped = (size + page_size - 1) / page_size * page_size;
+		block = mmap(NULL, *mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (block == MAP_FAILED) {
+			term->no_memory();
+			exit(EXIT_MEMORY_ERROR);
+		}
+		#if defined(MADV_HUGEPAGE)
+			if (size >= HUGE_PAGE_SIZE) {
+				madvise(block, *mapped, MADV_HUGEPAGE); // Only a hint, so failure is harmless
+			}
+		#endif
+	}
+	#if defined(MEMTRACK)
+		__sync_fetch_and_add(&heap_current, *mapped);
+		__sync_fetch_and_add(&heap_total, *mapped);
+	#endif
+	return block;
 }
 
-/* delete[] overloads the usual delete[] with mfree instead of free
+/* unmap_arena frees the given block of memory mapped by map_arena
 	parameters:
-		mem: a pointer to the block of memory to free
+		block: a pointer to the block of memory to free
+		mapped: the number of bytes map_arena mapped
 	returns: nothing
 	notes:
-		This function forces all memory deallocation through mfree, which allows custom error reporting and memory tracking.
 	todo:
 */
-void operator delete[] (void* mem) {
-	mfree(mem);
+void unmap_arena (void* block, size_t mapped) {
+	if (block != NULL) {
+		munmap(block, mapped);
+		#if defined(MEMTRACK)
+			__sync_fetch_and_sub(&heap_current, mapped);
+		#endif
+	}
 }
 
 #if defined(MEMTRACK)
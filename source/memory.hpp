@@ -27,6 +27,8 @@ memory.hpp contains function declarations for memory.cpp
 
 void* mallocate(size_t);
 void mfree(void*);
+void* map_arena(size_t, size_t*, bool*);
+void unmap_arena(void*, size_t);
 #if defined(MEMTRACK)
 	void print_heap_usage();
 #endif
@@ -0,0 +1,292 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+metrics.cpp contains functions for the metrics endpoint, which serves every run's live progress in the Prometheus text format over a Unix-domain socket.
+*/
+
+#include <cerrno> // Needed for errno
+#include <cstdio> // Needed for fopen, fscanf, fclose
+#include <poll.h> // Needed for poll
+#include <sstream> // Needed for ostringstream
+#include <sys/eventfd.h> // Needed for eventfd
+#include <sys/socket.h> // Needed for socket, bind, listen, accept4, send
+#include <sys/un.h> // Needed for sockaddr_un
+
+#include "metrics.hpp" // Function declarations
+
+#include "init.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+extern terminal* term; // Declared in init.cpp
+
+/* resident_memory finds how much physical memory the process is using
+	parameters:
+	returns: the process's resident set size in bytes, or 0 if it cannot be read
+	notes:
+	todo:
+*/
+static size_t resident_memory () {
+	size_t pages = 0;
+	size_t resident = 0;
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm != NULL) {
+		if (fscanf(statm, "%zu %zu", &pages, &resident) != 2) {
+			resident = 0;
+		}
+		fclose(statm);
+	}
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+/* write_metric writes one metric's help and type lines
+	parameters:
+		out: the stream to write to
+		name: the metric's name
+		type: the metric's Prometheus type (gauge or counter)
+		help: a description of the metric
+	returns: nothing
+	notes:
+	todo:
+*/
+static void write_metric (ostringstream& out, const char* name, const char* type, const char* help) {
+	out << "# HELP " << name << " " << help << "\n";
+	out << "# TYPE " << name << " " << type << "\n";
+}
+
+/* format_metrics formats a snapshot of every run's progress
+	parameters:
+		ms: the metrics endpoint
+	returns: the snapshot in the Prometheus text format
+	notes:
+		Per-run metrics are labeled with the run's number, which matches its sweep log.
+	todo:
+*/
+static string format_metrics (metrics_server* ms) {
+	int num_runs = ms->num_runs;
+	run_metrics* runs = new run_metrics[num_runs];
+	int* in_flight = new int[num_runs];
+	pthread_mutex_lock(&(ms->lock));
+	for (int i = 0; i < num_runs; i++) {
+		runs[i] = ms->runs[i];
+	}
+	pthread_mutex_unlock(&(ms->lock));
+	pthread_mutex_lock(&(ms->pool->lock));
+	for (int i = 0; i < num_runs; i++) {
+		in_flight[i] = ms->pool->in_flight[i];
+	}
+	pthread_mutex_unlock(&(ms->pool->lock));
+	
+	ostringstream out;
+	write_metric(out, "ga_generation", "gauge", "The last generation the run finished.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_generation{run=\"" << i + 1 << "\"} " << runs[i].generation << "\n";
+	}
+	write_metric(out, "ga_best_score", "gauge", "The best score the run has found.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_best_score{run=\"" << i + 1 << "\"} " << runs[i].best_score << "\n";
+	}
+	write_metric(out, "ga_evaluations_total", "counter", "The number of simulations the run has run.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_evaluations_total{run=\"" << i + 1 << "\"} " << runs[i].evaluations << "\n";
+	}
+	write_metric(out, "ga_evaluations_per_second", "gauge", "The run's simulations per second of wall-clock time since it started.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_evaluations_per_second{run=\"" << i + 1 << "\"} " << (runs[i].seconds > 0 ? runs[i].evaluations / runs[i].seconds : 0) << "\n";
+	}
+	write_metric(out, "ga_simulations_in_flight", "gauge", "The number of worker slots the run's simulations hold right now.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_simulations_in_flight{run=\"" << i + 1 << "\"} " << in_flight[i] << "\n";
+	}
+	write_metric(out, "ga_job_limit", "gauge", "The most simulations the run may have in flight, which --adaptive-jobs adjusts.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_job_limit{run=\"" << i + 1 << "\"} " << runs[i].job_limit << "\n";
+	}
+	write_metric(out, "ga_simulation_cpu_seconds_total", "counter", "The CPU time the run's simulations have used, in user mode or the kernel.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_simulation_cpu_seconds_total{run=\"" << i + 1 << "\",mode=\"user\"} " << runs[i].usage.user_seconds << "\n";
+		out << "ga_simulation_cpu_seconds_total{run=\"" << i + 1 << "\",mode=\"system\"} " << runs[i].usage.system_seconds << "\n";
+	}
+	write_metric(out, "ga_simulation_peak_memory_bytes", "gauge", "The largest peak resident set size of any of the run's simulations.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_simulation_peak_memory_bytes{run=\"" << i + 1 << "\"} " << runs[i].usage.max_rss * 1024 << "\n";
+	}
+	write_metric(out, "ga_score_db_lookups_total", "counter", "The number of sets the run looked up in the score database.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_score_db_lookups_total{run=\"" << i + 1 << "\"} " << runs[i].lookups << "\n";
+	}
+	write_metric(out, "ga_score_db_hits_total", "counter", "The number of sets whose scores the run found in the score database.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_score_db_hits_total{run=\"" << i + 1 << "\"} " << runs[i].hits << "\n";
+	}
+	write_metric(out, "ga_score_db_hit_ratio", "gauge", "The fraction of the run's lookups found in the score database.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_score_db_hit_ratio{run=\"" << i + 1 << "\"} " << (runs[i].lookups > 0 ? (double)runs[i].hits / runs[i].lookups : 0) << "\n";
+	}
+	write_metric(out, "ga_population_arena_bytes", "gauge", "The number of bytes mapped for the run's population arena.");
+	for (int i = 0; i < num_runs; i++) {
+		out << "ga_population_arena_bytes{run=\"" << i + 1 << "\"} " << runs[i].arena_size << "\n";
+	}
+	write_metric(out, "ga_worker_slots", "gauge", "The number of worker slots simulations run in.");
+	out << "ga_worker_slots " << ms->pool->num_slots << "\n";
+	write_metric(out, "ga_resident_memory_bytes", "gauge", "The physical memory the sampler is using.");
+	out << "ga_resident_memory_bytes " << resident_memory() << "\n";
+	
+	delete[] runs;
+	delete[] in_flight;
+	return out.str();
+}
+
+/* answer_client sends a snapshot of the metrics to a connected client
+	parameters:
+		ms: the metrics endpoint
+		client_fd: the client's socket
+	returns: nothing
+	notes:
+		A client that sends an HTTP request (e.g. curl --unix-socket) gets an HTTP response; a client that sends nothing within METRICS_REQUEST_WAIT_MS milliseconds (e.g. socat or nc -U) gets the bare text.
+	todo:
+*/
+static void answer_client (metrics_server* ms, int client_fd) {
+	char request[1024];
+	int received = 0;
+	pollfd pfd = {client_fd, POLLIN, 0};
+	if (poll(&pfd, 1, METRICS_REQUEST_WAIT_MS) > 0) {
+		received = recv(client_fd, request, sizeof(request) - 1, MSG_DONTWAIT);
+	}
+	bool http = received >= 4 && memcmp(request, "GET ", 4) == 0;
+	string body = format_metrics(ms);
+	string response;
+	if (http) {
+		ostringstream header;
+		header << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " << body.size() << "\r\nConnection: close\r\n\r\n";
+		response = header.str();
+	}
+	response += body;
+	size_t sent = 0;
+	while (sent < response.size()) {
+		ssize_t n = send(client_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+		if (n <= 0) {
+			break;
+		}
+		sent += n;
+	}
+}
+
+/* metrics_thread answers connections to the metrics endpoint until the endpoint is stopped
+	parameters:
+		arg: a pointer to the metrics_server to serve
+	returns: NULL
+	notes:
+		Nothing is printed here since the thread's output would not go to any run's log.
+	todo:
+*/
+static void* metrics_thread (void* arg) {
+	metrics_server* ms = (metrics_server*)arg;
+	pollfd fds[2] = {{ms->listen_fd, POLLIN, 0}, {ms->stop_fd, POLLIN, 0}};
+	while (true) {
+		if (poll(fds, 2, -1) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		if (fds[1].revents != 0) {
+			break;
+		}
+		if (fds[0].revents != 0) {
+			int client_fd = accept4(ms->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+			if (client_fd != -1) {
+				answer_client(ms, client_fd);
+				close(client_fd);
+			}
+		}
+	}
+	return NULL;
+}
+
+/* init_metrics starts the metrics endpoint if the user specified a socket for it
+	parameters:
+		ip: the program's input parameters
+		num_runs: the number of runs that will publish progress
+	returns: nothing
+	notes:
+		A stale socket left at the same path by an earlier run is replaced.
+		This must be called after init_workers since the endpoint reads the worker pool.
+	todo:
+*/
+void init_metrics (input_params& ip, int num_runs) {
+	if (ip.metrics_socket == NULL) {
+		return;
+	}
+	metrics_server* ms = ip.metrics = new metrics_server(ip.metrics_socket, num_runs);
+	ms->pool = ip.pool;
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(ms->socket_file) >= sizeof(address.sun_path)) {
+		usage("The metrics socket's path is too long. Set --metrics-socket to a shorter path.");
+	}
+	strcpy(address.sun_path, ms->socket_file);
+	unlink(ms->socket_file);
+	ms->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (ms->listen_fd == -1 || bind(ms->listen_fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(ms->listen_fd, 16) != 0) {
+		cout << term->red << "Couldn't listen on the metrics socket " << ms->socket_file << "!" << term->reset << endl;
+		exit(EXIT_FILE_WRITE_ERROR);
+	}
+	ms->stop_fd = eventfd(0, EFD_CLOEXEC);
+	if (ms->stop_fd == -1 || pthread_create(&(ms->thread), NULL, metrics_thread, ms) != 0) {
+		cout << term->red << "Couldn't start the metrics endpoint's thread!" << term->reset << endl;
+		exit(EXIT_FORK_ERROR);
+	}
+	ms->started = true;
+	term->verbose() << term->blue << "Serving metrics " << term->reset << "on " << ms->socket_file << endl;
+}
+
+/* publish_metrics stores a run's progress for the metrics endpoint to serve
+	parameters:
+		ip: the run's input parameters
+		rs: the state of the run
+		generation: the last generation the run finished (0 after initialization)
+		arena_size: the number of bytes mapped for the run's population arena
+	returns: nothing
+	notes:
+		This should be called after each evaluation so the score database counters include every lookup. It does nothing if there is no metrics endpoint.
+	todo:
+*/
+void publish_metrics (input_params& ip, run_state& rs, int generation, size_t arena_size) {
+	metrics_server* ms = ip.metrics;
+	if (ms == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&(ms->lock));
+	run_metrics& rm = ms->runs[ip.run_index];
+	rm.generation = generation;
+	rm.best_score = rs.best_score;
+	rm.evaluations = rs.evaluations;
+	rm.seconds = wall_time() - rs.start_time;
+	if (ip.database != NULL) {
+		rm.lookups += rs.simulated;
+		rm.hits += rs.recalled;
+	}
+	rm.arena_size = arena_size;
+	rm.job_limit = ip.controller != NULL ? ip.controller->limit : ip.jobs;
+	rm.usage.add(ip.usage);
+	pthread_mutex_unlock(&(ms->lock));
+}
@@ -0,0 +1,507 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+packed.cpp contains the genetic algorithm's operators for populations stored in the quantized encoding, where each gene is a 16- or 32-bit offset within its range.
+The operators work on the offsets directly, crossing members over and mutating them bit by bit, and convert them to parameter values only to score the members, which is done by score_population in galib.cpp.
+*/
+
+#include <cmath> // Needed for log, floor, sqrt
+#include <cstring> // Needed for memcpy
+
+#include "packed.hpp" // Function declarations
+
+#include "design.hpp"
+#include "macros.hpp"
+#include "random.hpp"
+
+extern terminal* term; // Declared in init.cpp
+
+template <typename CODE> void cross_codes(input_params&, rng_state&, int, int);
+template <typename CODE> void mutate_codes(input_params&, run_state&);
+template <typename CODE> void select_codes(input_params&, run_state&, genotype*);
+void copy_member(input_params&, genotype*, int, int);
+void packed_crossover(input_params&, run_state&, genotype*);
+double packed_diversity(input_params&, genotype*);
+void packed_elitist(input_params&, genotype*);
+void packed_evaluate(input_params&, run_state&, genotype*, int);
+void packed_keep_the_best(input_params&, genotype*);
+void packed_mutate(input_params&, run_state&, genotype*);
+void packed_selector(input_params&, run_state&, genotype*, genotype*);
+
+/* create_packed creates the packed genes of a population, choosing how many bits each gene takes from the widths of the ranges
+	parameters:
+		ip: the program's input parameters
+		count: the number of members, including the best member after the last
+	returns: the new packed population, whose codes must still be attached to storage of packed_size bytes each
+	notes:
+	todo:
+*/
+packed_population* create_packed (input_params& ip, int count) {
+	packed_population* packed = new packed_population(count, ip.num_dims);
+	for (int i = 0; i < ip.num_dims; i++) {
+		packed->widths[i] = (uint32_t)((int64_t)ip.ranges[i].second - ip.ranges[i].first);
+		if (packed->widths[i] > UINT16_MAX) {
+			packed->bits = 32;
+		}
+	}
+	return packed;
+}
+
+/* packed_size returns the number of bytes every member's genes take in the given packed population
+	parameters:
+		packed: the packed population
+	returns: the number of bytes
+	notes:
+	todo:
+*/
+size_t packed_size (packed_population* packed) {
+	return (size_t)packed->count * packed->num_dims * (packed->bits / 8);
+}
+
+/* code and set_code read and write one gene of a packed population
+	parameters:
+		packed: the packed population
+		codes: the codes or spare codes of the packed population
+		index: the gene's index among every member's genes
+		value: the offset to store
+	returns: the gene's offset within its range (code only)
+	notes:
+	todo:
+*/
+static inline uint32_t code (packed_population* packed, void* codes, size_t index) {
+	return packed->bits == 16 ? ((uint16_t*)codes)[index] : ((uint32_t*)codes)[index];
+}
+
+static inline void set_code (packed_population* packed, void* codes, size_t index, uint32_t value) {
+	if (packed->bits == 16) {
+		((uint16_t*)codes)[index] = value;
+	} else {
+		((uint32_t*)codes)[index] = value;
+	}
+}
+
+/* decode_member converts a member's genes to a parameter set
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		member: the member's index
+		set: an array to store the parameter set in
+	returns: nothing
+	notes:
+	todo:
+*/
+void decode_member (input_params& ip, int member, int set[]) {
+	packed_population* packed = ip.packed;
+	for (int i = 0; i < ip.num_dims; i++) {
+		set[i] = ip.ranges[i].first + (int)code(packed, packed->codes, (size_t)member * ip.num_dims + i);
+	}
+}
+
+/* copy_member copies one member's genes and fitness over another's
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		population: the population
+		to: the index of the member to copy over
+		from: the index of the member to copy
+	returns: nothing
+	notes:
+		The best member after the last also keeps its genes as doubles, so the best set can be read like it is in the double encoding.
+	todo:
+*/
+void copy_member (input_params& ip, genotype* population, int to, int from) {
+	packed_population* packed = ip.packed;
+	for (int i = 0; i < ip.num_dims; i++) {
+		set_code(packed, packed->codes, (size_t)to * ip.num_dims + i, code(packed, packed->codes, (size_t)from * ip.num_dims + i));
+	}
+	population[to].fitness = population[from].fitness;
+	if (to == ip.population) {
+		int set[ip.num_dims];
+		decode_member(ip, to, set);
+		for (int i = 0; i < ip.num_dims; i++) {
+			population[to].gene[i] = set[i];
+		}
+	}
+}
+
+/* initialize_packed draws the initial population's genes with the user's initial design
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		rs: the state of the run
+		population: the population, whose fitness is reset
+	returns: nothing
+	notes:
+		Random genes are drawn uniformly from every offset in their range rather than from the 1000 levels randval draws from.
+	todo:
+*/
+void initialize_packed (input_params& ip, run_state& rs, genotype* population) {
+	packed_population* packed = ip.packed;
+	double* points = NULL;
+	if (ip.init_design == DESIGN_SOBOL) {
+		sobol_sequence seq(ip.num_dims);
+		init_sobol(seq, rs.rng);
+		points = new double[ip.population * ip.num_dims];
+		for (int j = 0; j < ip.population; j++) {
+			sobol_point(seq, j + 1, points + j * ip.num_dims);
+		}
+	} else if (ip.init_design == DESIGN_LHS) {
+		points = new double[ip.population * ip.num_dims];
+		latin_hypercube(ip.num_dims, ip.population, points, rs.rng);
+	}
+	for (int j = 0; j <= ip.population; j++) {
+		population[j].fitness = 0;
+		population[j].rfitness = 0;
+		population[j].cfitness = 0;
+	}
+	for (int j = 0; j < ip.population; j++) {
+		for (int i = 0; i < ip.num_dims; i++) {
+			uint32_t width = packed->widths[i];
+			uint32_t offset;
+			if (points == NULL) {
+				offset = width == UINT32_MAX ? (uint32_t)rng_next(rs.rng) : (uint32_t)(rng_next(rs.rng) % ((uint64_t)width + 1));
+			} else {
+				offset = (uint32_t)(points[j * ip.num_dims + i] * width);
+			}
+			set_code(packed, packed->codes, (size_t)j * ip.num_dims + i, offset);
+		}
+	}
+	delete[] points;
+	for (int i = 0; i < ip.num_dims; i++) { // The best member's bounds are kept for code that reads them
+		population[ip.population].lower[i] = ip.ranges[i].first;
+		population[ip.population].upper[i] = ip.ranges[i].second;
+	}
+}
+
+/* packed_operators returns the genetic algorithm's operators for the quantized encoding
+	parameters:
+	returns: the operators
+	notes:
+		There are no operators to refine members or select the best of oversampled candidates, since the quantized encoding cannot be combined with --local-search or --init-oversample.
+	todo:
+*/
+ga_operators packed_operators () {
+	ga_operators ops;
+	ops.dims = 0;
+	ops.crossover = packed_crossover;
+	ops.diversity = packed_diversity;
+	ops.elitist = packed_elitist;
+	ops.evaluate = packed_evaluate;
+	ops.keep_the_best = packed_keep_the_best;
+	ops.mutate = packed_mutate;
+	ops.refine = NULL;
+	ops.select_best = NULL;
+	ops.selector = packed_selector;
+	return ops;
+}
+
+/* packed_evaluate scores the given members, converting their genes to parameter sets only to score them
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		rs: the state of the run
+		population: the population
+		count: the number of members to score
+	returns: nothing
+	notes:
+		Members that score_population changes, e.g. to fix a broken constraint, are stored back as offsets.
+	todo:
+*/
+void packed_evaluate (input_params& ip, run_state& rs, genotype* population, int count) {
+	packed_population* packed = ip.packed;
+	int* sets = new int[count * ip.num_dims];
+	double* fitness = new double[count];
+	bool* changed = new bool[count];
+	for (int member = 0; member < count; member++) {
+		decode_member(ip, member, sets + member * ip.num_dims);
+	}
+	score_population(ip, rs, sets, count, fitness, changed);
+	for (int member = 0; member < count; member++) {
+		population[member].fitness = fitness[member];
+		if (changed[member]) {
+			for (int i = 0; i < ip.num_dims; i++) {
+				set_code(packed, packed->codes, (size_t)member * ip.num_dims + i, sets[member * ip.num_dims + i] - ip.ranges[i].first);
+			}
+		}
+	}
+	delete[] sets;
+	delete[] fitness;
+	delete[] changed;
+}
+
+/* packed_selector replaces the population with survivors drawn in proportion to their fitness, like selector does
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		rs: the state of the run
+		population: the population
+		newpopulation: unused, since the survivors' genes are copied into the spare codes instead
+	returns: nothing
+	notes:
+	todo:
+*/
+void packed_selector (input_params& ip, run_state& rs, genotype* population, genotype* newpopulation) {
+	if (ip.packed->bits == 16) {
+		select_codes<uint16_t>(ip, rs, population);
+	} else {
+		select_codes<uint32_t>(ip, rs, population);
+	}
+}
+
+/* select_codes draws the survivors for packed_selector
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		rs: the state of the run
+		population: the population
+	returns: nothing
+	notes:
+		The survivors' genes are copied into the spare codes, which then replace the codes, so no member is copied twice. A member whose draw falls past the last member's cumulative fitness keeps its own genes.
+	todo:
+*/
+template <typename CODE>
+void select_codes (input_params& ip, run_state& rs, genotype* population) {
+	packed_population* packed = ip.packed;
+	CODE* codes = (CODE*)packed->codes;
+	CODE* spare = (CODE*)packed->spare;
+	double sum = 0;
+	for (int mem = 0; mem < ip.population; mem++) {
+		sum += population[mem].fitness;
+	}
+	double cumulative = 0;
+	for (int mem = 0; mem < ip.population; mem++) {
+		population[mem].rfitness = population[mem].fitness / sum;
+		cumulative += population[mem].rfitness;
+		population[mem].cfitness = cumulative;
+	}
+	double* fitness = new double[ip.population];
+	for (int i = 0; i < ip.population; i++) {
+		int survivor = find_survivor(ip, population, rng_int(rs.rng, 1000) / 1000.0);
+		if (survivor == -1) {
+			survivor = i;
+		}
+		memcpy(spare + (size_t)i * ip.num_dims, codes + (size_t)survivor * ip.num_dims, sizeof(CODE) * ip.num_dims);
+		fitness[i] = population[survivor].fitness;
+	}
+	memcpy(spare + (size_t)ip.population * ip.num_dims, codes + (size_t)ip.population * ip.num_dims, sizeof(CODE) * ip.num_dims); // The best member stays where it is
+	for (int i = 0; i < ip.population; i++) {
+		population[i].fitness = fitness[i];
+	}
+	packed->spare = codes;
+	packed->codes = spare;
+	delete[] fitness;
+}
+
+/* packed_crossover crosses over pairs of members chosen with the crossover probability, pairing them like crossover does
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		rs: the state of the run
+		population: the population
+	returns: nothing
+	notes:
+	todo:
+*/
+void packed_crossover (input_params& ip, run_state& rs, genotype* population) {
+	double* x = new double[ip.population];
+	rng_fill(rs.rng, x, ip.population);
+	int one = 0;
+	int chosen = 0;
+	for (int mem = 0; mem < ip.population; mem++) {
+		if (x[mem] < ip.prob_crossover) {
+			chosen++;
+			if (chosen % 2 == 0) {
+				if (ip.packed->bits == 16) {
+					cross_codes<uint16_t>(ip, rs.rng, one, mem);
+				} else {
+					cross_codes<uint32_t>(ip, rs.rng, one, mem);
+				}
+			} else {
+				one = mem;
+			}
+		}
+	}
+	delete[] x;
+}
+
+/* cross_codes swaps the leading bits of two members' genes, read as one string of bits from the first gene's most significant bit
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		rng: the random number generator to draw the crossover point from
+		one: the index of the first member
+		two: the index of the second member
+	returns: nothing
+	notes:
+		The genes before the point are swapped whole and the gene the point falls in has its high bits swapped. If that leaves its offset past the width of its range, the offset wraps around.
+	todo:
+*/
+template <typename CODE>
+void cross_codes (input_params& ip, rng_state& rng, int one, int two) {
+	packed_population* packed = ip.packed;
+	const int bits = sizeof(CODE) * 8;
+	CODE* a = (CODE*)packed->codes + (size_t)one * ip.num_dims;
+	CODE* b = (CODE*)packed->codes + (size_t)two * ip.num_dims;
+	long total_bits = (long)ip.num_dims * bits;
+	if (total_bits < 2) {
+		return;
+	}
+	long point = rng_int(rng, total_bits - 1) + 1;
+	int gene = point / bits;
+	int high = point % bits;
+	for (int i = 0; i < gene; i++) {
+		CODE t = a[i];
+		a[i] = b[i];
+		b[i] = t;
+	}
+	if (high > 0) {
+		CODE mask = (CODE)((((uint64_t)1 << high) - 1) << (bits - high));
+		CODE t = a[gene];
+		a[gene] = (a[gene] & ~mask) | (b[gene] & mask);
+		b[gene] = (b[gene] & ~mask) | (t & mask);
+		uint64_t levels = (uint64_t)packed->widths[gene] + 1;
+		a[gene] = a[gene] % levels;
+		b[gene] = b[gene] % levels;
+	}
+}
+
+/* packed_mutate flips each bit of every member's genes with the mutation probability
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		rs: the state of the run
+		population: the population
+	returns: nothing
+	notes:
+	todo:
+*/
+void packed_mutate (input_params& ip, run_state& rs, genotype* population) {
+	if (ip.packed->bits == 16) {
+		mutate_codes<uint16_t>(ip, rs);
+	} else {
+		mutate_codes<uint32_t>(ip, rs);
+	}
+}
+
+/* mutate_codes flips the bits for packed_mutate
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		rs: the state of the run
+	returns: nothing
+	notes:
+		Rather than drawing for every bit, the number of bits until the next flip is drawn from the geometric distribution, so a generation takes time in proportion to the number of flips rather than the number of bits. A flipped gene whose offset passes the width of its range wraps around.
+	todo:
+*/
+template <typename CODE>
+void mutate_codes (input_params& ip, run_state& rs) {
+	if (ip.prob_mutation <= 0) {
+		return;
+	}
+	packed_population* packed = ip.packed;
+	const int bits = sizeof(CODE) * 8;
+	CODE* codes = (CODE*)packed->codes;
+	uint64_t total_bits = (uint64_t)ip.population * ip.num_dims * bits;
+	double log_keep = ip.prob_mutation < 1 ? log(1 - ip.prob_mutation) : 0;
+	uint64_t bit = 0;
+	while (true) {
+		if (log_keep < 0) { // Skip the bits that are not flipped
+			double skip = floor(log(1 - rng_uniform(rs.rng)) / log_keep);
+			if (skip >= total_bits - bit) {
+				break;
+			}
+			bit += (uint64_t)skip;
+		} else if (bit >= total_bits) {
+			break;
+		}
+		size_t index = bit / bits;
+		codes[index] ^= (CODE)((CODE)1 << (bits - 1 - bit % bits));
+		uint64_t levels = (uint64_t)packed->widths[index % ip.num_dims] + 1;
+		codes[index] = codes[index] % levels;
+		bit++;
+	}
+}
+
+/* packed_elitist keeps the best member found so far, like elitist does
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		population: the population
+	returns: nothing
+	notes:
+		Ties go to the last member, as they do in elitist.
+	todo:
+*/
+void packed_elitist (input_params& ip, genotype* population) {
+	int best_mem = 0;
+	int worst_mem = 0;
+	for (int i = 0; i < ip.population; i++) {
+		if (population[best_mem].fitness <= population[i].fitness) {
+			best_mem = i;
+		}
+		if (population[i].fitness <= population[worst_mem].fitness) {
+			worst_mem = i;
+		}
+	}
+	if (population[best_mem].fitness >= population[ip.population].fitness) {
+		copy_member(ip, population, ip.population, best_mem);
+	} else {
+		copy_member(ip, population, worst_mem, ip.population);
+	}
+}
+
+/* packed_keep_the_best stores the best member of the initial population after the last, like keep_the_best does
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		population: the population
+	returns: nothing
+	notes:
+	todo:
+*/
+void packed_keep_the_best (input_params& ip, genotype* population) {
+	int cur_best = 0;
+	for (int mem = 0; mem < ip.population; mem++) {
+		if (population[mem].fitness > population[cur_best].fitness) {
+			cur_best = mem;
+		}
+	}
+	copy_member(ip, population, ip.population, cur_best);
+}
+
+/* packed_diversity computes the population's diversity, like diversity does
+	parameters:
+		ip: the program's input parameters, with the run's packed population
+		population: the population
+	returns: the standard deviation of each gene relative to the width of its range, averaged over every gene with a nonempty range
+	notes:
+		The standard deviation of the offsets is that of the parameters, since they only differ by the start of the range.
+	todo:
+*/
+double packed_diversity (input_params& ip, genotype* population) {
+	packed_population* packed = ip.packed;
+	double total = 0;
+	int counted = 0;
+	for (int j = 0; j < ip.num_dims; j++) {
+		if (packed->widths[j] == 0) {
+			continue;
+		}
+		double mean = 0;
+		for (int i = 0; i < ip.population; i++) {
+			mean += code(packed, packed->codes, (size_t)i * ip.num_dims + j);
+		}
+		mean /= ip.population;
+		double var = 0;
+		for (int i = 0; i < ip.population; i++) {
+			var += SQUARE(code(packed, packed->codes, (size_t)i * ip.num_dims + j) - mean);
+		}
+		total += sqrt(var / ip.population) / packed->widths[j];
+		counted++;
+	}
+	return counted > 0 ? total / counted : 0;
+}
+
@@ -0,0 +1,36 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+packed.hpp contains function declarations for packed.cpp.
+*/
+
+#ifndef PACKED_HPP
+#define PACKED_HPP
+
+#include "galib.hpp"
+#include "structs.hpp"
+
+packed_population* create_packed(input_params&, int);
+size_t packed_size(packed_population*);
+void decode_member(input_params&, int, int[]);
+void initialize_packed(input_params&, run_state&, genotype*);
+ga_operators packed_operators();
+
+#endif
+
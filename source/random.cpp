@@ -0,0 +1,146 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+random.cpp contains the seeded random number generator used by the genetic algorithm's operators.
+rand is not used by these operators because its state is global and it is too slow to draw in bulk.
+*/
+
+#include <cmath> // Needed for cos, log, sqrt
+
+#include "random.hpp" // Function declarations
+
+using namespace std;
+
+/* splitmix64 advances the given SplitMix64 state and returns its next output
+	parameters:
+		state: the state to advance
+	returns: the next output
+	notes:
+		SplitMix64 is only used to expand seeds into xoshiro256** states.
+	todo:
+*/
+static uint64_t splitmix64 (uint64_t& state) {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/* rotl rotates the given 64-bit integer left by the given number of bits
+	parameters:
+		x: the integer to rotate
+		k: the number of bits to rotate by, from 1 to 63
+	returns: the rotated integer
+	notes:
+	todo:
+*/
+static inline uint64_t rotl (uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+/* rng_seed seeds the given generator
+	parameters:
+		rng: the generator to seed
+		seed: the seed (e.g. the user's seed)
+		stream: the index of the stream to seed, giving generators with the same seed independent sequences
+	returns: nothing
+	notes:
+	todo:
+*/
+void rng_seed (rng_state& rng, uint64_t seed, uint64_t stream) {
+	uint64_t state = seed ^ splitmix64(stream);
+	for (int i = 0; i < 4; i++) {
+		rng.s[i] = splitmix64(state);
+	}
+}
+
+/* rng_next draws the next 64 random bits from the given xoshiro256** generator
+	parameters:
+		rng: the generator to draw from
+	returns: the random bits
+	notes:
+	todo:
+*/
+uint64_t rng_next (rng_state& rng) {
+	uint64_t* s = rng.s;
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+/* rng_uniform draws a random number in [0, 1) from the given generator
+	parameters:
+		rng: the generator to draw from
+	returns: the random number
+	notes:
+		The top 53 bits are used so every representable multiple of 2^-53 is equally likely.
+	todo:
+*/
+double rng_uniform (rng_state& rng) {
+	return (rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* rng_int draws a random integer in [0, n) from the given generator
+	parameters:
+		rng: the generator to draw from
+		n: the exclusive upper bound, at least 1
+	returns: the random integer
+	notes:
+	todo:
+*/
+int rng_int (rng_state& rng, int n) {
+	return (int)(rng_uniform(rng) * n);
+}
+
+/* rng_normal draws a random number from the standard normal distribution with the given generator
+	parameters:
+		rng: the generator to draw from
+	returns: the random number
+	notes:
+		This uses the Box-Muller transform on two uniform draws, discarding the second normal number so the generator keeps no extra state.
+	todo:
+*/
+double rng_normal (rng_state& rng) {
+	double u = 1 - rng_uniform(rng); // In (0, 1] so its log is finite
+	double v = rng_uniform(rng);
+	return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+/* rng_fill fills the given array with random numbers in [0, 1) from the given generator
+	parameters:
+		rng: the generator to draw from
+		values: the array to fill
+		count: the number of values to draw
+	returns: nothing
+	notes:
+		This draws the same numbers as calling rng_uniform count times.
+	todo:
+*/
+void rng_fill (rng_state& rng, double* values, int count) {
+	for (int i = 0; i < count; i++) {
+		values[i] = rng_uniform(rng);
+	}
+}
+
@@ -0,0 +1,36 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+random.hpp contains function declarations for random.cpp.
+*/
+
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include "structs.hpp"
+
+void rng_seed(rng_state&, uint64_t, uint64_t);
+uint64_t rng_next(rng_state&);
+double rng_uniform(rng_state&);
+int rng_int(rng_state&, int);
+double rng_normal(rng_state&);
+void rng_fill(rng_state&, double*, int);
+
+#endif
+
@@ -0,0 +1,298 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+sample.cpp contains functions that run the sampling mode, which simulates a fixed design of points spread over the ranges instead of running the genetic algorithm.
+Every point is generated from its index alone, so the design is simulated in chunks of constant size however many points it has, and an interrupted run can resume from the last finished chunk.
+*/
+
+#include <algorithm> // Needed for max
+#include <cstdio> // Needed for rename, sscanf
+#include <sys/stat.h> // Needed for stat
+#include <unistd.h> // Needed for truncate
+
+#include "sample.hpp" // Function declarations
+
+#include "constraints.hpp"
+#include "design.hpp"
+#include "init.hpp"
+#include "io.hpp"
+#include "macros.hpp"
+#include "metrics.hpp"
+#include "random.hpp"
+#include "trace.hpp"
+#include "workers.hpp"
+
+using namespace std;
+
+extern terminal* term; // Declared in init.cpp
+
+/* grid_levels chooses how many evenly spaced levels each dimension of a grid design gets
+	parameters:
+		ip: the program's input parameters
+		levels: an array to store each dimension's number of levels in
+	returns: the number of points in the grid
+	notes:
+		Levels are added one at a time to each dimension in turn for as long as the grid stays within --samples points, so the grid may have fewer points than requested. A dimension never gets more levels than its range has values.
+	todo:
+*/
+static long grid_levels (input_params& ip, int* levels) {
+	long points = 1;
+	for (int i = 0; i < ip.num_dims; i++) {
+		levels[i] = 1;
+	}
+	bool grown = true;
+	while (grown) {
+		grown = false;
+		for (int i = 0; i < ip.num_dims; i++) {
+			int values = ip.ranges[i].second - ip.ranges[i].first + 1;
+			if (levels[i] < values && points / levels[i] * (levels[i] + 1) <= ip.samples) {
+				points = points / levels[i] * (levels[i] + 1);
+				levels[i]++;
+				grown = true;
+			}
+		}
+	}
+	return points;
+}
+
+/* sample_point computes the parameter set at the given index of the design
+	parameters:
+		ip: the program's input parameters
+		seq: the Sobol sequence, used only by the Sobol design
+		levels: each dimension's number of levels, used only by the grid design
+		index: the index of the point
+		set: an array to store the parameter set in
+	returns: nothing
+	notes:
+		Random points are drawn from a generator seeded with the point's index, so every point can be generated on its own.
+		Grid levels include both ends of each range; a dimension with one level is set to the middle of its range. The first dimension varies fastest.
+	todo:
+*/
+static void sample_point (input_params& ip, sobol_sequence& seq, int* levels, long index, int* set) {
+	if (ip.sample_design == DESIGN_RANDOM) {
+		rng_state rng;
+		rng_seed(rng, ip.seed, index + 1);
+		for (int i = 0; i < ip.num_dims; i++) {
+			set[i] = ip.ranges[i].first + rng_int(rng, ip.ranges[i].second - ip.ranges[i].first + 1);
+		}
+	} else if (ip.sample_design == DESIGN_SOBOL) {
+		double point[ip.num_dims];
+		sobol_point(seq, index + 1, point);
+		for (int i = 0; i < ip.num_dims; i++) {
+			set[i] = ip.ranges[i].first + (int)(point[i] * (ip.ranges[i].second - ip.ranges[i].first + 1));
+		}
+	} else {
+		long rest = index;
+		for (int i = 0; i < ip.num_dims; i++) {
+			int level = rest % levels[i];
+			rest /= levels[i];
+			int width = ip.ranges[i].second - ip.ranges[i].first;
+			if (levels[i] == 1) {
+				set[i] = ip.ranges[i].first + width / 2;
+			} else {
+				set[i] = ip.ranges[i].first + (int)((double)level * width / (levels[i] - 1) + 0.5);
+			}
+		}
+	}
+}
+
+/* progress_filename returns the name of the progress file a sampling run keeps next to its good sets file
+	parameters:
+		ip: the program's input parameters
+	returns: a newly allocated string with the progress file's name
+	notes:
+	todo:
+*/
+static char* progress_filename (input_params& ip) {
+	char* filename = (char*)mallocate(strlen(ip.good_sets_file) + 10);
+	sprintf(filename, "%s.progress", ip.good_sets_file);
+	return filename;
+}
+
+/* write_progress records how far a sampling run has gotten, replacing the progress file atomically
+	parameters:
+		ip: the program's input parameters
+		next: the index of the first point not yet simulated
+		rs: the run's state, with the number of simulations and best score so far
+	returns: nothing
+	notes:
+		The good sets file is flushed first and its size recorded, so a resumed run can cut off whatever an interrupted chunk wrote after it.
+	todo:
+*/
+static void write_progress (input_params& ip, long next, run_state& rs) {
+	ip.good_sets_stream.flush();
+	struct stat sets_stat;
+	long offset = stat(ip.good_sets_file, &sets_stat) == 0 ? sets_stat.st_size : 0;
+	char* filename = progress_filename(ip);
+	char* temporary = (char*)mallocate(strlen(filename) + 5);
+	sprintf(temporary, "%s.tmp", filename);
+	char* sig = config_signature(ip);
+	ofstream progress;
+	open_file(&progress, temporary, false);
+	progress << "# config " << sig << endl;
+	progress << ip.seed << " " << ip.sample_design << " " << ip.samples << " " << next << " " << offset << " " << rs.evaluations << " " << rs.best_score << endl;
+	progress.close();
+	if (progress.fail() || rename(temporary, filename) != 0) {
+		cout << term->red << "Couldn't write to " << filename << "!" << term->reset << endl;
+		exit(EXIT_FILE_WRITE_ERROR);
+	}
+	mfree(sig);
+	mfree(temporary);
+	mfree(filename);
+}
+
+/* resume_progress continues an interrupted sampling run from its progress file
+	parameters:
+		ip: the program's input parameters, whose seed is replaced by the interrupted run's
+		rs: the run's state to restore the number of simulations and best score into
+	returns: the index of the first point not yet simulated, or 0 if there is no progress file to resume from
+	notes:
+		The good sets file is cut back to the size it had when the progress was recorded, so points from the unfinished chunk are not listed twice.
+		The interrupted run must have had the same simulation configuration, design, and number of points.
+	todo:
+*/
+static long resume_progress (input_params& ip, run_state& rs) {
+	char* filename = progress_filename(ip);
+	ifstream progress(filename);
+	if (!progress.is_open()) {
+		cout << term->yellow << "There is no progress file to resume from, " << term->reset << "so sampling from the first point" << endl;
+		mfree(filename);
+		return 0;
+	}
+	string header;
+	string state;
+	getline(progress, header);
+	getline(progress, state);
+	char* sig = config_signature(ip);
+	int seed;
+	int design;
+	long samples;
+	long next;
+	long offset;
+	int evaluations;
+	double best_score;
+	bool valid = sscanf(state.c_str(), "%d %d %ld %ld %ld %d %lf", &seed, &design, &samples, &next, &offset, &evaluations, &best_score) == 7;
+	if (!valid || header != string("# config ") + sig || design != ip.sample_design || samples != ip.samples) {
+		cout << term->red << "The progress file " << filename << " is from a different simulation configuration, design, or number of points! Start a new run without --resume instead." << term->reset << endl;
+		exit(EXIT_INPUT_ERROR);
+	}
+	if (truncate(ip.good_sets_file, offset) != 0) {
+		cout << term->red << "Couldn't write to " << ip.good_sets_file << "!" << term->reset << endl;
+		exit(EXIT_FILE_WRITE_ERROR);
+	}
+	ip.seed = seed;
+	rs.evaluations = evaluations;
+	rs.best_score = best_score;
+	cout << term->blue << "Resuming " << term->reset << "from point " << next << " of " << ip.samples << endl;
+	mfree(sig);
+	mfree(filename);
+	return next;
+}
+
+/* run_sample simulates every point of the sampling design, streaming good sets to the good sets file as they are scored, and prints its progress
+	parameters:
+		ip: the program's input parameters
+		summary: the run summary to fill in
+	returns: nothing
+	notes:
+		Points are simulated in chunks of at least SAMPLE_CHUNK_SIZE points through simulate_batch, so every worker slot is kept busy except at the end of each chunk, and memory does not grow with the number of points.
+		Progress is recorded after every chunk; --resume continues from the last recorded chunk, including after a budget ran out partway through one.
+		Set -G or --good-set-threshold to 1 to list every point in the good sets file.
+		Points that break a constraint are repaired if the user chose repairing, and skipped otherwise, since a fixed design cannot redraw them.
+	todo:
+*/
+void run_sample (input_params& ip, run_summary& summary) {
+	run_state rs;
+	rs.start_time = wall_time();
+	ip.budget_deadline = ip.time_budget > 0 ? rs.start_time + ip.time_budget : 0;
+	long next = 0;
+	if (ip.resume) {
+		next = resume_progress(ip, rs);
+	}
+	if (next == 0) {
+		ip.good_sets_stream.close();
+		open_file(&(ip.good_sets_stream), ip.good_sets_file, false);
+		write_good_sets_header(ip);
+	}
+	
+	// Set up the design
+	rng_state rng;
+	rng_seed(rng, ip.seed, 0);
+	sobol_sequence seq(ip.num_dims);
+	init_sobol(seq, rng);
+	int* levels = new int[ip.num_dims];
+	long points = ip.samples;
+	if (ip.sample_design == DESIGN_GRID) {
+		points = grid_levels(ip, levels);
+		cout << term->blue << "Sampling a grid " << term->reset << "of " << points << " points" << endl;
+	}
+	
+	// Simulate the points chunk by chunk
+	int chunk_size = max(SAMPLE_CHUNK_SIZE, SAMPLE_CHUNK_PER_JOB * ip.jobs);
+	int* sets = new int[chunk_size * ip.num_dims];
+	double* scores = new double[chunk_size];
+	int chunk = 0;
+	long rejected = 0;
+	while (next < points) {
+		int count = (int)min((long)chunk_size, points - next);
+		ip.usage = resource_usage();
+		double start = wall_time();
+		int valid = 0;
+		for (int i = 0; i < count; i++) {
+			int* set = sets + valid * ip.num_dims;
+			sample_point(ip, seq, levels, next + i, set);
+			if (ip.constraints == NULL || satisfies_constraints(ip, set) || (ip.constraint_action == CONSTRAINT_REPAIR && repair_set(ip, set))) {
+				valid++;
+			}
+		}
+		rejected += count - valid;
+		ip.budget_simulations = ip.eval_budget > 0 ? max(ip.eval_budget - rs.evaluations, 0) : -1;
+		int simulated = simulate_batch(ip, sets, valid, scores, NULL);
+		trace_phase(ip, "sample", start);
+		rs.evaluations += ip.launches;
+		summary.usage.add(ip.usage);
+		if (ip.unscored > 0) { // The chunk is left unfinished, so a resumed run simulates it again
+			summary.stop_reason = ip.time_budget > 0 && wall_time() >= ip.budget_deadline ? "the time budget was exhausted" : "the evaluation budget was exhausted";
+			cout << term->blue << "Stopping early " << term->reset << "after " << next << " of " << points << " points because " << summary.stop_reason << endl;
+			break;
+		}
+		for (int i = 0; i < valid; i++) {
+			rs.best_score = max(rs.best_score, scores[i]);
+		}
+		next += count;
+		write_progress(ip, next, rs);
+		chunk++;
+		publish_metrics(ip, rs, chunk, 0);
+		cout << term->blue << "Sampled " << term->reset << next << " of " << points << " points (" << simulated << " simulated, " << valid - simulated << " recalled from the score database, " << count - valid << " broke a constraint), the best score so far is " << rs.best_score << endl;
+	}
+	delete[] levels;
+	delete[] sets;
+	delete[] scores;
+	
+	if (rejected > 0) {
+		cout << term->yellow << "Skipped " << term->reset << rejected << " points that broke a constraint" << (ip.constraint_action == CONSTRAINT_REPAIR ? " and could not be repaired" : "") << endl;
+	}
+	cout << term->blue << "Best score: " << term->reset << rs.best_score << endl;
+	summary.best_score = rs.best_score;
+	summary.evaluations = rs.evaluations;
+	summary.seconds = wall_time() - rs.start_time;
+	summary.failures = ip.failures;
+	print_failures(ip);
+}
+
@@ -0,0 +1,396 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+scoredb.cpp contains functions that store simulated sets' scores in a database file shared by every run on the host, so no run simulates a set an earlier run already scored.
+The file is a hash table memory-mapped by every process using it and guarded by flock, so lookups cost no more than a few memory reads.
+*/
+
+#include <cerrno> // Needed for errno
+#include <cmath> // Needed for isfinite
+#include <fcntl.h> // Needed for open
+#include <sys/file.h> // Needed for flock
+#include <sys/mman.h> // Needed for mmap, munmap
+#include <sys/stat.h> // Needed for fstat
+#include <unistd.h> // Needed for ftruncate, close
+
+#include "scoredb.hpp" // Function declarations
+
+#include "hash.hpp"
+#include "io.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+extern terminal* term; // Declared in init.cpp
+
+// Identifies score database files (the last character is the format's version)
+static const char score_db_magic[8] = {'G', 'A', 'S', 'C', 'O', 'R', 'E', '1'};
+
+/* score_db_header is the start of a score database file
+	notes:
+		The header is padded to a cache line so the records after it stay aligned.
+	todo:
+*/
+struct score_db_header {
+	char magic[8]; // Always score_db_magic
+	uint64_t capacity; // The number of record slots after the header (always a power of 2)
+	uint64_t size; // The number of slots holding a record
+	uint64_t rebuilding; // Whether or not a process was rehashing the table, which means it was interrupted if the flag is still set when the file is opened
+	uint64_t padding[4];
+};
+
+/* score_db_record is one slot of a score database's hash table
+	notes:
+		Sets are identified by two independent hashes rather than stored in full so every record has the same size whatever the number of dimensions.
+	todo:
+*/
+struct score_db_record {
+	uint64_t config; // The hash of the configuration signature the score was simulated under, 0 if the slot is empty
+	uint64_t set; // The set's hash_set hash
+	uint64_t check; // A second, independent hash of the set
+	double score; // The set's score
+};
+
+/* header returns the given database's header
+	parameters:
+		db: the database
+	returns: the header
+	notes:
+	todo:
+*/
+static score_db_header* header (score_db* db) {
+	return (score_db_header*)db->map;
+}
+
+/* records returns the given database's record slots
+	parameters:
+		db: the database
+	returns: the first slot
+	notes:
+	todo:
+*/
+static score_db_record* records (score_db* db) {
+	return (score_db_record*)(db->map + sizeof(score_db_header));
+}
+
+/* file_size returns the size of a score database file with the given capacity
+	parameters:
+		capacity: the number of record slots
+	returns: the size in bytes
+	notes:
+	todo:
+*/
+static size_t file_size (uint64_t capacity) {
+	return sizeof(score_db_header) + capacity * sizeof(score_db_record);
+}
+
+/* failed_score_db prints that the given operation on the given database failed and exits
+	parameters:
+		db: the database
+		operation: what could not be done, e.g. "lock"
+		code: the exit status to exit with
+	returns: nothing
+	notes:
+	todo:
+*/
+static void failed_score_db (score_db* db, const char* operation, int code) {
+	cout << term->red << "Couldn't " << operation << " the score database " << db->filename << "!" << term->reset << endl;
+	exit(code);
+}
+
+/* lock_score_db locks the given database's file and remaps it if another process has resized it
+	parameters:
+		db: the database
+		operation: LOCK_SH to read the database or LOCK_EX to change it
+	returns: nothing
+	notes:
+		The header always lies within the old mapping, since the table never shrinks below its starting capacity, so it is safe to read before remapping.
+	todo:
+*/
+static void lock_score_db (score_db* db, int operation) {
+	while (flock(db->fd, operation) == -1) {
+		if (errno != EINTR) {
+			failed_score_db(db, "lock", EXIT_FILE_READ_ERROR);
+		}
+	}
+	size_t size = file_size(header(db)->capacity);
+	if (size != db->map_size) {
+		munmap(db->map, db->map_size);
+		db->map = (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, db->fd, 0);
+		if (db->map == MAP_FAILED) {
+			failed_score_db(db, "map", EXIT_FILE_READ_ERROR);
+		}
+		db->map_size = size;
+	}
+}
+
+/* unlock_score_db unlocks the given database's file
+	parameters:
+		db: the database
+	returns: nothing
+	notes:
+	todo:
+*/
+static void unlock_score_db (score_db* db) {
+	flock(db->fd, LOCK_UN);
+}
+
+/* check_hash computes a hash of the given parameter set independent of hash_set
+	parameters:
+		set: the parameter set to hash
+		num_dims: the number of parameters in the set
+	returns: the hash
+	notes:
+		Each parameter is mixed in with the splitmix64 finalizer.
+	todo:
+*/
+static uint64_t check_hash (const int set[], int num_dims) {
+	uint64_t hash = num_dims;
+	for (int i = 0; i < num_dims; i++) {
+		hash = (hash ^ (uint32_t)set[i]) + 0x9E3779B97F4A7C15ULL;
+		hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+		hash ^= hash >> 31;
+	}
+	return hash;
+}
+
+/* find_record finds the slot holding the given key or, if there is none, the empty slot the key belongs in
+	parameters:
+		db: the database, which must be locked
+		key: the key to find (its score is ignored)
+	returns: the slot
+	notes:
+		The table uses open addressing with linear probing and is never more than half full, so an empty slot is always found.
+	todo:
+*/
+static score_db_record* find_record (score_db* db, const score_db_record& key) {
+	score_db_record* slots = records(db);
+	uint64_t mask = header(db)->capacity - 1;
+	uint64_t i = (key.set ^ (key.config * 0x9E3779B97F4A7C15ULL)) & mask;
+	while (slots[i].config != 0 && (slots[i].config != key.config || slots[i].set != key.set || slots[i].check != key.check)) {
+		i = (i + 1) & mask;
+	}
+	return &slots[i];
+}
+
+/* resize_score_db rehashes the given database into a table with the given capacity
+	parameters:
+		db: the database, which must be locked exclusively
+		capacity: the new capacity, a power of 2 at least twice the number of records
+	returns: nothing
+	notes:
+		Records with scores that are not finite numbers are dropped.
+		The rebuilding flag is set while the file is inconsistent so an interrupted resize is detected the next time the file is opened.
+	todo:
+*/
+static void resize_score_db (score_db* db, uint64_t capacity) {
+	score_db_header* head = header(db);
+	uint64_t old_size = head->size;
+	score_db_record* old_records = new score_db_record[old_size];
+	uint64_t n = 0;
+	for (uint64_t i = 0; i < head->capacity; i++) {
+		score_db_record* r = &(records(db)[i]);
+		if (r->config != 0 && isfinite(r->score)) {
+			old_records[n++] = *r;
+		}
+	}
+	
+	head->rebuilding = 1;
+	size_t size = file_size(capacity);
+	if (size > db->map_size && ftruncate(db->fd, size) == -1) {
+		failed_score_db(db, "resize", EXIT_FILE_WRITE_ERROR);
+	}
+	munmap(db->map, db->map_size);
+	db->map = (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, db->fd, 0);
+	if (db->map == MAP_FAILED) {
+		failed_score_db(db, "map", EXIT_FILE_WRITE_ERROR);
+	}
+	db->map_size = size;
+	
+	head = header(db);
+	head->capacity = capacity;
+	head->size = n;
+	memset(records(db), 0, capacity * sizeof(score_db_record));
+	for (uint64_t i = 0; i < n; i++) {
+		*find_record(db, old_records[i]) = old_records[i];
+	}
+	if (ftruncate(db->fd, size) == -1) {
+		failed_score_db(db, "resize", EXIT_FILE_WRITE_ERROR);
+	}
+	head->rebuilding = 0;
+	delete[] old_records;
+}
+
+/* init_score_db opens or creates the score database the user specified
+	parameters:
+		ip: the program's input parameters
+	returns: nothing
+	notes:
+		A new or interrupted database is (re)initialized to an empty table. A file that is not a score database is left alone and the program exits.
+		Scores are keyed by a hash of config_signature, so runs with a different simulation, simulation arguments, or gradients never share scores.
+	todo:
+*/
+void init_score_db (input_params& ip) {
+	if (ip.score_db_file == NULL) {
+		return;
+	}
+	ostream& v = term->verbose();
+	v << term->blue << "Opening score database " << term->reset << ip.score_db_file << " . . . ";
+	
+	score_db* db = new score_db(ip.score_db_file);
+	db->fd = open(db->filename, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (db->fd == -1) {
+		failed_score_db(db, "open", EXIT_FILE_READ_ERROR);
+	}
+	while (flock(db->fd, LOCK_EX) == -1) {
+		if (errno != EINTR) {
+			failed_score_db(db, "lock", EXIT_FILE_READ_ERROR);
+		}
+	}
+	struct stat file_stat;
+	if (fstat(db->fd, &file_stat) == -1) {
+		failed_score_db(db, "open", EXIT_FILE_READ_ERROR);
+	}
+	
+	// Check the header of an existing file, starting over if a resize was interrupted
+	score_db_header head;
+	bool fresh = (size_t)file_stat.st_size < sizeof(head);
+	if (!fresh) {
+		if (pread(db->fd, &head, sizeof(head), 0) != sizeof(head) || memcmp(head.magic, score_db_magic, sizeof(score_db_magic)) != 0) {
+			cout << term->red << ip.score_db_file << " is not a score database! Remove it or choose another file with --score-db." << term->reset << endl;
+			exit(EXIT_FILE_READ_ERROR);
+		}
+		if (head.rebuilding != 0 || (size_t)file_stat.st_size < file_size(head.capacity)) {
+			cout << term->yellow << "The score database " << ip.score_db_file << " was damaged by an interrupted resize, so it is starting over." << term->reset << endl;
+			fresh = true;
+		}
+	}
+	if (fresh) {
+		memset(&head, 0, sizeof(head));
+		memcpy(head.magic, score_db_magic, sizeof(score_db_magic));
+		head.capacity = SCORE_DB_MIN_CAPACITY;
+		if (ftruncate(db->fd, 0) == -1 || ftruncate(db->fd, file_size(head.capacity)) == -1 || pwrite(db->fd, &head, sizeof(head), 0) != sizeof(head)) {
+			failed_score_db(db, "create", EXIT_FILE_WRITE_ERROR);
+		}
+	}
+	
+	db->map_size = file_size(head.capacity);
+	db->map = (char*)mmap(NULL, db->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, db->fd, 0);
+	if (db->map == MAP_FAILED) {
+		failed_score_db(db, "map", EXIT_FILE_READ_ERROR);
+	}
+	unlock_score_db(db);
+	
+	// Hash the configuration, reserving 0 for empty slots
+	char* sig = config_signature(ip);
+	db->config = 14695981039346656037ULL;
+	for (const char* c = sig; *c != '\0'; c++) {
+		db->config = (db->config ^ (unsigned char)*c) * 1099511628211ULL;
+	}
+	if (db->config == 0) {
+		db->config = 1;
+	}
+	mfree(sig);
+	
+	ip.database = db;
+	v << term->blue << "Done: " << term->reset << head.size << " scores stored" << endl;
+}
+
+/* score_db_find looks up the given parameter sets in the given database
+	parameters:
+		db: the database
+		sets: the parameter sets to look up, stored consecutively
+		count: the number of sets
+		num_dims: the number of parameters in each set
+		scores: an array to store each found set's score in
+		found: an array to store whether or not each set was found in
+	returns: the number of sets found
+	notes:
+		The whole batch is looked up under one shared lock.
+	todo:
+*/
+int score_db_find (score_db* db, const int* sets, int count, int num_dims, double scores[], bool found[]) {
+	int num_found = 0;
+	lock_score_db(db, LOCK_SH);
+	for (int i = 0; i < count; i++) {
+		const int* set = sets + i * num_dims;
+		score_db_record key = {db->config, hash_set(set, num_dims), check_hash(set, num_dims), 0};
+		score_db_record* r = find_record(db, key);
+		found[i] = r->config != 0;
+		if (found[i]) {
+			scores[i] = r->score;
+			num_found++;
+		}
+	}
+	unlock_score_db(db);
+	return num_found;
+}
+
+/* score_db_insert stores the given parameter sets' scores in the given database
+	parameters:
+		db: the database
+		sets: the parameter sets to store, stored consecutively
+		count: the number of sets
+		num_dims: the number of parameters in each set
+		scores: the score of each set
+	returns: nothing
+	notes:
+		The whole batch is stored under one exclusive lock. A set already in the database has its score replaced.
+		The table doubles in capacity whenever it becomes half full.
+	todo:
+*/
+void score_db_insert (score_db* db, const int* sets, int count, int num_dims, const double scores[]) {
+	lock_score_db(db, LOCK_EX);
+	for (int i = 0; i < count; i++) {
+		const int* set = sets + i * num_dims;
+		score_db_record key = {db->config, hash_set(set, num_dims), check_hash(set, num_dims), scores[i]};
+		if (2 * (header(db)->size + 1) > header(db)->capacity) {
+			resize_score_db(db, 2 * header(db)->capacity);
+		}
+		score_db_record* r = find_record(db, key);
+		if (r->config == 0) {
+			header(db)->size++;
+		}
+		*r = key;
+	}
+	unlock_score_db(db);
+}
+
+/* compact_score_db shrinks the user's score database to the smallest capacity that holds its records
+	parameters:
+		ip: the program's input parameters
+	returns: nothing
+	notes:
+		Compacting also drops records with scores that are not finite numbers and rehashes the rest, shortening probe sequences. Other processes may keep using the database while it is compacted.
+	todo:
+*/
+void compact_score_db (input_params& ip) {
+	score_db* db = ip.database;
+	cout << term->blue << "Compacting score database " << term->reset << ip.score_db_file << " . . . ";
+	lock_score_db(db, LOCK_EX);
+	uint64_t old_capacity = header(db)->capacity;
+	uint64_t capacity = SCORE_DB_MIN_CAPACITY;
+	while (capacity < 2 * header(db)->size) {
+		capacity *= 2;
+	}
+	resize_score_db(db, capacity);
+	cout << term->blue << "Done: " << term->reset << header(db)->size << " scores in " << capacity << " slots (was " << old_capacity << "), " << db->map_size << " bytes" << endl;
+	unlock_score_db(db);
+}
@@ -0,0 +1,33 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+scoredb.hpp contains function declarations for scoredb.cpp.
+*/
+
+#ifndef SCOREDB_HPP
+#define SCOREDB_HPP
+
+#include "structs.hpp"
+
+void init_score_db(input_params&);
+int score_db_find(score_db*, const int*, int, int, double[], bool[]);
+void score_db_insert(score_db*, const int*, int, int, const double[]);
+void compact_score_db(input_params&);
+
+#endif
@@ -23,14 +23,24 @@ structs.hpp contains every struct used in the program.
 #ifndef STRUCTS_HPP
 #define STRUCTS_HPP
 
+#include <algorithm> // Needed for max
 #include <cstring> // Needed for strlen, strcpy, strcmp
+#include <pthread.h> // Needed for pthread_mutex_t
+#include <sched.h> // Needed for cpu_set_t
+#include <stdint.h> // Needed for uint64_t
+#include <sys/mman.h> // Needed for munmap
+#include <unistd.h> // Needed for close
 #include <iostream> // Needed for cout
 #include <fstream> // Needed for ofstream
 
+#include "kernels.hpp"
+#include "macros.hpp"
 #include "memory.hpp"
 
 using namespace std;
 
+struct ga_evaluator; // Declared in libga.hpp, which requires this file
+
 char* copy_str(const char*); // init.h cannot be included because it requires this file, structs.h, creating a cyclical dependency; therefore, copy_str, declared in init.h, must be declared in this file as well in order to use it here
 
 /* terminal contains colors, streams, and common messages for terminal output
@@ -146,6 +156,517 @@ struct gradient_index {
 	gradient_index* next; // The next index in the list
 };
 
+/* linear_constraint contains a linear inequality between parameters that every valid parameter set satisfies and a next linear_constraint (i.e. a linked list of constraints)
+	notes:
+		The inequality is stored as the sum of each parameter times its coefficient being at most, or if strict less than, the bound.
+	todo:
+*/
+struct linear_constraint {
+	char* text; // The constraint as written in the ranges file
+	double* coefficients; // The coefficient of each parameter
+	double bound; // The bound the weighted sum must not exceed
+	bool strict; // Whether or not the weighted sum must stay below the bound rather than at most reach it
+	linear_constraint* next; // The next constraint in the list
+	
+	linear_constraint (const char* text, int num_dims) {
+		this->text = copy_str(text);
+		this->coefficients = new double[num_dims];
+		for (int i = 0; i < num_dims; i++) {
+			this->coefficients[i] = 0;
+		}
+		this->bound = 0;
+		this->strict = false;
+		this->next = NULL;
+	}
+	
+	~linear_constraint () {
+		mfree(this->text);
+		delete[] this->coefficients;
+	}
+};
+
+/* packed_population contains the genes of a population kept in the quantized encoding
+	notes:
+		Each gene is stored as its offset from the start of its range, in 16 bits if every range's width fits and 32 bits otherwise, so a member takes 2 or 4 bytes per parameter instead of the 24 its gene and bounds take as doubles. Genes are converted to parameter values only when members are scored.
+		The member after the last is the best member. The codes are carved out of the run's population arena, so they are not freed here.
+	todo:
+*/
+struct packed_population {
+	int count; // The number of members, including the best member after the last
+	int num_dims; // The number of genes per member
+	int bits; // The number of bits each gene is stored in, 16 or 32
+	uint32_t* widths; // The width of each parameter's range, i.e. the largest offset its gene may hold
+	void* codes; // Each member's genes, stored consecutively
+	void* spare; // The genes the selector copies the survivors into before swapping them with codes
+	
+	packed_population (int count, int num_dims) {
+		this->count = count;
+		this->num_dims = num_dims;
+		this->bits = 16;
+		this->widths = new uint32_t[num_dims];
+		this->codes = NULL;
+		this->spare = NULL;
+	}
+	
+	~packed_population () {
+		delete[] this->widths;
+	}
+};
+
+/* task_queue contains the chunks of a parallel pass one thread of a task pool has yet to run
+	notes:
+		The owning thread takes chunks from the front and idle threads steal them from the back, so each thread mostly runs neighboring chunks.
+		Each queue is padded to its own cache line so threads taking chunks from their own queues do not slow each other down.
+	todo:
+*/
+struct task_queue {
+	pthread_mutex_t lock; // Guards the fields below
+	int next; // The first chunk not yet taken
+	int end; // One past the last chunk not yet taken
+	char padding[CACHE_LINE_SIZE]; // Keeps the next queue off this queue's cache line
+	
+	task_queue () {
+		pthread_mutex_init(&(this->lock), NULL);
+		this->next = 0;
+		this->end = 0;
+	}
+	
+	~task_queue () {
+		pthread_mutex_destroy(&(this->lock));
+	}
+};
+
+/* task_pool contains the threads the genetic algorithm's operators run their passes over the population on
+	notes:
+		The thread that starts a pass runs chunks too, so a pool of n threads starts n - 1 of its own, which wait for passes until the pool is deleted.
+		Chunks are dealt out to the threads' queues in contiguous blocks, and a thread that finishes its block steals from the others (see run_tasks).
+	todo:
+*/
+struct task_pool {
+	int num_threads; // The number of threads running each pass, including the one that starts it
+	pthread_t* threads; // The pool's own threads
+	int num_started; // The number of the pool's own threads that were started
+	int num_running; // The number of the pool's own threads that have begun running, used to give each one its queue
+	task_queue* queues; // Each thread's queue of chunks
+	
+	// Handing out passes
+	pthread_mutex_t lock; // Guards the fields below
+	pthread_cond_t start; // Signaled when a pass starts or the pool is stopping
+	pthread_cond_t finished; // Signaled when the last of the pool's own threads finishes a pass
+	void (*task)(void*, int); // The function run on each chunk of the current pass
+	void* arg; // The argument passed to the task along with the chunk's index
+	uint64_t pass; // The number of passes started
+	int busy; // The number of the pool's own threads still running the current pass
+	bool stopping; // Whether or not the threads should exit
+	
+	task_pool (int num_threads) {
+		this->num_threads = num_threads;
+		this->threads = new pthread_t[num_threads];
+		this->num_started = 0;
+		this->num_running = 0;
+		this->queues = new task_queue[num_threads];
+		pthread_mutex_init(&(this->lock), NULL);
+		pthread_cond_init(&(this->start), NULL);
+		pthread_cond_init(&(this->finished), NULL);
+		this->task = NULL;
+		this->arg = NULL;
+		this->pass = 0;
+		this->busy = 0;
+		this->stopping = false;
+	}
+	
+	~task_pool () {
+		pthread_mutex_lock(&(this->lock));
+		this->stopping = true;
+		pthread_cond_broadcast(&(this->start));
+		pthread_mutex_unlock(&(this->lock));
+		for (int i = 0; i < this->num_started; i++) {
+			pthread_join(this->threads[i], NULL);
+		}
+		pthread_mutex_destroy(&(this->lock));
+		pthread_cond_destroy(&(this->start));
+		pthread_cond_destroy(&(this->finished));
+		delete[] this->threads;
+		delete[] this->queues;
+	}
+};
+
+/* worker_pool contains the slots simulations run in, the CPUs each slot is pinned to, and the state used to share the slots between runs
+	notes:
+		At most one simulation runs in each slot at a time, so the number of slots limits how many simulations run at once.
+		Runs take slots with acquire_slot and give them back with release_slot, which may be called from several threads at once.
+	todo:
+*/
+struct worker_pool {
+	int num_slots; // The number of slots
+	bool pinned; // Whether or not simulations are pinned to their slot's CPUs
+	cpu_set_t* masks; // The CPUs each slot's simulations may run on
+	int* nodes; // The NUMA node of each slot's CPUs
+	
+	// Sharing the slots between runs
+	pthread_mutex_t lock; // Guards the fields below
+	bool* busy; // Whether or not each slot is running a simulation
+	int num_runs; // The number of runs sharing the slots
+	int* in_flight; // The number of slots each run holds
+	bool* waiting; // Whether or not each run was refused a slot it still wants
+	int* wake_fds; // An eventfd per run, written to when a slot is released so a waiting run can try again
+	
+	worker_pool (int num_slots, int num_runs) {
+		this->num_slots = num_slots;
+		this->pinned = false;
+		this->masks = new cpu_set_t[num_slots];
+		this->nodes = new int[num_slots];
+		this->busy = new bool[num_slots];
+		for (int i = 0; i < num_slots; i++) {
+			CPU_ZERO(&(this->masks[i]));
+			this->nodes[i] = 0;
+			this->busy[i] = false;
+		}
+		pthread_mutex_init(&(this->lock), NULL);
+		this->num_runs = num_runs;
+		this->in_flight = new int[num_runs];
+		this->waiting = new bool[num_runs];
+		this->wake_fds = new int[num_runs];
+		for (int i = 0; i < num_runs; i++) {
+			this->in_flight[i] = 0;
+			this->waiting[i] = false;
+			this->wake_fds[i] = -1;
+		}
+	}
+	
+	~worker_pool () {
+		for (int i = 0; i < this->num_runs; i++) {
+			if (this->wake_fds[i] != -1) {
+				close(this->wake_fds[i]);
+			}
+		}
+		pthread_mutex_destroy(&(this->lock));
+		delete[] this->masks;
+		delete[] this->nodes;
+		delete[] this->busy;
+		delete[] this->in_flight;
+		delete[] this->waiting;
+		delete[] this->wake_fds;
+	}
+};
+
+/* resource_usage contains the resources used by a group of simulations, as the kernel reported them when each simulation was reaped
+	notes:
+		Block counts only include reads and writes that reached the file system, so reads served from the page cache do not count.
+	todo:
+*/
+struct resource_usage {
+	int simulations; // The number of simulations
+	double user_seconds; // The CPU time the simulations spent in user mode
+	double system_seconds; // The CPU time the simulations spent in the kernel
+	long max_rss; // The largest peak resident set size of any of the simulations, in kilobytes
+	long in_blocks; // The number of blocks the simulations read from the file system
+	long out_blocks; // The number of blocks the simulations wrote to the file system
+	
+	resource_usage () {
+		this->simulations = 0;
+		this->user_seconds = 0;
+		this->system_seconds = 0;
+		this->max_rss = 0;
+		this->in_blocks = 0;
+		this->out_blocks = 0;
+	}
+	
+	void add (const resource_usage& other) {
+		this->simulations += other.simulations;
+		this->user_seconds += other.user_seconds;
+		this->system_seconds += other.system_seconds;
+		this->max_rss = max(this->max_rss, other.max_rss);
+		this->in_blocks += other.in_blocks;
+		this->out_blocks += other.out_blocks;
+	}
+};
+
+/* simulation contains the state of one running simulation
+	notes:
+		A simulation is complete once its process has been reaped and its output pipe has reached end-of-file.
+	todo:
+*/
+struct simulation {
+	pid_t pid; // The simulation's process ID
+	int pidfd; // A file descriptor that becomes readable when the process exits, or -1 if the kernel does not support pidfds
+	int slot; // The worker slot the simulation runs in
+	int index; // The index of the simulation's set in its batch
+	int out_fd; // The reading end of the pipe the simulation writes its score to, or -1 once closed
+	int* parameters; // The parameter set being simulated
+	int output[2]; // The maximum score and score read from the simulation
+	int bytes_read; // The number of bytes of output read so far
+	bool reaped; // Whether or not the process has been reaped
+	int status; // The process's exit status, once reaped
+	resource_usage usage; // The resources the process used, once reaped
+	const char* failure; // Why the simulation failed, or NULL if it succeeded or has not completed
+	bool cancelled; // Whether or not the simulation was killed because the time budget ran out
+	char gradients_file[40]; // The name of the gradients file written for the simulation
+	
+	// When each phase of the simulation began, in seconds of wall_time, for the trace
+	double launch_time; // When the simulation started being launched
+	double run_time; // When the simulation was launched and began running
+	double read_time; // When the simulation's output began arriving
+	double cleanup_time; // When the simulation had exited and closed its output
+	
+	simulation () {
+		this->pid = -1;
+		this->pidfd = -1;
+		this->slot = -1;
+		this->index = -1;
+		this->gradients_file[0] = '\0';
+		this->out_fd = -1;
+		this->parameters = NULL;
+		this->output[0] = 0;
+		this->output[1] = 0;
+		this->bytes_read = 0;
+		this->reaped = false;
+		this->status = 0;
+		this->failure = NULL;
+		this->cancelled = false;
+		this->launch_time = 0;
+		this->run_time = 0;
+		this->read_time = 0;
+		this->cleanup_time = 0;
+	}
+};
+
+/* failure_counts contains the number of simulation failures a run has had and what was done about them
+	notes:
+	todo:
+*/
+struct failure_counts {
+	int failed; // The number of simulations that crashed or exited without a score
+	int retried; // The number of failed simulations run again
+	int penalized; // The number of sets given the failure score after every attempt failed
+	int backoffs; // The number of times launching a simulation was put off because a pipe or process could not be created
+	int leftovers; // The number of gradient files that could not be removed after their simulations were scored
+	
+	failure_counts () {
+		this->failed = 0;
+		this->retried = 0;
+		this->penalized = 0;
+		this->backoffs = 0;
+		this->leftovers = 0;
+	}
+};
+
+/* host_load contains measurements of how busy the host is, read from /proc
+	notes:
+		Pressure stall information is only available on kernels that support it; without it the pressures are 0.
+	todo:
+*/
+struct host_load {
+	double load_per_cpu; // The 1-minute load average divided by the number of online CPUs
+	double cpu_pressure; // The percentage of the last 10 seconds some task was stalled waiting for a CPU
+	double memory_pressure; // The percentage of the last 10 seconds some task was stalled waiting for memory
+	double memory_available; // The fraction of memory available for new processes without swapping
+	
+	host_load () {
+		this->load_per_cpu = 0;
+		this->cpu_pressure = 0;
+		this->memory_pressure = 0;
+		this->memory_available = 1;
+	}
+};
+
+/* concurrency_controller contains the state used to adjust how many simulations a run keeps in flight
+	notes:
+		Throughput is only measured while the run has more sets waiting than it may run at once, so the tail of each batch, when slots go idle for lack of work, does not count against the limit.
+	todo:
+*/
+struct concurrency_controller {
+	int min_limit; // The fewest simulations the run may be limited to
+	int max_limit; // The most simulations the run may be limited to
+	int limit; // The most simulations the run may have in flight right now
+	int direction; // 1 if the last change raised the limit, -1 if it lowered it
+	double mark; // The wall_time of the last completion or the start of the current batch
+	double window_seconds; // The time spent with every allowed slot busy since the limit last changed
+	int window_completions; // The number of simulations completed in that time
+	double last_throughput; // The completions per second measured before the limit last changed, 0 if none
+	
+	// Changes since the run statistics were last reported
+	int raised; // The number of times the limit was raised
+	int lowered; // The number of times the limit was lowered
+	const char* last_reason; // Why the limit last changed, NULL if it has not
+	
+	concurrency_controller (int min_limit, int max_limit, int limit) {
+		this->min_limit = min_limit;
+		this->max_limit = max_limit;
+		this->limit = limit;
+		this->direction = 1;
+		this->mark = 0;
+		this->window_seconds = 0;
+		this->window_completions = 0;
+		this->last_throughput = 0;
+		this->raised = 0;
+		this->lowered = 0;
+		this->last_reason = NULL;
+	}
+};
+
+/* run_metrics contains the progress one run last published to the metrics endpoint
+	notes:
+	todo:
+*/
+struct run_metrics {
+	int generation; // The last generation the run finished (0 during initialization)
+	double best_score; // The best score found so far
+	int evaluations; // The number of simulations run so far
+	double seconds; // The wall-clock time the run has taken so far
+	long lookups; // The number of sets looked up in the score database
+	long hits; // The number of sets whose scores were found in the score database
+	size_t arena_size; // The number of bytes mapped for the run's population arena
+	int job_limit; // The most simulations the run may have in flight
+	resource_usage usage; // The resources the run's simulations have used so far
+	
+	run_metrics () {
+		this->generation = 0;
+		this->best_score = 0;
+		this->evaluations = 0;
+		this->seconds = 0;
+		this->lookups = 0;
+		this->hits = 0;
+		this->arena_size = 0;
+		this->job_limit = 0;
+	}
+};
+
+/* metrics_server contains the endpoint that serves live progress in the Prometheus text format over a Unix-domain socket
+	notes:
+		Runs publish their progress into runs after every generation and a background thread answers each connection with a snapshot, so scraping never waits on a generation.
+	todo:
+*/
+struct metrics_server {
+	char* socket_file; // The path and name of the socket
+	int listen_fd; // The listening socket's file descriptor
+	int stop_fd; // An eventfd written to when the thread should exit
+	pthread_t thread; // The thread answering connections
+	bool started; // Whether or not the thread was started
+	pthread_mutex_t lock; // Guards runs
+	int num_runs; // The number of runs publishing progress
+	run_metrics* runs; // Each run's published progress
+	worker_pool* pool; // The worker pool, read for the number of simulations each run has in flight
+	
+	metrics_server (const char* socket_file, int num_runs) {
+		this->socket_file = copy_str(socket_file);
+		this->listen_fd = -1;
+		this->stop_fd = -1;
+		this->started = false;
+		pthread_mutex_init(&(this->lock), NULL);
+		this->num_runs = num_runs;
+		this->runs = new run_metrics[num_runs];
+		this->pool = NULL;
+	}
+	
+	~metrics_server () {
+		if (this->started) {
+			uint64_t one = 1;
+			if (write(this->stop_fd, &one, sizeof(one)) == sizeof(one)) {
+				pthread_join(this->thread, NULL);
+			}
+		}
+		if (this->listen_fd != -1) {
+			close(this->listen_fd);
+			unlink(this->socket_file);
+		}
+		if (this->stop_fd != -1) {
+			close(this->stop_fd);
+		}
+		pthread_mutex_destroy(&(this->lock));
+		delete[] this->runs;
+		mfree(this->socket_file);
+	}
+};
+
+/* trace_writer contains the trace file and the buffers its events are collected in
+	notes:
+		Events are appended to the active buffer by whichever thread records them, and a background thread writes full buffers to the file, so recording an event never waits on the disk unless both buffers are full.
+	todo:
+*/
+struct trace_writer {
+	char* filename; // The trace file's path and name
+	int fd; // The trace file's file descriptor
+	double origin; // The wall_time every event's timestamp is relative to
+	pthread_t thread; // The thread writing full buffers to the file
+	bool started; // Whether or not the thread was started
+	pthread_mutex_t lock; // Guards the fields below
+	pthread_cond_t changed; // Signaled when a buffer is handed to or returned from the thread, or the thread should stop
+	char* active; // The buffer events are being appended to
+	size_t used; // The number of bytes of the active buffer used
+	char* full; // The buffer waiting to be written, or NULL if none
+	size_t full_used; // The number of bytes of the full buffer used
+	char* spare; // The buffer to swap in when the active one fills, or NULL if the thread is still writing it
+	bool first; // Whether or not no event has been recorded yet (so the next one needs no separating comma)
+	bool stop; // Whether or not the thread should write what is left and exit
+	
+	explicit trace_writer (const char* filename) {
+		this->filename = copy_str(filename);
+		this->fd = -1;
+		this->origin = 0;
+		this->started = false;
+		pthread_mutex_init(&(this->lock), NULL);
+		pthread_cond_init(&(this->changed), NULL);
+		this->active = (char*)mallocate(TRACE_BUFFER_SIZE);
+		this->used = 0;
+		this->full = NULL;
+		this->full_used = 0;
+		this->spare = (char*)mallocate(TRACE_BUFFER_SIZE);
+		this->first = true;
+		this->stop = false;
+	}
+	
+	~trace_writer () {
+		if (this->started) {
+			pthread_mutex_lock(&(this->lock));
+			this->stop = true;
+			pthread_cond_broadcast(&(this->changed));
+			pthread_mutex_unlock(&(this->lock));
+			pthread_join(this->thread, NULL);
+		}
+		if (this->fd != -1) {
+			close(this->fd);
+		}
+		pthread_cond_destroy(&(this->changed));
+		pthread_mutex_destroy(&(this->lock));
+		mfree(this->active);
+		mfree(this->full);
+		mfree(this->spare);
+		mfree(this->filename);
+	}
+};
+
+/* score_db contains an open score database, a hash table of simulated sets' scores memory-mapped from a file any number of runs may share
+	notes:
+		Only the functions in scoredb.cpp should touch the mapping, since they lock the file and remap it if another process has resized it.
+	todo:
+*/
+struct score_db {
+	char* filename; // The database file's path and name
+	int fd; // The database file's file descriptor
+	char* map; // The mapping of the database file
+	size_t map_size; // The number of bytes mapped
+	uint64_t config; // The hash of this run's configuration signature, which every record this run reads or writes is keyed by
+	
+	explicit score_db (const char* filename) {
+		this->filename = copy_str(filename);
+		this->fd = -1;
+		this->map = NULL;
+		this->map_size = 0;
+		this->config = 0;
+	}
+	
+	~score_db () {
+		if (this->map != NULL) {
+			munmap(this->map, this->map_size);
+		}
+		if (this->fd != -1) {
+			close(this->fd);
+		}
+		mfree(this->filename);
+	}
+};
+
 /* input_params contains all of the program's input parameters (i.e. the given command-line arguments) as well as data associated with them
 	notes:
 		There should be only one instance of input_params at any time.
@@ -161,8 +682,20 @@ struct input_params {
 	char* ranges_file; // The relative filename of the parameter ranges file, default=none
 	char* sim_file; // The relative filename of the simulation executable
 	char* good_sets_file; // The relative filename of the good sets file, default=none
+	char* seed_population_file; // The relative filename of a good sets file from an earlier run to seed the initial population with, default=none
+	char* score_db_file; // The relative filename of a score database shared across runs to look scores up in before simulating and store them in afterward, default=none
+	bool compact_score_db; // Whether or not to compact the score database and exit without running the genetic algorithm, default=false
+	score_db* database; // The open score database, created by init_score_db, NULL if none
+	char* sweep_file; // The relative filename of a list of configurations to run at once, one line of extra command-line arguments per run, default=none
+	char* metrics_socket; // The relative filename of a Unix-domain socket to serve live progress on in the Prometheus text format, default=none
+	char* trace_file; // The relative filename of a Chrome trace-event file to record every simulation's and genetic algorithm phase's timeline in, default=none
 	bool print_good_sets; // Whether or not to print good sets to the good sets file, default=false
 	ofstream good_sets_stream; // The output file stream for the good sets file
+	char* quarantine_file; // The relative filename of the file listing the sets whose simulations failed every attempt, default=none
+	ofstream quarantine_stream; // The output file stream for the quarantine file
+	char* usage_file; // The relative filename of the file listing every simulated set with the resources its simulation used, default=none
+	ofstream usage_stream; // The output file stream for the usage file
+	char* checkpoint_file; // The relative filename of the file to write the final population to, in the good sets format --seed-population reads, default=none
 	
 	// Good set threshold
 	double good_set_threshold; // The worst score a set can receive to be printed to the good sets file, default=0.0
@@ -171,15 +704,75 @@ struct input_params {
 	int num_dims; // The number of dimensions (i.e. rate parameters) to explore, default=45
 	int population; // The total population of simulations to use each generation, default=200
 	int generations; // The number of generations to run before returning results, default=1
-	int prob_mutation; // The probability of a mutation occurring for any given population member (from 0 to 1), default=0.001
-	int prob_crossover; // The probability of a crossover occurring for any given population member (from 0 to 1), default=0.9
+	double prob_mutation; // The probability of a mutation occurring for any given population member (from 0 to 1), default=0.001
+	double prob_crossover; // The probability of a crossover occurring for any given population member (from 0 to 1), default=0.9
 	int seed; // The seed used in the genetic algorithm, default=current UNIX time
 	pair<int, int>* ranges; // The array of lower and upper bounds defining the ranges for each dimension
+	int init_design; // The design used to place the initial population in the ranges (DESIGN_RANDOM, DESIGN_SOBOL, or DESIGN_LHS), default=DESIGN_RANDOM
+	int init_oversample; // The number of initial candidates to simulate per population member, keeping only the best, default=1
+	int simd; // The instruction set the mutation and crossover kernels use (SIMD_AUTO picks the best one available), default=SIMD_AUTO
+	bool replace_duplicates; // Whether or not to replace members identical to another member with random immigrants before simulating, default=false
+	int local_search; // The local search run on the best members after every generation (LOCAL_NONE, LOCAL_PATTERN, or LOCAL_COORDINATE), default=LOCAL_NONE
+	int local_elites; // The number of best distinct members the local search refines, default=3
+	int local_budget; // The most sets the local search may score each generation, default=50
+	int engine; // The optimizer that proposes the sets to simulate (ENGINE_GA, ENGINE_CMAES, or ENGINE_DE), default=ENGINE_GA
+	double cmaes_sigma; // The CMA-ES engine's initial step size, relative to the width of each range, default=0.3
+	double de_weight; // The differential evolution engine's weight on the difference between two members, default=0.5
+	double de_crossover; // The differential evolution engine's probability of taking each parameter from the mutant, default=0.9
+	
+	// Sampling mode parameters
+	int mode; // What to do with the ranges (MODE_GA runs the genetic algorithm, MODE_SAMPLE simulates a fixed design), default=MODE_GA
+	long samples; // The number of points the sampling mode simulates (the most, for a grid), default=1000
+	int sample_design; // The design the sampling mode places its points with (DESIGN_RANDOM, DESIGN_SOBOL, or DESIGN_GRID), default=DESIGN_RANDOM
+	bool resume; // Whether or not to continue an interrupted sampling run from its progress file, default=false
 	
 	// Simulation parameters
 	char** sim_args; // Arguments to be passed to the simulation
 	int num_sim_args; // The number of arguments to be passed to the simulation
 	gradient_index* gradient_indices; // The list of parameter indices to apply gradients to, default=none
+	linear_constraint* constraints; // The list of constraints valid parameter sets satisfy, read from the ranges file, default=none
+	int constraint_action; // What to do with a set that breaks a constraint (CONSTRAINT_REPAIR, CONSTRAINT_RESAMPLE, or CONSTRAINT_PENALIZE), default=CONSTRAINT_REPAIR
+	double constraint_penalty; // The score given without simulating to a set that breaks a constraint and could not be fixed, default=0
+	
+	// Parallel evaluation parameters
+	int jobs; // The number of simulations to run at the same time, default=1
+	char* cpus; // The list of CPUs to pin simulations to (e.g. 0-7,16-23 or all), default=none (no pinning)
+	int reserve_cpus; // The number of CPUs at the start of the CPU list to leave free for the genetic algorithm itself, default=0
+	bool adaptive_jobs; // Whether or not to adjust how many simulations run at the same time, between --min-jobs and --jobs, to the measured throughput and host load, default=false
+	int min_jobs; // The fewest simulations to run at the same time when adjusting automatically, default=1
+	concurrency_controller* controller; // The controller adjusting this run's limit, created by init_concurrency, NULL if the limit is fixed at --jobs
+	int retries; // The number of times to run a set's simulation again after it crashes or exits without a score, default=2
+	double retry_delay; // The seconds to wait before the first retry of a set, doubled for each further retry, default=0.1
+	double failure_score; // The score given to a set whose simulations failed every attempt, default=0
+	failure_counts failures; // The simulation failures this run has had
+	resource_usage usage; // The resources this run's simulations used during the current generation, reset by start_run and step_run
+	ga_evaluator* evaluator; // The evaluator that scores sets instead of simulations when the sampler is embedded through libga.hpp, default=none
+	worker_pool* pool; // The worker slots simulations run in, created by init_workers and shared by every run in a sweep
+	int threads; // The number of threads to run the genetic algorithm's operators with, default=1
+	task_pool* tasks; // The threads the operators run on, created by init_tasks, NULL if they run on the calling thread alone
+	int encoding; // How the population's genes are stored, ENCODING_DOUBLE or ENCODING_QUANTIZED, default=ENCODING_DOUBLE
+	packed_population* packed; // The current run's genes in the quantized encoding, owned by the run, NULL if they are stored as doubles
+	int run_index; // The index of this run among the runs sharing the worker pool, default=0
+	metrics_server* metrics; // The metrics endpoint, created by init_metrics and shared by every run in a sweep, NULL if none
+	trace_writer* trace; // The trace, created by init_trace and shared by every run in a sweep, NULL if none
+	
+	// Surrogate model parameters
+	double surrogate_fraction; // The fraction of each generation's members ranked highest by the surrogate model to simulate (from 0 to 1, 1 disables the surrogate), default=1
+	double surrogate_explore; // The fraction of each generation's members to simulate regardless of their predicted scores (from 0 to 1), default=0.05
+	int surrogate_knn; // The number of nearest neighbors the surrogate model averages to predict a score, default=5
+	int surrogate_archive; // The maximum number of simulated sets the surrogate model remembers, default=10000
+	
+	// Stopping rules (a run always stops after the given number of generations)
+	int stall_generations; // The number of generations without the best score improving after which to stop (0 disables the rule), default=0
+	double min_diversity; // The population diversity below which to stop (0 disables the rule), default=0
+	double target_score; // The best score at or above which to stop (negative disables the rule), default=none
+	double time_budget; // The number of wall-clock seconds after which to stop (0 disables the rule), default=0
+	int eval_budget; // The number of simulations after which to stop (0 disables the rule), default=0
+	int budget_action; // What to do with the simulations running when the time budget runs out, BUDGET_DRAIN (let them finish) or BUDGET_CANCEL (kill them), default=BUDGET_DRAIN
+	double budget_deadline; // The wall_time the time budget runs out at, set when a run starts, or 0 if there is no time budget
+	int budget_simulations; // The number of simulations the evaluation budget still allows, set before each batch, or -1 if there is no evaluation budget
+	int unscored; // The number of sets the last batch left unscored because a budget ran out
+	int launches; // The number of simulations the last batch launched, retries included
 	
 	// Output stream data
 	int printing_precision; // The number of digits of precision parameters should be printed with, default=6
@@ -192,6 +785,16 @@ struct input_params {
 		this->ranges_file = NULL;
 		this->sim_file = copy_str("deterministic");
 		this->good_sets_file = NULL;
+		this->seed_population_file = NULL;
+		this->score_db_file = NULL;
+		this->compact_score_db = false;
+		this->database = NULL;
+		this->sweep_file = NULL;
+		this->metrics_socket = NULL;
+		this->trace_file = NULL;
+		this->quarantine_file = NULL;
+		this->usage_file = NULL;
+		this->checkpoint_file = NULL;
 		this->print_good_sets = false;
 		this->good_set_threshold = 0.0;
 		this->num_dims = 45;
@@ -201,9 +804,59 @@ struct input_params {
 		this->prob_crossover = 0.9;
 		this->seed = time(0);
 		this->ranges = NULL;
+		this->init_design = DESIGN_RANDOM;
+		this->init_oversample = 1;
+		this->simd = SIMD_AUTO;
+		this->replace_duplicates = false;
+		this->local_search = LOCAL_NONE;
+		this->local_elites = 3;
+		this->local_budget = 50;
+		this->engine = ENGINE_GA;
+		this->cmaes_sigma = 0.3;
+		this->de_weight = 0.5;
+		this->de_crossover = 0.9;
+		this->mode = MODE_GA;
+		this->samples = 1000;
+		this->sample_design = DESIGN_RANDOM;
+		this->resume = false;
 		this->sim_args = NULL;
 		this->num_sim_args = 0;
 		this->gradient_indices = NULL;
+		this->constraints = NULL;
+		this->constraint_action = CONSTRAINT_REPAIR;
+		this->constraint_penalty = 0;
+		this->jobs = 1;
+		this->cpus = NULL;
+		this->reserve_cpus = 0;
+		this->adaptive_jobs = false;
+		this->min_jobs = 1;
+		this->controller = NULL;
+		this->retries = 2;
+		this->retry_delay = 0.1;
+		this->failure_score = 0;
+		this->evaluator = NULL;
+		this->pool = NULL;
+		this->threads = 1;
+		this->tasks = NULL;
+		this->encoding = ENCODING_DOUBLE;
+		this->packed = NULL;
+		this->run_index = 0;
+		this->metrics = NULL;
+		this->trace = NULL;
+		this->surrogate_fraction = 1;
+		this->surrogate_explore = 0.05;
+		this->surrogate_knn = 5;
+		this->surrogate_archive = 10000;
+		this->stall_generations = 0;
+		this->min_diversity = 0;
+		this->target_score = -1;
+		this->time_budget = 0;
+		this->eval_budget = 0;
+		this->budget_action = BUDGET_DRAIN;
+		this->budget_deadline = 0;
+		this->budget_simulations = -1;
+		this->unscored = 0;
+		this->launches = 0;
 		this->printing_precision = 6;
 		this->verbose = false;
 		this->quiet = false;
@@ -215,6 +868,21 @@ struct input_params {
 		mfree(this->ranges_file);
 		mfree(this->sim_file);
 		mfree(this->good_sets_file);
+		mfree(this->seed_population_file);
+		mfree(this->score_db_file);
+		mfree(this->sweep_file);
+		mfree(this->metrics_socket);
+		delete this->metrics; // Stopped before the pool it reads is deleted
+		mfree(this->trace_file);
+		mfree(this->quarantine_file);
+		mfree(this->usage_file);
+		mfree(this->checkpoint_file);
+		delete this->trace;
+		delete this->database;
+		mfree(this->cpus);
+		delete this->pool;
+		delete this->tasks;
+		delete this->controller;
 		delete[] this->ranges;
 		if (this->sim_args != NULL) {
 			for (int i = 0; i < this->num_sim_args; i++) {
@@ -228,10 +896,264 @@ struct input_params {
 			mfree(gi);
 			gi = gi_next;
 		}
+		linear_constraint* lc = this->constraints;
+		while (lc != NULL) {
+			linear_constraint* lc_next = lc->next;
+			delete lc;
+			lc = lc_next;
+		}
 		delete this->null_stream;
 	}
 };
 
+/* surrogate_model contains an archive of simulated parameter sets and their scores used to predict the scores of unsimulated sets
+	notes:
+		The archive is a ring buffer; once it is full the oldest sets are overwritten.
+		Predictions are inverse distance weighted averages of the nearest archived sets, with distances measured in each dimension relative to its range's width.
+	todo:
+*/
+struct surrogate_model {
+	int num_dims; // The number of dimensions of every archived set
+	int capacity; // The maximum number of sets the archive can hold
+	int size; // The number of sets currently in the archive
+	int next; // The index in the archive to store the next set in
+	int* sets; // The archived parameter sets, stored consecutively
+	double* scores; // The archived scores, indexed the same as sets
+	double* widths; // The width of each dimension's range (1 for empty ranges to avoid dividing by 0)
+	
+	surrogate_model (int num_dims, int capacity) {
+		this->num_dims = num_dims;
+		this->capacity = capacity;
+		this->size = 0;
+		this->next = 0;
+		this->sets = new int[capacity * num_dims];
+		this->scores = new double[capacity];
+		this->widths = new double[num_dims];
+	}
+	
+	~surrogate_model () {
+		delete[] this->sets;
+		delete[] this->scores;
+		delete[] this->widths;
+	}
+};
+
+/* sobol_sequence contains the direction numbers needed to generate points of a Sobol low-discrepancy sequence
+	notes:
+		Each dimension's coordinates are XORed with a random shift, which keeps the sequence's low discrepancy while letting different seeds produce different points.
+	todo:
+*/
+struct sobol_sequence {
+	int num_dims; // The number of dimensions of each point
+	unsigned int* directions; // SOBOL_BITS direction numbers per dimension, stored consecutively
+	unsigned int* shifts; // The random digital shift of each dimension
+	
+	explicit sobol_sequence (int num_dims) {
+		this->num_dims = num_dims;
+		this->directions = new unsigned int[num_dims * SOBOL_BITS];
+		this->shifts = new unsigned int[num_dims];
+	}
+	
+	~sobol_sequence () {
+		delete[] this->directions;
+		delete[] this->shifts;
+	}
+};
+
+/* score_table contains a hash table of parameter sets with known scores
+	notes:
+		The table uses open addressing with linear probing and doubles in capacity whenever it becomes half full.
+	todo:
+*/
+struct score_table {
+	int num_dims; // The number of parameters in every set
+	int capacity; // The number of slots in the table (always a power of 2)
+	int size; // The number of sets in the table
+	int* sets; // The sets, num_dims per slot
+	double* scores; // The score of each slot's set
+	bool* used; // Whether or not each slot holds a set
+	
+	explicit score_table (int num_dims) {
+		this->num_dims = num_dims;
+		this->capacity = 0;
+		this->size = 0;
+		this->sets = NULL;
+		this->scores = NULL;
+		this->used = NULL;
+	}
+	
+	~score_table () {
+		delete[] this->sets;
+		delete[] this->scores;
+		delete[] this->used;
+	}
+};
+
+/* rng_state contains the state of a xoshiro256** random number generator
+	notes:
+		Seed it with rng_seed before drawing from it.
+	todo:
+*/
+struct rng_state {
+	uint64_t s[4];
+};
+
+/* run_state contains data associated with one run of the genetic algorithm that persists between generations
+	notes:
+		The per-generation statistics are reset at the start of every evaluation and printed by report.
+	todo:
+*/
+struct run_state {
+	surrogate_model* surrogate; // The surrogate model used to skip simulating unpromising sets, NULL if disabled
+	rng_state rng; // The random number generator the mutation and crossover operators draw from
+	score_table* known_scores; // The scores of sets loaded from the seed population that do not need to be simulated again, NULL if none
+	
+	// Progress used by the stopping rules
+	double start_time; // The wall-clock time the run started at, in seconds
+	int evaluations; // The number of simulations run so far (scores recalled from the score database do not count)
+	double best_score; // The best score found so far
+	int last_improvement; // The generation the best score last improved in (-1 for the initialization simulations)
+	
+	// Per-generation statistics
+	int duplicates; // The number of members whose parameters were identical to another member's this generation
+	int immigrants; // The number of duplicate members replaced with random immigrants this generation
+	int reused; // The number of sets whose known scores were reused instead of simulating them this generation
+	int simulated; // The number of sets simulated this generation
+	int recalled; // The number of sets whose scores were found in the score database instead of simulating them this generation
+	int unscored; // The number of sets left unscored because a budget ran out, over the whole run
+	int skipped; // The number of sets the surrogate model predicted scores for instead of simulating
+	int predicted; // The number of simulated sets whose scores the surrogate model predicted this generation (0 while it warms up)
+	double surrogate_error; // The mean absolute error of the surrogate model's predictions for the predicted sets simulated this generation
+	int refined; // The number of sets the local search scored this generation
+	int improved; // The number of elites the local search improved this generation
+	double refine_gain; // The largest score improvement the local search found this generation
+	int repaired; // The number of sets that broke a constraint and were repaired or resampled this generation
+	int constrained; // The number of sets that broke a constraint and were given the constraint penalty without simulating them this generation
+	
+	run_state () {
+		this->surrogate = NULL;
+		this->known_scores = NULL;
+		this->start_time = 0;
+		this->evaluations = 0;
+		this->best_score = 0;
+		this->last_improvement = -1;
+		this->duplicates = 0;
+		this->immigrants = 0;
+		this->reused = 0;
+		this->simulated = 0;
+		this->recalled = 0;
+		this->unscored = 0;
+		this->skipped = 0;
+		this->predicted = 0;
+		this->surrogate_error = 0;
+		this->refined = 0;
+		this->improved = 0;
+		this->refine_gain = 0;
+		this->repaired = 0;
+		this->constrained = 0;
+	}
+	
+	~run_state () {
+		delete this->surrogate;
+		delete this->known_scores;
+	}
+};
+
+/* run_summary contains the results of a finished run
+	notes:
+		Sweeps combine their runs' summaries into one table.
+	todo:
+*/
+struct run_summary {
+	double best_score; // The best score found
+	int generations; // The number of generations run
+	int evaluations; // The number of simulations run
+	double seconds; // The wall-clock time the run took
+	const char* stop_reason; // Why the run stopped early, or NULL if it ran every generation
+	failure_counts failures; // The simulation failures the run had
+	resource_usage usage; // The resources the run's simulations used
+	
+	run_summary () {
+		this->best_score = 0;
+		this->generations = 0;
+		this->evaluations = 0;
+		this->seconds = 0;
+		this->stop_reason = NULL;
+	}
+};
+
+/* sweep_run contains one run of a sweep
+	notes:
+		Each run has its own input parameters, parsed from the program's arguments combined with the run's line of the sweep file, but shares the sweep's worker pool, metrics endpoint, and trace.
+	todo:
+*/
+struct sweep_run {
+	char* arguments; // The run's line of the sweep file
+	int num_args; // The number of combined arguments
+	char** args; // The combined arguments, in the form accept_input_params takes
+	input_params* ip; // The run's input parameters
+	char* log_file; // The path and name of the file the run's output is written to
+	ofstream log; // The output file stream for the run's output
+	run_summary summary; // The run's results
+	pthread_t thread; // The thread the run runs in
+	
+	sweep_run () {
+		this->arguments = NULL;
+		this->num_args = 0;
+		this->args = NULL;
+		this->ip = NULL;
+		this->log_file = NULL;
+	}
+	
+	~sweep_run () {
+		mfree(this->arguments);
+		for (int i = 0; i < this->num_args; i++) {
+			mfree(this->args[i]);
+		}
+		delete[] this->args;
+		if (this->ip != NULL) {
+			this->ip->pool = NULL; // The pool, metrics endpoint, and trace belong to the sweep
+			this->ip->metrics = NULL;
+			this->ip->trace = NULL;
+			delete this->ip;
+		}
+		mfree(this->log_file);
+	}
+};
+
+/* run_streambuf is a stream buffer that passes everything written to it on to a buffer chosen by the calling thread
+	notes:
+		cout and the verbose stream are pointed at run_streambufs during a sweep so each run's output goes to its own log, which a thread chooses by setting targets. Threads without a target write to the fallback.
+		Nothing is buffered here, so any number of threads can write at once as long as their targets differ.
+	todo:
+*/
+struct run_streambuf : public streambuf {
+	static thread_local streambuf* targets[2]; // The calling thread's buffers for each channel, defined in sweep.cpp
+	int channel; // Which of the thread's targets to write to (0 for output, 1 for verbose output)
+	streambuf* fallback; // The buffer threads without a target write to
+	
+	run_streambuf (int channel, streambuf* fallback) {
+		this->channel = channel;
+		this->fallback = fallback;
+	}
+	
+	streambuf* target () {
+		return targets[this->channel] != NULL ? targets[this->channel] : this->fallback;
+	}
+	
+	int overflow (int c) {
+		return c == EOF ? 0 : target()->sputc(c);
+	}
+	
+	streamsize xsputn (const char* s, streamsize n) {
+		return target()->sputn(s, n);
+	}
+	
+	int sync () {
+		return target()->pubsync();
+	}
+};
+
 /* input_data contains information for retrieving data from an input file
 	notes:
 		All input files should be read with read_file and an input_data struct, storing their contents in a string buffer.
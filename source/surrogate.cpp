@@ -0,0 +1,191 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+surrogate.cpp contains functions to build and query the surrogate model that predicts scores from previously simulated sets.
+Avoid placing genetic algorithm operators here and add them to galib.cpp instead.
+*/
+
+#include <algorithm> // Needed for sort
+#include <cmath> // Needed for ceil, fabs
+
+#include "surrogate.hpp" // Function declarations
+
+#include "macros.hpp"
+#include "random.hpp"
+
+using namespace std;
+
+extern terminal* term; // Declared in init.cpp
+
+/* init_surrogate creates the surrogate model for the given run if the user enabled it
+	parameters:
+		ip: the program's input parameters
+		rs: the state of the run to create the surrogate model for
+	returns: nothing
+	notes:
+		The surrogate is disabled when every member must be simulated, i.e. when the surrogate fraction is 1.
+	todo:
+*/
+void init_surrogate (input_params& ip, run_state& rs) {
+	if (ip.surrogate_fraction >= 1) {
+		return;
+	}
+	rs.surrogate = new surrogate_model(ip.num_dims, ip.surrogate_archive);
+	for (int i = 0; i < ip.num_dims; i++) {
+		int width = ip.ranges[i].second - ip.ranges[i].first;
+		rs.surrogate->widths[i] = width > 0 ? width : 1;
+	}
+}
+
+/* surrogate_add adds a simulated set and its score to the surrogate model's archive
+	parameters:
+		sm: the surrogate model
+		set: the simulated parameter set
+		score: the score the set received
+	returns: nothing
+	notes:
+		Once the archive is full, the oldest set is overwritten.
+	todo:
+*/
+void surrogate_add (surrogate_model* sm, int set[], double score) {
+	memcpy(sm->sets + sm->next * sm->num_dims, set, sizeof(int) * sm->num_dims);
+	sm->scores[sm->next] = score;
+	sm->next = (sm->next + 1) % sm->capacity;
+	if (sm->size < sm->capacity) {
+		sm->size++;
+	}
+}
+
+/* surrogate_predict predicts the score of the given set with an inverse distance weighted average of its nearest archived neighbors
+	parameters:
+		sm: the surrogate model
+		set: the parameter set to predict the score of
+		k: the number of neighbors to average
+	returns: the predicted score
+	notes:
+		If the set is in the archive, its archived score is returned.
+	todo:
+*/
+double surrogate_predict (surrogate_model* sm, int set[], int k) {
+	if (k > sm->size) {
+		k = sm->size;
+	}
+	
+	// Keep the k nearest sets sorted by distance with an insertion sort since k is small
+	double near_dists[k];
+	double near_scores[k];
+	int found = 0;
+	for (int i = 0; i < sm->size; i++) {
+		int* archived = sm->sets + i * sm->num_dims;
+		double dist = 0;
+		for (int j = 0; j < sm->num_dims; j++) {
+			dist += SQUARE((set[j] - archived[j]) / sm->widths[j]);
+		}
+		if (found == k && dist >= near_dists[k - 1]) {
+			continue;
+		}
+		int pos = found < k ? found++ : k - 1;
+		while (pos > 0 && near_dists[pos - 1] > dist) {
+			near_dists[pos] = near_dists[pos - 1];
+			near_scores[pos] = near_scores[pos - 1];
+			pos--;
+		}
+		near_dists[pos] = dist;
+		near_scores[pos] = sm->scores[i];
+	}
+	
+	// Weight each neighbor by its inverse distance
+	if (found == 0) {
+		return 0;
+	}
+	if (near_dists[0] == 0) {
+		return near_scores[0];
+	}
+	double weighted = 0;
+	double weights = 0;
+	for (int i = 0; i < found; i++) {
+		double weight = 1 / sqrt(near_dists[i]);
+		weighted += weight * near_scores[i];
+		weights += weight;
+	}
+	return weighted / weights;
+}
+
+/* surrogate_ready checks whether the surrogate model has archived enough sets to predict scores with
+	parameters:
+		ip: the program's input parameters
+		sm: the surrogate model, or NULL if it is disabled
+	returns: true if the model predicts scores, false if it is disabled or still warming up
+	notes:
+		The model warms up until it has archived as many sets as one generation's population.
+	todo:
+*/
+bool surrogate_ready (input_params& ip, surrogate_model* sm) {
+	return sm != NULL && sm->size >= ip.population;
+}
+
+/* surrogate_screen chooses which of the given sets to simulate based on their predicted scores
+	parameters:
+		ip: the program's input parameters
+		rs: the state of the run, including its surrogate model
+		sets: the parameter sets to screen, stored consecutively
+		count: the number of sets to screen
+		chosen: an array to mark each set that should be simulated in
+		predictions: an array to store each set's predicted score in
+	returns: the number of sets chosen to be simulated
+	notes:
+		Every set is chosen while the surrogate is disabled or has archived fewer sets than one generation's population.
+		Otherwise the highest predicted sets are chosen, plus a random exploration quota of the rest so that the model keeps learning about unpromising regions.
+	todo:
+*/
+int surrogate_screen (input_params& ip, run_state& rs, int* sets, int count, bool* chosen, double* predictions) {
+	surrogate_model* sm = rs.surrogate;
+	if (!surrogate_ready(ip, sm)) {
+		for (int i = 0; i < count; i++) {
+			chosen[i] = true;
+			predictions[i] = 0;
+		}
+		return count;
+	}
+	
+	// Rank the sets by their predicted scores, best first
+	pair<double, int>* ranked = new pair<double, int>[count];
+	for (int i = 0; i < count; i++) {
+		predictions[i] = surrogate_predict(sm, sets + i * ip.num_dims, ip.surrogate_knn);
+		ranked[i].first = -predictions[i];
+		ranked[i].second = i;
+		chosen[i] = false;
+	}
+	sort(ranked, ranked + count);
+	
+	// Choose the top fraction and then an exploration quota at random from the rest
+	int num_top = ceil(ip.surrogate_fraction * count);
+	int num_explore = min((int)ceil(ip.surrogate_explore * count), count - num_top);
+	for (int i = 0; i < num_top; i++) {
+		chosen[ranked[i].second] = true;
+	}
+	for (int i = num_top; i < num_top + num_explore; i++) {
+		int pick = i + rng_int(rs.rng, count - i);
+		swap(ranked[i], ranked[pick]);
+		chosen[ranked[i].second] = true;
+	}
+	delete[] ranked;
+	return num_top + num_explore;
+}
+
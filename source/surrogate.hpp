@@ -0,0 +1,35 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+surrogate.hpp contains function declarations for surrogate.cpp.
+*/
+
+#ifndef SURROGATE_HPP
+#define SURROGATE_HPP
+
+#include "structs.hpp"
+
+void init_surrogate(input_params&, run_state&);
+void surrogate_add(surrogate_model*, int[], double);
+double surrogate_predict(surrogate_model*, int[], int);
+bool surrogate_ready(input_params&, surrogate_model*);
+int surrogate_screen(input_params&, run_state&, int*, int, bool*, double*);
+
+#endif
+
@@ -0,0 +1,293 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+sweep.cpp contains functions that run several configurations of the genetic algorithm at once in one process.
+Every run is a thread with its own input parameters and output files, and all of the runs' simulations share one worker pool.
+*/
+
+#include <pthread.h> // Needed for pthread_create, pthread_join
+#include <sys/resource.h> // Needed for getrlimit
+
+#include "sweep.hpp" // Function declarations
+
+#include "ga.hpp"
+#include "init.hpp"
+#include "io.hpp"
+#include "macros.hpp"
+#include "metrics.hpp"
+#include "sample.hpp"
+#include "scoredb.hpp"
+#include "trace.hpp"
+#include "workers.hpp"
+
+using namespace std;
+
+extern terminal* term; // Declared in init.cpp
+
+thread_local streambuf* run_streambuf::targets[2] = {NULL, NULL};
+
+/* option_is checks whether the given argument is either form of an option
+	parameters:
+		arg: the argument to check
+		short_name: the option's short form, or NULL if it has none
+		long_name: the option's long form
+	returns: true if the argument is the option, false otherwise
+	notes:
+	todo:
+*/
+static bool option_is (const char* arg, const char* short_name, const char* long_name) {
+	return (short_name != NULL && strcmp(arg, short_name) == 0) || strcmp(arg, long_name) == 0;
+}
+
+/* number_filename appends a run's number to the given filename, so runs of a sweep never share an output file
+	parameters:
+		filename: a pointer to the filename to number
+		index: the index of the run
+	returns: nothing
+	notes:
+	todo:
+*/
+static void number_filename (char** filename, int index) {
+	char* numbered = (char*)mallocate(strlen(*filename) + 16);
+	sprintf(numbered, "%s.%d", *filename, index + 1);
+	store_filename(filename, numbered);
+	mfree(numbered);
+}
+
+/* combine_args combines the program's arguments with a run's line of the sweep file
+	parameters:
+		ip: the program's input parameters
+		line: the run's line, which is split on whitespace (and modified)
+		run: the run to store the combined arguments in
+	returns: nothing
+	notes:
+		The line's arguments are placed after the program's, so they override them, but before any -a or --arguments, which takes every argument after it.
+		--sweep, --quiet, and --no-color apply to the whole sweep, so they are dropped from the program's arguments and not allowed in lines.
+	todo:
+*/
+static void combine_args (input_params& ip, char* line, sweep_run& run) {
+	int max_args = ip.argc + strlen(line) / 2 + 2;
+	run.args = new char*[max_args];
+	run.args[run.num_args++] = copy_str(ip.argv[0]);
+	
+	// Copy the program's arguments up to -a or --arguments
+	int tail = ip.argc;
+	for (int i = 1; i < ip.argc; i++) {
+		const char* arg = ip.argv[i];
+		if (option_is(arg, "-a", "--arguments")) {
+			tail = i;
+			break;
+		} else if (option_is(arg, NULL, "--sweep")) {
+			i++;
+		} else if (!option_is(arg, "-q", "--quiet") && !option_is(arg, "-c", "--no-color")) {
+			run.args[run.num_args++] = copy_str(arg);
+		}
+	}
+	
+	// Add the line's arguments and then the rest of the program's
+	char* save = NULL;
+	for (char* token = strtok_r(line, " \t\r", &save); token != NULL; token = strtok_r(NULL, " \t\r", &save)) {
+		if (option_is(token, NULL, "--sweep") || option_is(token, "-q", "--quiet") || option_is(token, "-c", "--no-color")) {
+			usage("The sweep file cannot contain --sweep, --quiet, or --no-color since they apply to the whole sweep. Give them on the command line instead.");
+		}
+		run.args[run.num_args++] = copy_str(token);
+	}
+	for (int i = tail; i < ip.argc; i++) {
+		run.args[run.num_args++] = copy_str(ip.argv[i]);
+	}
+}
+
+/* init_run prepares one run of a sweep from its line of the sweep file
+	parameters:
+		ip: the program's input parameters
+		run: the run to prepare
+		index: the run's index in the sweep
+	returns: nothing
+	notes:
+		A run whose line does not name a good sets, quarantine, or usage file but inherits one from the program's arguments writes to that file with the run's number appended, so runs never share an output file.
+	todo:
+*/
+static void init_run (input_params& ip, sweep_run& run, int index) {
+	char* line = copy_str(run.arguments);
+	combine_args(ip, line, run);
+	mfree(line);
+	bool own_good_sets = false;
+	bool own_quarantine = false;
+	bool own_usage = false;
+	bool own_checkpoint = false;
+	for (int i = ip.argc; i < run.num_args; i++) {
+		own_good_sets |= option_is(run.args[i], "-o", "--print-good-sets");
+		own_quarantine |= option_is(run.args[i], NULL, "--quarantine");
+		own_usage |= option_is(run.args[i], NULL, "--usage-file");
+		own_checkpoint |= option_is(run.args[i], NULL, "--checkpoint-file");
+	}
+	
+	input_params& rip = *(run.ip = new input_params());
+	accept_input_params(run.num_args, run.args, rip);
+	check_input_params(rip);
+	init_sim_args(rip);
+	rip.pool = ip.pool;
+	rip.metrics = ip.metrics;
+	rip.trace = ip.trace;
+	rip.run_index = index;
+	init_concurrency(rip);
+	if (rip.print_good_sets && !own_good_sets) {
+		number_filename(&(rip.good_sets_file), index);
+	}
+	if (rip.quarantine_file != NULL && !own_quarantine) {
+		number_filename(&(rip.quarantine_file), index);
+	}
+	if (rip.usage_file != NULL && !own_usage) {
+		number_filename(&(rip.usage_file), index);
+	}
+	if (rip.checkpoint_file != NULL && !own_checkpoint) {
+		number_filename(&(rip.checkpoint_file), index);
+	}
+	create_good_sets_file(rip);
+	input_data ranges_data(rip.ranges_file);
+	read_ranges(rip, ranges_data);
+	init_score_db(rip);
+	
+	run.log_file = (char*)mallocate(strlen(ip.sweep_file) + 20);
+	sprintf(run.log_file, "%s.%d.log", ip.sweep_file, index + 1);
+	open_file(&(run.log), run.log_file, false);
+}
+
+/* sweep_thread runs one run of a sweep, writing its output to the run's log
+	parameters:
+		arg: a pointer to the sweep_run to run
+	returns: NULL
+	notes:
+	todo:
+*/
+static void* sweep_thread (void* arg) {
+	sweep_run* run = (sweep_run*)arg;
+	run_streambuf::targets[0] = run->log.rdbuf();
+	run_streambuf::targets[1] = run->ip->verbose ? run->log.rdbuf() : run->ip->null_stream->rdbuf();
+	if (run->ip->mode == MODE_SAMPLE) {
+		run_sample(*(run->ip), run->summary);
+	} else {
+		run_ga(*(run->ip), run->summary);
+	}
+	delete_files(*(run->ip));
+	run->log.flush();
+	run_streambuf::targets[0] = NULL;
+	run_streambuf::targets[1] = NULL;
+	return NULL;
+}
+
+/* run_sweep runs every configuration in the user's sweep file at once and prints a combined summary
+	parameters:
+		ip: the program's input parameters
+	returns: nothing
+	notes:
+		Each non-empty line of the sweep file that does not start with # is one run, given as command-line arguments that are added to the program's own. Every run writes its output to <sweep file>.<run>.log and its good sets to its own file.
+		--jobs, --cpus, --reserve-cpus, and --simd set up the shared worker pool and kernels, so only the program's values are used for them; a line's --jobs only limits how many of the slots its run may hold at once.
+		The summary is printed and written as comma-separated values to <sweep file>.summary.
+	todo:
+*/
+void run_sweep (input_params& ip) {
+	// Read the runs from the sweep file
+	input_data sweep_data(ip.sweep_file);
+	read_file(&sweep_data);
+	int num_runs = 0;
+	for (char* line = sweep_data.buffer; *line != '\0'; ) {
+		char* end = line + strcspn(line, "\n");
+		char* first = line + strspn(line, " \t\r");
+		num_runs += first < end && *first != '#';
+		line = *end == '\0' ? end : end + 1;
+	}
+	if (num_runs == 0) {
+		usage("The sweep file must contain at least one configuration. Add a line of arguments for each run to the file given with --sweep.");
+	}
+	sweep_run* runs = new sweep_run[num_runs];
+	int index = 0;
+	for (char* line = sweep_data.buffer; *line != '\0'; ) {
+		char* end = line + strcspn(line, "\n");
+		char* first = line + strspn(line, " \t\r");
+		if (first < end && *first != '#') {
+			runs[index].arguments = (char*)mallocate(end - first + 1);
+			memcpy(runs[index].arguments, first, end - first);
+			runs[index].arguments[end - first] = '\0';
+			index++;
+		}
+		line = *end == '\0' ? end : end + 1;
+	}
+	
+	// Set up the shared worker pool and then each run
+	init_workers(ip, num_runs);
+	init_metrics(ip, num_runs);
+	init_trace(ip, num_runs);
+	for (int i = 0; i < num_runs; i++) {
+		init_run(ip, runs[i], i);
+	}
+	cout << term->blue << "Running " << term->reset << num_runs << " runs sharing " << ip.pool->num_slots << " simulation slots . . . ";
+	cout.flush();
+	
+	// Send each thread's output to its run's log while the runs are running
+	streambuf* cout_buffer = cout.rdbuf();
+	streambuf* verbose_buffer = term->verbose_streambuf;
+	run_streambuf output(0, cout_buffer);
+	run_streambuf verbose(1, verbose_buffer);
+	cout.rdbuf(&output);
+	term->set_verbose_streambuf(&verbose);
+	
+	// Run every run in its own thread, with as much stack as the main thread gets
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	rlimit stack_limit;
+	if (getrlimit(RLIMIT_STACK, &stack_limit) == 0 && stack_limit.rlim_cur != RLIM_INFINITY && stack_limit.rlim_cur > (rlim_t)PTHREAD_STACK_MIN) {
+		pthread_attr_setstacksize(&attr, stack_limit.rlim_cur);
+	}
+	for (int i = 0; i < num_runs; i++) {
+		if (pthread_create(&(runs[i].thread), &attr, sweep_thread, &runs[i]) != 0) {
+			cout << term->red << "Couldn't start a thread for run " << i + 1 << "!" << term->reset << endl;
+			exit(EXIT_FORK_ERROR);
+		}
+	}
+	for (int i = 0; i < num_runs; i++) {
+		pthread_join(runs[i].thread, NULL);
+	}
+	pthread_attr_destroy(&attr);
+	cout.rdbuf(cout_buffer);
+	term->set_verbose_streambuf(verbose_buffer);
+	term->done();
+	
+	// Print and write the combined summary
+	ofstream summary_stream;
+	char* summary_file = (char*)mallocate(strlen(ip.sweep_file) + 9);
+	sprintf(summary_file, "%s.summary", ip.sweep_file);
+	open_file(&summary_stream, summary_file, false);
+	summary_stream << "run,arguments,best_score,generations,simulations,seconds,stop_reason,failed,retried,penalized,backoffs,cpu_seconds,max_rss_kb" << endl;
+	for (int i = 0; i < num_runs; i++) {
+		run_summary& s = runs[i].summary;
+		cout << "  " << term->blue << "Run " << i + 1 << term->reset << " (" << runs[i].arguments << "): best score " << s.best_score << " after " << s.generations << " generations, " << s.evaluations << " simulations, " << s.seconds << " seconds";
+		if (s.stop_reason != NULL) {
+			cout << " (stopped early because " << s.stop_reason << ")";
+		}
+		if (s.failures.failed > 0 || s.failures.backoffs > 0) {
+			cout << term->yellow << " (" << s.failures.failed << " failed simulations, " << s.failures.penalized << " sets given the failure score)" << term->reset;
+		}
+		cout << endl;
+		summary_stream << i + 1 << ",\"" << runs[i].arguments << "\"," << s.best_score << "," << s.generations << "," << s.evaluations << "," << s.seconds << "," << (s.stop_reason != NULL ? s.stop_reason : "") << "," << s.failures.failed << "," << s.failures.retried << "," << s.failures.penalized << "," << s.failures.backoffs << "," << s.usage.user_seconds + s.usage.system_seconds << "," << s.usage.max_rss << endl;
+	}
+	summary_stream.close();
+	mfree(summary_file);
+	delete[] runs;
+}
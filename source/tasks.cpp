@@ -0,0 +1,163 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+tasks.cpp contains functions that run the genetic algorithm's operators over chunks of the population on a pool of threads that steal chunks from each other.
+*/
+
+#include <pthread.h> // Needed for pthread_create, pthread_cond_wait
+
+#include "tasks.hpp" // Function declarations
+
+#include "macros.hpp"
+
+extern terminal* term; // Declared in init.cpp
+
+void* task_thread(void*);
+void work_on_pass(task_pool*, int);
+
+/* init_tasks starts the threads the genetic algorithm's operators run on, if the user asked for more than one
+	parameters:
+		ip: the program's input parameters
+	returns: nothing
+	notes:
+		With one thread, ip.tasks stays NULL and the operators run their original serial passes.
+	todo:
+*/
+void init_tasks (input_params& ip) {
+	if (ip.threads <= 1 || ip.tasks != NULL) {
+		return;
+	}
+	task_pool* pool = new task_pool(ip.threads);
+	for (int i = 0; i < ip.threads - 1; i++) {
+		if (pthread_create(&(pool->threads[i]), NULL, task_thread, pool) != 0) {
+			cout << term->red << "Couldn't start a thread for the genetic algorithm's operators!" << term->reset << endl;
+			exit(EXIT_FORK_ERROR);
+		}
+		pool->num_started++;
+	}
+	ip.tasks = pool;
+}
+
+/* task_thread runs chunks of every pass the pool starts until the pool is deleted
+	parameters:
+		arg: the task pool
+	returns: NULL
+	notes:
+		Each thread takes the queue after the starting thread's, in the order the threads first run.
+	todo:
+*/
+void* task_thread (void* arg) {
+	task_pool* pool = (task_pool*)arg;
+	int self = __sync_add_and_fetch(&(pool->num_running), 1);
+	uint64_t seen = 0; // Passes are counted from the pool's creation, so a thread that starts late still runs the first one
+	pthread_mutex_lock(&(pool->lock));
+	while (true) {
+		while (pool->pass == seen && !pool->stopping) {
+			pthread_cond_wait(&(pool->start), &(pool->lock));
+		}
+		if (pool->stopping) {
+			break;
+		}
+		seen = pool->pass;
+		pthread_mutex_unlock(&(pool->lock));
+		work_on_pass(pool, self);
+		pthread_mutex_lock(&(pool->lock));
+		pool->busy--;
+		if (pool->busy == 0) {
+			pthread_cond_signal(&(pool->finished));
+		}
+	}
+	pthread_mutex_unlock(&(pool->lock));
+	return NULL;
+}
+
+/* work_on_pass runs chunks of the current pass until every queue is empty
+	parameters:
+		pool: the task pool
+		self: the index of the calling thread's queue
+	returns: nothing
+	notes:
+		Chunks are taken from the front of the thread's own queue, then stolen from the back of the other queues in turn.
+	todo:
+*/
+void work_on_pass (task_pool* pool, int self) {
+	for (int i = 0; i < pool->num_threads; i++) {
+		task_queue* queue = &(pool->queues[(self + i) % pool->num_threads]);
+		while (true) {
+			int chunk = -1;
+			pthread_mutex_lock(&(queue->lock));
+			if (queue->next < queue->end) {
+				if (i == 0) {
+					chunk = queue->next++;
+				} else {
+					chunk = --queue->end;
+				}
+			}
+			pthread_mutex_unlock(&(queue->lock));
+			if (chunk == -1) {
+				break;
+			}
+			pool->task(pool->arg, chunk);
+		}
+	}
+}
+
+/* run_tasks runs the given task on every chunk of a pass, returning once every chunk has run
+	parameters:
+		pool: the task pool to run the chunks on, or NULL to run them all on the calling thread
+		num_chunks: the number of chunks
+		task: the function to run on each chunk, given the argument and the chunk's index
+		arg: the argument to pass to the task
+	returns: nothing
+	notes:
+		The chunks are dealt out to the threads' queues in contiguous blocks, and the calling thread runs the first block itself.
+		Which thread runs a chunk varies from pass to pass, so tasks must give the same result whichever thread runs them: each chunk should write only its own members and its own slot of any reduction, and draw from a random number stream of its own.
+	todo:
+*/
+void run_tasks (task_pool* pool, int num_chunks, void (*task)(void*, int), void* arg) {
+	if (pool == NULL || num_chunks <= 1) {
+		for (int chunk = 0; chunk < num_chunks; chunk++) {
+			task(arg, chunk);
+		}
+		return;
+	}
+	for (int i = 0; i < pool->num_threads; i++) {
+		task_queue* queue = &(pool->queues[i]);
+		pthread_mutex_lock(&(queue->lock));
+		queue->next = (long)num_chunks * i / pool->num_threads;
+		queue->end = (long)num_chunks * (i + 1) / pool->num_threads;
+		pthread_mutex_unlock(&(queue->lock));
+	}
+	pthread_mutex_lock(&(pool->lock));
+	pool->task = task;
+	pool->arg = arg;
+	pool->busy = pool->num_started;
+	pool->pass++;
+	pthread_cond_broadcast(&(pool->start));
+	pthread_mutex_unlock(&(pool->lock));
+	
+	work_on_pass(pool, 0);
+	
+	pthread_mutex_lock(&(pool->lock));
+	while (pool->busy > 0) {
+		pthread_cond_wait(&(pool->finished), &(pool->lock));
+	}
+	pthread_mutex_unlock(&(pool->lock));
+}
+
@@ -0,0 +1,249 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+trace.cpp contains functions for recording a timeline of the simulations and genetic algorithm phases in the Chrome trace-event format, which chrome://tracing and Perfetto open.
+Simulations are shown as one track per worker slot and each run's phases as one track per run.
+*/
+
+#include <cerrno> // Needed for errno
+#include <cstdio> // Needed for snprintf
+#include <fcntl.h> // Needed for open
+
+#include "trace.hpp" // Function declarations
+
+#include "init.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+extern terminal* term; // Declared in init.cpp
+
+// The trace-event process IDs the tracks are grouped under
+#define TRACE_SIMULATIONS	1
+#define TRACE_RUNS			2
+
+/* write_all writes the given bytes to the trace file
+	parameters:
+		tw: the trace
+		bytes: the bytes to write
+		size: the number of bytes
+	returns: true if every byte was written, false otherwise
+	notes:
+	todo:
+*/
+static bool write_all (trace_writer* tw, const char* bytes, size_t size) {
+	while (size > 0) {
+		ssize_t written = write(tw->fd, bytes, size);
+		if (written == -1 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return false;
+		}
+		bytes += written;
+		size -= written;
+	}
+	return true;
+}
+
+/* trace_thread writes full buffers to the trace file until the trace is stopped, then writes what is left and closes the event list
+	parameters:
+		arg: a pointer to the trace_writer to write
+	returns: NULL
+	notes:
+		Nothing is printed here since the thread's output would not go to any run's log. If the disk fills up, the rest of the trace is dropped rather than stopping the runs.
+	todo:
+*/
+static void* trace_thread (void* arg) {
+	trace_writer* tw = (trace_writer*)arg;
+	bool ok = true;
+	pthread_mutex_lock(&(tw->lock));
+	while (true) {
+		while (tw->full == NULL && !tw->stop) {
+			pthread_cond_wait(&(tw->changed), &(tw->lock));
+		}
+		if (tw->full != NULL) {
+			char* buffer = tw->full;
+			size_t used = tw->full_used;
+			tw->full = NULL;
+			pthread_mutex_unlock(&(tw->lock));
+			ok = ok && write_all(tw, buffer, used);
+			pthread_mutex_lock(&(tw->lock));
+			tw->spare = buffer;
+			pthread_cond_broadcast(&(tw->changed));
+		} else {
+			break;
+		}
+	}
+	ok = ok && write_all(tw, tw->active, tw->used);
+	pthread_mutex_unlock(&(tw->lock));
+	if (ok) {
+		write_all(tw, "\n]}\n", 4);
+	}
+	return NULL;
+}
+
+/* record_event appends one event to the trace
+	parameters:
+		tw: the trace
+		event: the event's JSON object
+	returns: nothing
+	notes:
+		If the active buffer is full it is handed to the writing thread, waiting only if the thread has not finished writing the previous one.
+	todo:
+*/
+static void record_event (trace_writer* tw, const char* event) {
+	size_t length = strlen(event);
+	pthread_mutex_lock(&(tw->lock));
+	if (tw->used + length + 2 > TRACE_BUFFER_SIZE) {
+		while (tw->spare == NULL) {
+			pthread_cond_wait(&(tw->changed), &(tw->lock));
+		}
+		tw->full = tw->active;
+		tw->full_used = tw->used;
+		tw->active = tw->spare;
+		tw->used = 0;
+		tw->spare = NULL;
+		pthread_cond_broadcast(&(tw->changed));
+	}
+	if (!tw->first) {
+		tw->active[tw->used++] = ',';
+		tw->active[tw->used++] = '\n';
+	}
+	tw->first = false;
+	memcpy(tw->active + tw->used, event, length);
+	tw->used += length;
+	pthread_mutex_unlock(&(tw->lock));
+}
+
+/* record_span appends a complete event spanning the given times to the trace
+	parameters:
+		tw: the trace
+		name: the span's name
+		pid: the process ID of the track's group
+		tid: the thread ID of the track
+		start: when the span began, in seconds of wall_time
+		end: when the span ended, in seconds of wall_time
+		args: extra JSON members for the span's args, or an empty string
+	returns: nothing
+	notes:
+	todo:
+*/
+static void record_span (trace_writer* tw, const char* name, int pid, int tid, double start, double end, const char* args) {
+	char event[384];
+	snprintf(event, sizeof(event), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{%s}}", name, pid, tid, (start - tw->origin) * 1e6, (end - start) * 1e6, args);
+	record_event(tw, event);
+}
+
+/* name_track appends metadata naming a group of tracks or a track to the trace
+	parameters:
+		tw: the trace
+		kind: process_name to name a group or thread_name to name a track
+		pid: the process ID of the group
+		tid: the thread ID of the track (ignored for groups)
+		name: the name
+	returns: nothing
+	notes:
+	todo:
+*/
+static void name_track (trace_writer* tw, const char* kind, int pid, int tid, const char* name) {
+	char event[192];
+	snprintf(event, sizeof(event), "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", kind, pid, tid, name);
+	record_event(tw, event);
+}
+
+/* init_trace opens the trace file and starts its writing thread if the user specified tracing
+	parameters:
+		ip: the program's input parameters
+		num_runs: the number of runs that will record phases
+	returns: nothing
+	notes:
+		This must be called after init_workers since the slots' tracks are named here.
+	todo:
+*/
+void init_trace (input_params& ip, int num_runs) {
+	if (ip.trace_file == NULL) {
+		return;
+	}
+	trace_writer* tw = ip.trace = new trace_writer(ip.trace_file);
+	tw->origin = wall_time();
+	tw->fd = open(tw->filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (tw->fd == -1 || !write_all(tw, "{\"traceEvents\":[\n", 17)) {
+		cout << term->red << "Couldn't write to " << tw->filename << "!" << term->reset << endl;
+		exit(EXIT_FILE_WRITE_ERROR);
+	}
+	if (pthread_create(&(tw->thread), NULL, trace_thread, tw) != 0) {
+		cout << term->red << "Couldn't start the trace's writing thread!" << term->reset << endl;
+		exit(EXIT_FORK_ERROR);
+	}
+	tw->started = true;
+	
+	char name[32];
+	name_track(tw, "process_name", TRACE_SIMULATIONS, 0, "simulations");
+	for (int i = 0; i < ip.pool->num_slots; i++) {
+		snprintf(name, sizeof(name), "slot %d", i);
+		name_track(tw, "thread_name", TRACE_SIMULATIONS, i, name);
+	}
+	name_track(tw, "process_name", TRACE_RUNS, 0, "genetic algorithm");
+	for (int i = 0; i < num_runs; i++) {
+		snprintf(name, sizeof(name), "run %d", i + 1);
+		name_track(tw, "thread_name", TRACE_RUNS, i + 1, name);
+	}
+	term->verbose() << term->blue << "Tracing " << term->reset << "to " << tw->filename << endl;
+}
+
+/* trace_phase records a genetic algorithm phase that has just ended on its run's track
+	parameters:
+		ip: the run's input parameters
+		name: the phase's name (e.g. selector or evaluate)
+		start: when the phase began, in seconds of wall_time
+	returns: nothing
+	notes:
+		This does nothing if the user did not specify tracing.
+	todo:
+*/
+void trace_phase (input_params& ip, const char* name, double start) {
+	if (ip.trace != NULL) {
+		record_span(ip.trace, name, TRACE_RUNS, ip.run_index + 1, start, wall_time(), "");
+	}
+}
+
+/* trace_simulation records the launch, run, read, and cleanup phases of a simulation that has just been completed on its slot's track
+	parameters:
+		ip: the run's input parameters
+		sim: the simulation, with its phases' start times set
+	returns: nothing
+	notes:
+		This does nothing if the user did not specify tracing.
+	todo:
+*/
+void trace_simulation (input_params& ip, simulation* sim) {
+	trace_writer* tw = ip.trace;
+	if (tw == NULL) {
+		return;
+	}
+	char args[160];
+	snprintf(args, sizeof(args), "\"run\":%d,\"pid\":%d,\"user_seconds\":%g,\"system_seconds\":%g,\"max_rss_kb\":%ld", ip.run_index + 1, (int)sim->pid, sim->usage.user_seconds, sim->usage.system_seconds, sim->usage.max_rss);
+	double end = wall_time();
+	double read_time = sim->read_time > 0 ? sim->read_time : sim->cleanup_time;
+	record_span(tw, "launch", TRACE_SIMULATIONS, sim->slot, sim->launch_time, sim->run_time, args);
+	record_span(tw, "run", TRACE_SIMULATIONS, sim->slot, sim->run_time, read_time, args);
+	record_span(tw, "read", TRACE_SIMULATIONS, sim->slot, read_time, sim->cleanup_time, args);
+	record_span(tw, "cleanup", TRACE_SIMULATIONS, sim->slot, sim->cleanup_time, end, args);
+}
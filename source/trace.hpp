@@ -0,0 +1,32 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+trace.hpp contains function declarations for trace.cpp.
+*/
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "structs.hpp"
+
+void init_trace(input_params&, int);
+void trace_phase(input_params&, const char*, double);
+void trace_simulation(input_params&, simulation*);
+
+#endif
@@ -0,0 +1,790 @@
+/*
+Genetic algorithm sampler for zebrafish segmentation
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+workers.cpp contains functions that run several simulations at once in worker slots, wait on them with an event loop, and place those slots on the machine's CPUs.
+*/
+
+#include <algorithm> // Needed for min, max
+#include <cerrno> // Needed for errno
+#include <cmath> // Needed for ceil, ldexp
+#include <csignal> // Needed for signal, kill
+#include <cstdio> // Needed for fopen, fgets
+#include <sched.h> // Needed for sched_setaffinity, sched_getaffinity
+#include <sys/epoll.h> // Needed for epoll_create1, epoll_ctl, epoll_wait
+#include <sys/eventfd.h> // Needed for eventfd
+#include <unistd.h> // Needed for sysconf
+
+#include "workers.hpp" // Function declarations
+
+#include "init.hpp"
+#include "io.hpp"
+#include "macros.hpp"
+#include "scoredb.hpp"
+#include "trace.hpp"
+
+extern terminal* term; // Declared in init.cpp
+
+/* parse_cpu_list parses a Linux-style CPU list (e.g. 0-3,8,10-11)
+	parameters:
+		list: the list to parse
+		cpus: an array to store the CPUs in, in the order they appear
+		max_cpus: the number of CPUs the array can hold
+	returns: the number of CPUs in the list, or -1 if the list is invalid or too long
+	notes:
+	todo:
+*/
+int parse_cpu_list (const char* list, int* cpus, int max_cpus) {
+	int count = 0;
+	const char* pos = list;
+	while (*pos != '\0' && *pos != '\n') {
+		char* end;
+		long first = strtol(pos, &end, 10);
+		if (end == pos || first < 0) {
+			return -1;
+		}
+		long last = first;
+		pos = end;
+		if (*pos == '-') {
+			pos++;
+			last = strtol(pos, &end, 10);
+			if (end == pos || last < first) {
+				return -1;
+			}
+			pos = end;
+		}
+		for (long cpu = first; cpu <= last; cpu++) {
+			if (count == max_cpus || cpu >= CPU_SETSIZE) {
+				return -1;
+			}
+			cpus[count++] = cpu;
+		}
+		if (*pos == ',') {
+			pos++;
+		} else if (*pos != '\0' && *pos != '\n') {
+			return -1;
+		}
+	}
+	return count;
+}
+
+/* cpu_node finds the NUMA node the given CPU belongs to
+	parameters:
+		cpu: the CPU
+	returns: the CPU's node, or 0 if the machine does not report its NUMA topology
+	notes:
+	todo:
+*/
+static int cpu_node (int cpu) {
+	for (int node = 0; ; node++) {
+		char path[64];
+		sprintf(path, "/sys/devices/system/node/node%d/cpulist", node);
+		FILE* file = fopen(path, "r");
+		if (file == NULL) {
+			return 0;
+		}
+		char line[4096];
+		int cpus[CPU_SETSIZE];
+		int count = fgets(line, sizeof(line), file) == NULL ? -1 : parse_cpu_list(line, cpus, CPU_SETSIZE);
+		fclose(file);
+		for (int i = 0; i < count; i++) {
+			if (cpus[i] == cpu) {
+				return node;
+			}
+		}
+	}
+}
+
+/* init_workers creates the worker slots and, if the user gave a CPU list, decides which CPUs each slot is pinned to
+	parameters:
+		ip: the program's input parameters
+		num_runs: the number of runs that will share the slots
+	returns: nothing
+	notes:
+		The first --reserve-cpus CPUs of the list are given to the genetic algorithm process. Slots are dealt round-robin across the NUMA nodes of the remaining CPUs, and each node's CPUs are split evenly between its slots, so a slot never spans nodes. If there are more slots than CPUs on a node, its slots share CPUs.
+		The placement is printed so the user can check it.
+	todo:
+*/
+void init_workers (input_params& ip, int num_runs) {
+	signal(SIGPIPE, SIG_IGN); // A simulation that exits before reading its parameters must fail its launch, not kill the program
+	ip.pool = new worker_pool(ip.jobs, num_runs);
+	for (int run = 0; run < num_runs; run++) {
+		ip.pool->wake_fds[run] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (ip.pool->wake_fds[run] == -1) {
+			term->failed_pipe_create();
+			exit(EXIT_PIPE_CREATE_ERROR);
+		}
+	}
+	if (ip.cpus == NULL) {
+		return;
+	}
+	
+	// Read the CPU list
+	int cpus[CPU_SETSIZE];
+	int num_cpus = 0;
+	if (strcmp(ip.cpus, "all") == 0) {
+		cpu_set_t allowed;
+		sched_getaffinity(0, sizeof(allowed), &allowed);
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &allowed)) {
+				cpus[num_cpus++] = cpu;
+			}
+		}
+	} else {
+		num_cpus = parse_cpu_list(ip.cpus, cpus, CPU_SETSIZE);
+		if (num_cpus <= 0) {
+			usage("The CPU list must be a valid list of CPUs. Set --cpus to a list like 0-7,16-23 or to all.");
+		}
+	}
+	if (num_cpus <= ip.reserve_cpus) {
+		usage("At least one CPU must be left for simulations. Set --reserve-cpus to less than the number of CPUs given with --cpus.");
+	}
+	
+	// Pin the genetic algorithm to the reserved CPUs
+	if (ip.reserve_cpus > 0) {
+		cpu_set_t reserved;
+		CPU_ZERO(&reserved);
+		for (int i = 0; i < ip.reserve_cpus; i++) {
+			CPU_SET(cpus[i], &reserved);
+		}
+		if (sched_setaffinity(0, sizeof(reserved), &reserved) == -1) {
+			cout << term->red << "Couldn't pin the genetic algorithm to its reserved CPUs!" << term->reset << endl;
+		}
+	}
+	
+	// Group the remaining CPUs by NUMA node
+	int num_free = num_cpus - ip.reserve_cpus;
+	int* free_cpus = cpus + ip.reserve_cpus;
+	int nodes[num_free];
+	int node_ids[num_free];
+	int num_nodes = 0;
+	for (int i = 0; i < num_free; i++) {
+		nodes[i] = cpu_node(free_cpus[i]);
+		bool seen = false;
+		for (int j = 0; j < num_nodes && !seen; j++) {
+			seen = node_ids[j] == nodes[i];
+		}
+		if (!seen) {
+			node_ids[num_nodes++] = nodes[i];
+		}
+	}
+	
+	// Deal the slots across the nodes and split each node's CPUs between its slots
+	for (int n = 0; n < num_nodes; n++) {
+		int node_cpus[num_free];
+		int num_node_cpus = 0;
+		for (int i = 0; i < num_free; i++) {
+			if (nodes[i] == node_ids[n]) {
+				node_cpus[num_node_cpus++] = free_cpus[i];
+			}
+		}
+		int num_node_slots = (ip.jobs - n + num_nodes - 1) / num_nodes;
+		for (int k = 0; k < num_node_slots; k++) {
+			int slot = n + k * num_nodes;
+			ip.pool->nodes[slot] = node_ids[n];
+			if (num_node_slots >= num_node_cpus) {
+				CPU_SET(node_cpus[k % num_node_cpus], &(ip.pool->masks[slot]));
+			} else {
+				for (int c = k * num_node_cpus / num_node_slots; c < (k + 1) * num_node_cpus / num_node_slots; c++) {
+					CPU_SET(node_cpus[c], &(ip.pool->masks[slot]));
+				}
+			}
+		}
+	}
+	ip.pool->pinned = true;
+	
+	// Report the placement
+	cout << term->blue << "Pinning simulations " << term->reset << "to " << num_free << " CPUs on " << num_nodes << " NUMA node" << (num_nodes == 1 ? "" : "s") << endl;
+	if (ip.reserve_cpus > 0) {
+		cpu_set_t actual;
+		sched_getaffinity(0, sizeof(actual), &actual);
+		cout << "  genetic algorithm: CPUs";
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &actual)) {
+				cout << " " << cpu;
+			}
+		}
+		cout << endl;
+	}
+	for (int slot = 0; slot < ip.jobs; slot++) {
+		cout << "  slot " << slot << ": CPUs";
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &(ip.pool->masks[slot]))) {
+				cout << " " << cpu;
+			}
+		}
+		cout << " (node " << ip.pool->nodes[slot] << ")" << endl;
+	}
+}
+
+/* pin_worker pins the calling process to the given slot's CPUs if the user pinned simulations
+	parameters:
+		ip: the program's input parameters
+		slot: the slot whose CPUs to pin to
+	returns: false if the process could not be pinned, true otherwise
+	notes:
+		This is called in the child process before the simulation is executed, so the simulation inherits the pinning. It only makes async-signal-safe calls and prints nothing, so the forked child cannot deadlock on a lock another thread held when the program forked.
+	todo:
+*/
+bool pin_worker (input_params& ip, int slot) {
+	if (ip.pool != NULL && ip.pool->pinned) {
+		return sched_setaffinity(0, sizeof(cpu_set_t), &(ip.pool->masks[slot])) != -1;
+	}
+	return true;
+}
+
+/* acquire_slot gives the given run a free slot if it is entitled to one
+	parameters:
+		pool: the worker pool
+		run: the index of the run asking for a slot
+		limit: the most slots the run may hold at once
+	returns: the slot, or -1 if the run must wait for a slot to be released
+	notes:
+		Slots are shared fairly: a run holding at least its fair share (the slots divided by the runs that want them) only gets another slot if no run below its share is waiting. A refused run is woken through its eventfd whenever a slot is released.
+	todo:
+*/
+static int acquire_slot (worker_pool* pool, int run, int limit) {
+	pthread_mutex_lock(&(pool->lock));
+	int slot = -1;
+	if (pool->in_flight[run] < limit) {
+		for (int i = 0; i < pool->num_slots && slot == -1; i++) {
+			if (!pool->busy[i]) {
+				slot = i;
+			}
+		}
+	}
+	if (slot != -1) {
+		int wanting = 0;
+		for (int r = 0; r < pool->num_runs; r++) {
+			wanting += (r == run || pool->in_flight[r] > 0 || pool->waiting[r]);
+		}
+		int share = (pool->num_slots + wanting - 1) / wanting;
+		for (int r = 0; r < pool->num_runs && slot != -1; r++) {
+			if (r != run && pool->waiting[r] && pool->in_flight[r] < share && pool->in_flight[run] >= share) {
+				slot = -1;
+			}
+		}
+	}
+	if (slot != -1) {
+		pool->busy[slot] = true;
+		pool->in_flight[run]++;
+	}
+	pool->waiting[run] = slot == -1 && pool->in_flight[run] < limit;
+	pthread_mutex_unlock(&(pool->lock));
+	return slot;
+}
+
+/* release_slot gives the given slot back to the pool and wakes every run waiting for one
+	parameters:
+		pool: the worker pool
+		run: the index of the run that held the slot
+		slot: the slot
+	returns: nothing
+	notes:
+	todo:
+*/
+static void release_slot (worker_pool* pool, int run, int slot) {
+	pthread_mutex_lock(&(pool->lock));
+	pool->busy[slot] = false;
+	pool->in_flight[run]--;
+	uint64_t one = 1;
+	for (int r = 0; r < pool->num_runs; r++) {
+		if (pool->waiting[r] && write(pool->wake_fds[r], &one, sizeof(one)) == -1 && errno != EAGAIN) {
+			term->failed_pipe_write();
+			exit(EXIT_PIPE_WRITE_ERROR);
+		}
+	}
+	pthread_mutex_unlock(&(pool->lock));
+}
+
+/* watch_simulation adds the given simulation's output pipe and pidfd to the given epoll instance
+	parameters:
+		epoll_fd: the epoll instance
+		sim: the simulation to watch
+	returns: nothing
+	notes:
+		Each event's data holds the simulation's slot times two, plus one for its pidfd.
+	todo:
+*/
+static void watch_simulation (int epoll_fd, simulation* sim) {
+	epoll_event event;
+	event.events = EPOLLIN;
+	event.data.u64 = sim->slot * 2;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sim->out_fd, &event) == -1) {
+		term->failed_pipe_create();
+		exit(EXIT_PIPE_CREATE_ERROR);
+	}
+	if (sim->pidfd != -1) {
+		event.data.u64 = sim->slot * 2 + 1;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sim->pidfd, &event) == -1) {
+			close(sim->pidfd);
+			sim->pidfd = -1;
+		}
+	}
+}
+
+/* unwatch_fd removes the given file descriptor from the given epoll instance and closes it
+	parameters:
+		epoll_fd: the epoll instance
+		fd: a pointer to the file descriptor, which is set to -1
+	returns: nothing
+	notes:
+		The descriptor must be removed explicitly rather than just closed because a child forked since it was opened may still hold a copy of it until it calls exec, which would keep it in the epoll instance.
+	todo:
+*/
+static void unwatch_fd (int epoll_fd, int* fd) {
+	if (*fd != -1) {
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, *fd, NULL);
+		close(*fd);
+		*fd = -1;
+	}
+}
+
+/* init_concurrency creates the run's concurrency controller if the user asked for the number of simulations in flight to be adjusted automatically
+	parameters:
+		ip: the run's input parameters
+	returns: nothing
+	notes:
+		The limit starts at the number of online CPUs, kept within --min-jobs and --jobs.
+	todo:
+*/
+void init_concurrency (input_params& ip) {
+	if (!ip.adaptive_jobs) {
+		return;
+	}
+	int start = min(ip.jobs, max(ip.min_jobs, (int)sysconf(_SC_NPROCESSORS_ONLN)));
+	ip.controller = new concurrency_controller(ip.min_jobs, ip.jobs, start);
+	term->verbose() << term->blue << "Adjusting " << term->reset << "the simulations in flight between " << ip.min_jobs << " and " << ip.jobs << ", starting at " << start << endl;
+}
+
+/* read_pressure reads the percentage of the last 10 seconds some task was stalled on the given resource
+	parameters:
+		filename: the resource's pressure file (e.g. /proc/pressure/memory)
+	returns: the percentage, or 0 if the kernel does not report pressure stall information
+	notes:
+	todo:
+*/
+static double read_pressure (const char* filename) {
+	double pressure = 0;
+	FILE* file = fopen(filename, "r");
+	if (file != NULL) {
+		if (fscanf(file, "some avg10=%lf", &pressure) != 1) {
+			pressure = 0;
+		}
+		fclose(file);
+	}
+	return pressure;
+}
+
+/* read_host_load measures how busy the host is
+	parameters:
+		load: the host_load to store the measurements in
+	returns: nothing
+	notes:
+		Measurements that cannot be read keep their defaults, which never hold the limit back.
+	todo:
+*/
+static void read_host_load (host_load& load) {
+	FILE* file = fopen("/proc/loadavg", "r");
+	if (file != NULL) {
+		double load_average;
+		if (fscanf(file, "%lf", &load_average) == 1) {
+			load.load_per_cpu = load_average / max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+		}
+		fclose(file);
+	}
+	load.cpu_pressure = read_pressure("/proc/pressure/cpu");
+	load.memory_pressure = read_pressure("/proc/pressure/memory");
+	file = fopen("/proc/meminfo", "r");
+	if (file != NULL) {
+		char line[256];
+		double total = 0;
+		double available = -1;
+		while (fgets(line, sizeof(line), file) != NULL) {
+			sscanf(line, "MemTotal: %lf", &total);
+			sscanf(line, "MemAvailable: %lf", &available);
+		}
+		fclose(file);
+		if (total > 0 && available >= 0) {
+			load.memory_available = available / total;
+		}
+	}
+}
+
+/* change_limit sets a run's concurrency limit and logs the change
+	parameters:
+		c: the run's concurrency controller
+		limit: the new limit, which is clamped to the controller's bounds
+		reason: why the limit is changing
+	returns: true if the limit changed, false if it was already at the bound it would have passed
+	notes:
+		Changes are counted for the run statistics, which report prints after every generation.
+	todo:
+*/
+static bool change_limit (concurrency_controller* c, int limit, const char* reason) {
+	limit = max(c->min_limit, min(c->max_limit, limit));
+	if (limit == c->limit) {
+		c->direction = -c->direction; // Probe the other way once a bound is reached
+		return false;
+	}
+	term->verbose() << "  " << term->blue << (limit > c->limit ? "Raised " : "Lowered ") << term->reset << "the simulations in flight from " << c->limit << " to " << limit << " because " << reason << endl;
+	if (limit > c->limit) {
+		c->raised++;
+		c->direction = 1;
+	} else {
+		c->lowered++;
+		c->direction = -1;
+	}
+	c->limit = limit;
+	c->last_reason = reason;
+	return true;
+}
+
+/* record_completion counts a completed simulation toward the run's throughput and adjusts its concurrency limit once enough have completed
+	parameters:
+		ip: the run's input parameters
+		saturated: whether or not the run had sets waiting for a slot when the simulation completed
+	returns: nothing
+	notes:
+		Low memory lowers the limit by a quarter at once. Otherwise the limit climbs one step at a time toward higher throughput: a step that raised throughput is repeated, one that lowered it is undone, and one that made no difference is followed by a step down since it used more resources for nothing. The limit is lowered instead of raised while the host is overloaded.
+		Throughput is only compared across a change, so after a window that left the limit alone the next one probes afresh.
+	todo:
+*/
+static void record_completion (input_params& ip, bool saturated) {
+	concurrency_controller* c = ip.controller;
+	if (c == NULL) {
+		return;
+	}
+	double now = wall_time();
+	if (saturated) {
+		c->window_seconds += now - c->mark;
+		c->window_completions++;
+	}
+	c->mark = now;
+	if (c->window_seconds < CONCURRENCY_WINDOW_SECONDS || c->window_completions < CONCURRENCY_WINDOW_COMPLETIONS * c->limit) {
+		return;
+	}
+	
+	double throughput = c->window_completions / c->window_seconds;
+	host_load load;
+	read_host_load(load);
+	int limit;
+	const char* reason;
+	if (load.memory_available < CONCURRENCY_MIN_MEMORY_AVAILABLE || load.memory_pressure > CONCURRENCY_MAX_MEMORY_PRESSURE) {
+		limit = c->limit - max(1, c->limit / 4);
+		reason = "memory is running low";
+	} else {
+		int step;
+		if (c->last_throughput == 0) {
+			step = c->direction;
+			reason = "throughput is being probed";
+		} else if (throughput < c->last_throughput * (1 - CONCURRENCY_TOLERANCE)) {
+			step = -c->direction;
+			reason = "the last change lowered throughput";
+		} else if (throughput <= c->last_throughput * (1 + CONCURRENCY_TOLERANCE)) {
+			step = -1;
+			reason = "the last change did not raise throughput";
+		} else {
+			step = c->direction;
+			reason = "the last change raised throughput";
+		}
+		if (step > 0 && load.load_per_cpu > CONCURRENCY_MAX_LOAD_PER_CPU) {
+			step = -1;
+			reason = "the host is overloaded";
+		}
+		limit = c->limit + step;
+	}
+	c->last_throughput = change_limit(c, limit, reason) ? throughput : 0;
+	c->window_seconds = 0;
+	c->window_completions = 0;
+}
+
+/* simulate_batch simulates the given parameter sets, running up to one simulation per worker slot at once
+	parameters:
+		ip: the program's input parameters
+		sets: the parameter sets to simulate, stored consecutively
+		count: the number of sets
+		scores: an array to store each set's score in
+		unscored_sets: an array to flag each set left unscored in, or NULL
+	returns: the number of sets actually simulated, which excludes sets whose scores were found in the score database and sets left unscored
+	notes:
+		If the user specified a score database, sets are looked up in it first and only the rest are simulated, after which their scores are stored in it.
+		Every running simulation's output pipe and pidfd are watched with one epoll instance, so scores are read as soon as they are written and a simulation is finished as soon as it exits, whatever order the simulations finish in. A new simulation is launched as soon as a slot is free.
+		Slots are taken from the worker pool, which other runs in a sweep may share; the run's eventfd is watched too so it can take a slot another run released. At most --jobs slots are held at once.
+		A simulation that crashes or exits without a score is retried up to --retries times, waiting --retry-delay seconds before the first retry and twice as long before each further one. A set that fails every attempt gets the failure score, is listed in the quarantine file, and is not stored in the score database. If a pipe or process cannot be created, launching backs off instead of exiting, and the program only gives up after many failures in a row.
+		If the kernel does not support pidfds, exited simulations are found by polling wait4 every few milliseconds instead.
+		Once the evaluation budget allows no more simulations, or the time budget runs out, the sets not yet launched and the sets waiting to be retried are left unscored with a score of 0, counted in ip.unscored, and flagged in unscored_sets. Every launch counts toward the evaluation budget, retries included, and the number of launches is stored in ip.launches. When the time runs out, the simulations still running are killed if --budget-action is cancel, or drained otherwise. Unscored sets are not stored in the score database.
+	todo:
+*/
+int simulate_batch (input_params& ip, int* sets, int count, double* scores, bool* unscored_sets) {
+	if (count == 0) { // Every set may have been reused or penalized, leaving nothing to allocate for
+		ip.unscored = 0;
+		ip.launches = 0;
+		return 0;
+	}
+	
+	// Look the sets up in the score database, leaving only the rest to simulate
+	int* pending = new int[count]; // The indices of the sets to simulate
+	int num_pending = 0;
+	if (ip.database != NULL) {
+		bool* found = new bool[count];
+		score_db_find(ip.database, sets, count, ip.num_dims, scores, found);
+		for (int i = 0; i < count; i++) {
+			if (found[i]) {
+				print_good_set(ip, sets + i * ip.num_dims, scores[i]);
+			} else {
+				pending[num_pending++] = i;
+			}
+		}
+		delete[] found;
+	} else {
+		for (int i = 0; i < count; i++) {
+			pending[i] = i;
+		}
+		num_pending = count;
+	}
+	
+	worker_pool* pool = ip.pool;
+	int num_slots = pool->num_slots;
+	concurrency_controller* controller = ip.controller;
+	if (controller != NULL) {
+		controller->mark = wall_time();
+	}
+	simulation running[num_slots];
+	bool mine[num_slots]; // Whether or not this batch holds each slot
+	memset(mine, 0, sizeof(mine));
+	int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		term->failed_pipe_create();
+		exit(EXIT_PIPE_CREATE_ERROR);
+	}
+	int wake_fd = pool->wake_fds[ip.run_index];
+	epoll_event wake_event;
+	wake_event.events = EPOLLIN;
+	wake_event.data.u64 = 2 * num_slots;
+	if (num_pending > 0 && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &wake_event) == -1) {
+		term->failed_pipe_create();
+		exit(EXIT_PIPE_CREATE_ERROR);
+	}
+	
+	int launched = 0; // The number of pending sets launched for the first time
+	int started = 0; // The number of simulations launched, retries included, which the evaluation budget limits
+	int finished = 0; // The number of pending sets scored or given up on
+	int* attempts = new int[count]; // The number of failed attempts of each set
+	memset(attempts, 0, sizeof(int) * count);
+	int* retry_sets = new int[max(num_pending, 1)]; // The sets waiting to be retried
+	double* retry_times = new double[max(num_pending, 1)]; // The wall_time each waiting set may be retried at
+	int num_retries = 0;
+	double resume_time = 0; // The wall_time launching may resume at after a pipe or process could not be created
+	int launch_failures = 0; // The number of launches in a row that could not create a pipe or process
+	bool* unscored = new bool[count]; // Whether or not each set was left unscored because a budget ran out
+	memset(unscored, 0, sizeof(bool) * count);
+	epoll_event events[2 * num_slots + 1];
+	while (finished < num_pending) {
+		// Once a budget runs out, give up on the sets not yet launched or waiting to be retried, and when the time runs out, on the running simulations too if the user chose to
+		double now = wall_time();
+		bool out_of_time = ip.budget_deadline > 0 && now >= ip.budget_deadline;
+		bool out_of_simulations = ip.budget_simulations >= 0 && started >= ip.budget_simulations;
+		if (out_of_time || out_of_simulations) {
+			for (; launched < num_pending; launched++) {
+				unscored[pending[launched]] = true;
+				finished++;
+			}
+			for (int r = 0; r < num_retries; r++) {
+				unscored[retry_sets[r]] = true;
+				finished++;
+			}
+			num_retries = 0;
+		}
+		if (out_of_time && ip.budget_action == BUDGET_CANCEL) {
+			for (int slot = 0; slot < num_slots; slot++) {
+				if (mine[slot] && !running[slot].reaped && !running[slot].cancelled) {
+					kill(running[slot].pid, SIGKILL);
+					running[slot].cancelled = true;
+				}
+			}
+		}
+		
+		// Take as many slots as the pool allows, launching sets due to be retried before new ones
+		while (now >= resume_time) {
+			int retry = -1;
+			for (int r = 0; r < num_retries && retry == -1; r++) {
+				if (retry_times[r] <= now) {
+					retry = r;
+				}
+			}
+			if ((retry == -1 && launched == num_pending) || (ip.budget_simulations >= 0 && started >= ip.budget_simulations)) {
+				break;
+			}
+			int slot = acquire_slot(pool, ip.run_index, controller != NULL ? controller->limit : ip.jobs);
+			if (slot == -1) {
+				break;
+			}
+			int index = retry != -1 ? retry_sets[retry] : pending[launched];
+			double launch_time = wall_time();
+			if (!launch_simulation(ip, sets + index * ip.num_dims, slot, &running[slot])) { // Back off and try the same set again later
+				release_slot(pool, ip.run_index, slot);
+				ip.failures.backoffs++;
+				launch_failures++;
+				if (launch_failures > LAUNCH_MAX_FAILURES) {
+					term->failed_fork();
+					exit(EXIT_FORK_ERROR);
+				}
+				double delay = min(LAUNCH_BACKOFF_MAX_SECONDS, ldexp(LAUNCH_BACKOFF_SECONDS, launch_failures - 1));
+				cout << term->yellow << "Couldn't start a simulation, " << term->reset << "so waiting " << delay << " seconds before trying again" << endl;
+				resume_time = now + delay;
+				break;
+			}
+			launch_failures = 0;
+			started++;
+			if (retry != -1) {
+				num_retries--;
+				retry_sets[retry] = retry_sets[num_retries];
+				retry_times[retry] = retry_times[num_retries];
+			} else {
+				launched++;
+			}
+			running[slot].index = index;
+			running[slot].launch_time = launch_time;
+			running[slot].run_time = wall_time();
+			watch_simulation(epoll_fd, &running[slot]);
+			mine[slot] = true;
+		}
+		
+		// Wait for output, exits, or released slots, polling for exits if some simulation has no pidfd and waking when launching may resume or a retry is due
+		bool polling = false;
+		for (int slot = 0; slot < num_slots; slot++) {
+			polling |= mine[slot] && running[slot].pidfd == -1 && !running[slot].reaped;
+		}
+		int timeout = polling ? SIMULATION_POLL_MS : -1;
+		double wait_until = resume_time > now ? resume_time : 0;
+		for (int r = 0; r < num_retries && resume_time <= now; r++) {
+			if (retry_times[r] > now && (wait_until == 0 || retry_times[r] < wait_until)) {
+				wait_until = retry_times[r];
+			}
+		}
+		if (ip.budget_deadline > now && (wait_until == 0 || ip.budget_deadline < wait_until)) {
+			wait_until = ip.budget_deadline;
+		}
+		if (wait_until > 0) {
+			int wait_ms = ceil((wait_until - now) * 1000);
+			timeout = timeout == -1 ? wait_ms : min(timeout, wait_ms);
+		}
+		int num_events = epoll_wait(epoll_fd, events, 2 * num_slots + 1, timeout);
+		if (num_events == -1 && errno != EINTR) {
+			term->failed_pipe_read();
+			exit(EXIT_PIPE_READ_ERROR);
+		}
+		for (int i = 0; i < num_events; i++) {
+			if (events[i].data.u64 == (uint64_t)(2 * num_slots)) { // A slot was released, so try to take it
+				uint64_t wakeups;
+				while (read(wake_fd, &wakeups, sizeof(wakeups)) > 0);
+				continue;
+			}
+			simulation* sim = &running[events[i].data.u64 / 2];
+			if (events[i].data.u64 % 2 == 0) {
+				bool eof = sim->out_fd != -1 && read_simulation_output(sim);
+				if (sim->read_time == 0 && sim->bytes_read > 0) {
+					sim->read_time = wall_time();
+				}
+				if (eof) {
+					unwatch_fd(epoll_fd, &(sim->out_fd));
+				}
+			} else if (sim->pidfd != -1 && reap_simulation(sim)) {
+				unwatch_fd(epoll_fd, &(sim->pidfd));
+			}
+		}
+		
+		// Finish every simulation that has exited and closed its output, giving its slot back and retrying or giving up on failed sets
+		for (int slot = 0; slot < num_slots; slot++) {
+			simulation* sim = &running[slot];
+			if (mine[slot] && sim->out_fd == -1 && reap_simulation(sim)) {
+				unwatch_fd(epoll_fd, &(sim->pidfd));
+				sim->cleanup_time = wall_time();
+				double score = 0;
+				bool succeeded = complete_simulation(ip, sim, &score);
+				account_simulation(ip, sim, score);
+				trace_simulation(ip, sim);
+				mine[slot] = false;
+				release_slot(pool, ip.run_index, slot);
+				int index = sim->index;
+				if (succeeded) {
+					scores[index] = score;
+					finished++;
+				} else if (sim->cancelled) {
+					unscored[index] = true;
+					finished++;
+				} else {
+					ip.failures.failed++;
+					attempts[index]++;
+					if (attempts[index] <= ip.retries) {
+						double delay = ldexp(ip.retry_delay, attempts[index] - 1);
+						cout << term->yellow << "Retrying the set " << term->reset << "in " << delay << " seconds (retry " << attempts[index] << " of " << ip.retries << ")" << endl;
+						ip.failures.retried++;
+						retry_sets[num_retries] = index;
+						retry_times[num_retries] = wall_time() + delay;
+						num_retries++;
+					} else {
+						ip.failures.penalized++;
+						scores[index] = ip.failure_score;
+						quarantine_set(ip, sets + index * ip.num_dims, sim->failure, attempts[index]);
+						finished++;
+					}
+				}
+				record_completion(ip, launched < num_pending || num_retries > 0);
+			}
+		}
+	}
+	close(epoll_fd);
+	ip.unscored = 0;
+	for (int i = 0; i < count; i++) {
+		if (unscored[i]) {
+			scores[i] = 0;
+			ip.unscored++;
+		}
+	}
+	if (unscored_sets != NULL) {
+		memcpy(unscored_sets, unscored, sizeof(bool) * count);
+	}
+	ip.launches = started;
+	
+	// Store the new scores in the score database, leaving out the failure scores given to sets that were never scored
+	if (ip.database != NULL && num_pending > 0) {
+		int* simulated_sets = new int[num_pending * ip.num_dims];
+		double* simulated_scores = new double[num_pending];
+		int num_scored = 0;
+		for (int i = 0; i < num_pending; i++) {
+			if (attempts[pending[i]] <= ip.retries && !unscored[pending[i]]) {
+				memcpy(simulated_sets + num_scored * ip.num_dims, sets + pending[i] * ip.num_dims, sizeof(int) * ip.num_dims);
+				simulated_scores[num_scored] = scores[pending[i]];
+				num_scored++;
+			}
+		}
+		if (num_scored > 0) {
+			score_db_insert(ip.database, simulated_sets, num_scored, ip.num_dims, simulated_scores);
+		}
+		delete[] simulated_sets;
+		delete[] simulated_scores;
+	}
+	delete[] attempts;
+	delete[] unscored;
+	delete[] retry_sets;
+	delete[] retry_times;
+	delete[] pending;
+	return num_pending - ip.unscored;
+}